@@ -0,0 +1,241 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file bloom_filter.c
+ *  \brief blocked Bloom filter, where each key touches a single cache line. Salts are from the split block Bloom
+ *  filter of Apache Parquet (Apache-2.0), and the block choice uses Lemire's fast range reduction. */
+
+#include "bloom_filter.h"
+
+#define BLOOM_WORDS 16  /* 64 bytes per block: plane A = words 0...7, plane B = words 8...15 */
+#define BLOOM_BATCH 32  /* number of blocks prefetched in batched lookups */
+
+static const uint32_t bloom_salt[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+static inline uint32_t * bloom_block (crpx_bloom_filter_t bf, uint64_t h0);
+static inline void bloom_uint64_to_hash (uint64_t key, uint64_t seed, uint64_t *hash);
+static inline void bloom_block_insert (crpx_bloom_filter_t bf, uint32_t *blk, uint64_t h1);
+static inline bool bloom_block_contains (crpx_bloom_filter_t bf, const uint32_t *blk, uint64_t h1);
+static inline bool bloom_block_insert_atomic (uint32_t *blk, uint64_t h1);
+
+crpx_bloom_filter_t
+new_crpx_bloom_filter (crpx_global_t cglob, uint64_t n_elements, double bits_per_element, uint64_t seed)
+{
+  if (bits_per_element < 1.) bits_per_element = 1.;
+  if (n_elements < 1) n_elements = 1;
+  crpx_bloom_filter_t bf = (crpx_bloom_filter_t) crpx_malloc (cglob, sizeof (crpx_bloom_filter_struct));
+  if (!bf) return NULL;
+  bf->n_blocks = (uint64_t) ceil ((double) n_elements * bits_per_element / (8. * sizeof (uint32_t) * BLOOM_WORDS));
+  bf->seed = seed;
+  bf->block = (uint32_t *) aligned_alloc (64, bf->n_blocks * BLOOM_WORDS * sizeof (uint32_t)); // size is multiple of alignment
+  if (!bf->block) {
+    crpx_logger_error (cglob, "new_crpx_bloom_filter: failed allocation of %lu blocks of 64 bytes: %s", bf->n_blocks, strerror (errno));
+    free (bf);
+    return NULL;
+  }
+  bf->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, bf->cglob); // thread-safe increase of ref_counter
+  crpx_bloom_filter_reset (bf);
+  crpx_logger_verbose (cglob, "Bloom filter with %lu blocks (%lu bytes) created", bf->n_blocks, bf->n_blocks * 64);
+  return bf;
+}
+
+void
+del_crpx_bloom_filter (crpx_bloom_filter_t bf)
+{
+  if (!bf) return;
+  if (bf->block) free (bf->block);
+  crpx_global_finalise (bf->cglob); // it just decreases cglob->ref_counter
+  free (bf);
+}
+
+void
+crpx_bloom_filter_reset (crpx_bloom_filter_t bf)
+{
+  memset (bf->block, 0, bf->n_blocks * BLOOM_WORDS * sizeof (uint32_t));
+}
+
+static inline uint32_t *
+bloom_block (crpx_bloom_filter_t bf, uint64_t h0)
+{ // fast alternative to modulo: https://lemire.me/blog/2016/06/27/a-fast-alternative-to-the-modulo-reduction/
+  return bf->block + (uint64_t)(((__uint128_t) h0 * (__uint128_t) bf->n_blocks) >> 64) * BLOOM_WORDS;
+}
+
+static inline void
+bloom_uint64_to_hash (uint64_t key, uint64_t seed, uint64_t *hash)
+{
+  hash[0] = crpx_hashint_murmurmix64 (key ^ seed);
+  hash[1] = crpx_hashint_nasam64 (key + seed);
+}
+
+/* the lower 32 bits of h1 define the bit within each word, and the next 8 bits define the plane (A or B) of each probe */
+
+#ifdef __AVX2__
+static inline void
+bloom_masks_avx2 (uint64_t h1, __m256i *mask_a, __m256i *mask_b)
+{
+  const __m256i salt = _mm256_loadu_si256 ((const __m256i *) bloom_salt);
+  const __m256i lane_bit = _mm256_setr_epi32 (1, 2, 4, 8, 16, 32, 64, 128);
+  __m256i m = _mm256_mullo_epi32 (_mm256_set1_epi32 ((int32_t)(uint32_t) h1), salt);
+  m = _mm256_sllv_epi32 (_mm256_set1_epi32 (1), _mm256_srli_epi32 (m, 27)); // one bit per 32-bit lane
+  __m256i sel = _mm256_and_si256 (_mm256_set1_epi32 ((int32_t)(uint32_t)(h1 >> 32)), lane_bit);
+  sel = _mm256_cmpeq_epi32 (sel, lane_bit); // all bits set in lanes where probe goes to plane B
+  *mask_a = _mm256_andnot_si256 (sel, m);
+  *mask_b = _mm256_and_si256 (sel, m);
+}
+#endif
+
+static inline void
+bloom_block_insert (__attribute__((unused)) crpx_bloom_filter_t bf, uint32_t *blk, uint64_t h1)
+{
+#ifdef __AVX2__
+  if (bf->cglob->avx) {
+    __m256i ma, mb;
+    bloom_masks_avx2 (h1, &ma, &mb);
+    _mm256_store_si256 ((__m256i *) blk,       _mm256_or_si256 (_mm256_load_si256 ((const __m256i *) blk), ma));
+    _mm256_store_si256 ((__m256i *)(blk + 8), _mm256_or_si256 (_mm256_load_si256 ((const __m256i *)(blk + 8)), mb));
+    return;
+  }
+#endif
+  uint32_t x = (uint32_t) h1, sel = (uint32_t)(h1 >> 32);
+  for (int i = 0; i < 8; i++) blk[i + (((sel >> i) & 1) << 3)] |= 1U << ((x * bloom_salt[i]) >> 27);
+}
+
+static inline bool
+bloom_block_contains (__attribute__((unused)) crpx_bloom_filter_t bf, const uint32_t *blk, uint64_t h1)
+{
+#ifdef __AVX2__
+  if (bf->cglob->avx) {
+    __m256i ma, mb;
+    bloom_masks_avx2 (h1, &ma, &mb); // testc() is true if all bits from mask are also in block
+    return _mm256_testc_si256 (_mm256_load_si256 ((const __m256i *) blk), ma) &
+           _mm256_testc_si256 (_mm256_load_si256 ((const __m256i *)(blk + 8)), mb);
+  }
+#endif
+  uint32_t x = (uint32_t) h1, sel = (uint32_t)(h1 >> 32);
+  for (int i = 0; i < 8; i++) if (!(blk[i + (((sel >> i) & 1) << 3)] & (1U << ((x * bloom_salt[i]) >> 27)))) return false;
+  return true;
+}
+
+static inline bool
+bloom_block_insert_atomic (uint32_t *blk, uint64_t h1)
+{ // bits already set are not written, to avoid contention in the cache line
+  uint32_t x = (uint32_t) h1, sel = (uint32_t)(h1 >> 32), mask, old, *w;
+  bool present = true;
+  for (int i = 0; i < 8; i++) {
+    w = blk + i + (((sel >> i) & 1) << 3);
+    mask = 1U << ((x * bloom_salt[i]) >> 27);
+    #pragma omp atomic read
+    old = *w;
+    if (old & mask) continue;
+    #pragma omp atomic capture
+    { old = *w; *w |= mask; }
+    present &= ((old & mask) != 0); // another thread may have set it in between
+  }
+  return present;
+}
+
+void
+crpx_bloom_filter_insert_hash (crpx_bloom_filter_t bf, const uint64_t hash[2])
+{
+  bloom_block_insert (bf, bloom_block (bf, hash[0]), hash[1]);
+}
+
+bool
+crpx_bloom_filter_contains_hash (crpx_bloom_filter_t bf, const uint64_t hash[2])
+{
+  return bloom_block_contains (bf, bloom_block (bf, hash[0]), hash[1]);
+}
+
+bool
+crpx_bloom_filter_insert_hash_atomic (crpx_bloom_filter_t bf, const uint64_t hash[2])
+{
+  return bloom_block_insert_atomic (bloom_block (bf, hash[0]), hash[1]);
+}
+
+void
+crpx_bloom_filter_insert_bytes (crpx_bloom_filter_t bf, const void *key, size_t len)
+{
+  uint64_t hash[2];
+  crpx_murmurhash3_128bits (key, len, (uint32_t) bf->seed, hash);
+  bloom_block_insert (bf, bloom_block (bf, hash[0]), hash[1]);
+}
+
+bool
+crpx_bloom_filter_contains_bytes (crpx_bloom_filter_t bf, const void *key, size_t len)
+{
+  uint64_t hash[2];
+  crpx_murmurhash3_128bits (key, len, (uint32_t) bf->seed, hash);
+  return bloom_block_contains (bf, bloom_block (bf, hash[0]), hash[1]);
+}
+
+void
+crpx_bloom_filter_insert_uint64 (crpx_bloom_filter_t bf, uint64_t key)
+{
+  uint64_t hash[2];
+  bloom_uint64_to_hash (key, bf->seed, hash);
+  bloom_block_insert (bf, bloom_block (bf, hash[0]), hash[1]);
+}
+
+bool
+crpx_bloom_filter_contains_uint64 (crpx_bloom_filter_t bf, uint64_t key)
+{
+  uint64_t hash[2];
+  bloom_uint64_to_hash (key, bf->seed, hash);
+  return bloom_block_contains (bf, bloom_block (bf, hash[0]), hash[1]);
+}
+
+bool
+crpx_bloom_filter_insert_uint64_atomic (crpx_bloom_filter_t bf, uint64_t key)
+{
+  uint64_t hash[2];
+  bloom_uint64_to_hash (key, bf->seed, hash);
+  return bloom_block_insert_atomic (bloom_block (bf, hash[0]), hash[1]);
+}
+
+void
+crpx_bloom_filter_insert_uint64_array (crpx_bloom_filter_t bf, const uint64_t *keys, size_t n)
+{
+  size_t i;
+#pragma omp parallel for schedule(static) if (n > BLOOM_BATCH * 1024)
+  for (i = 0; i < n; i += BLOOM_BATCH) {
+    uint64_t hash[BLOOM_BATCH][2];
+    uint32_t *blk[BLOOM_BATCH];
+    size_t j, m = CRPX_MIN (BLOOM_BATCH, n - i);
+    for (j = 0; j < m; j++) {
+      bloom_uint64_to_hash (keys[i+j], bf->seed, hash[j]);
+      blk[j] = bloom_block (bf, hash[j][0]);
+      __builtin_prefetch (blk[j], 1, 1);
+    }
+    for (j = 0; j < m; j++) bloom_block_insert_atomic (blk[j], hash[j][1]);
+  }
+}
+
+size_t
+crpx_bloom_filter_contains_uint64_array (crpx_bloom_filter_t bf, const uint64_t *keys, size_t n, bool *result)
+{
+  size_t i, found = 0;
+#pragma omp parallel for schedule(static) reduction(+:found) if (n > BLOOM_BATCH * 1024)
+  for (i = 0; i < n; i += BLOOM_BATCH) {
+    uint64_t hash[BLOOM_BATCH][2];
+    uint32_t *blk[BLOOM_BATCH];
+    size_t j, m = CRPX_MIN (BLOOM_BATCH, n - i);
+    for (j = 0; j < m; j++) { // all blocks are requested before the first one is tested
+      bloom_uint64_to_hash (keys[i+j], bf->seed, hash[j]);
+      blk[j] = bloom_block (bf, hash[j][0]);
+      __builtin_prefetch (blk[j], 0, 1);
+    }
+    for (j = 0; j < m; j++) found += (result[i+j] = bloom_block_contains (bf, blk[j], hash[j][1]));
+  }
+  return found;
+}
@@ -0,0 +1,58 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file bloom_filter.h
+ *  \brief cache-line blocked Bloom filter: each key sets 8 bits within a single 64 bytes block.
+ *  A block has two planes of 8 x 32 bits; each of the 8 probes sets one bit in word i of plane A or B, s.t. the
+ *  masks for both planes can be built with one AVX2 multiplication (as in the split block Bloom filter of Apache Parquet). */
+
+#ifndef _curupixa_bloom_filter_h_
+#define _curupixa_bloom_filter_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint32_t *block;   /*!< \brief n_blocks x 16 words, aligned to 64 bytes (cache line) */
+  uint64_t n_blocks, seed;
+  crpx_global_t cglob;
+} crpx_bloom_filter_struct, *crpx_bloom_filter_t;
+
+/*! \brief new filter with room for n_elements at bits_per_element (e.g. 12 bits give approx 0.5% false positives) */
+crpx_bloom_filter_t new_crpx_bloom_filter (crpx_global_t cglob, uint64_t n_elements, double bits_per_element, uint64_t seed);
+void del_crpx_bloom_filter (crpx_bloom_filter_t bf);
+void crpx_bloom_filter_reset (crpx_bloom_filter_t bf);
+
+/*! \brief hash[0] selects the block and hash[1] the bits within it (e.g. output of crpx_murmurhash3_128bits()) */
+void crpx_bloom_filter_insert_hash (crpx_bloom_filter_t bf, const uint64_t hash[2]);
+bool crpx_bloom_filter_contains_hash (crpx_bloom_filter_t bf, const uint64_t hash[2]);
+/*! \brief thread-safe insertion (omp atomic); returns true if element was already (possibly) present */
+bool crpx_bloom_filter_insert_hash_atomic (crpx_bloom_filter_t bf, const uint64_t hash[2]);
+
+void crpx_bloom_filter_insert_bytes (crpx_bloom_filter_t bf, const void *key, size_t len);
+bool crpx_bloom_filter_contains_bytes (crpx_bloom_filter_t bf, const void *key, size_t len);
+void crpx_bloom_filter_insert_uint64 (crpx_bloom_filter_t bf, uint64_t key);
+bool crpx_bloom_filter_contains_uint64 (crpx_bloom_filter_t bf, uint64_t key);
+bool crpx_bloom_filter_insert_uint64_atomic (crpx_bloom_filter_t bf, uint64_t key);
+
+/*! \brief parallel insertion of n keys (OpenMP threads with atomic updates) */
+void crpx_bloom_filter_insert_uint64_array (crpx_bloom_filter_t bf, const uint64_t *keys, size_t n);
+/*! \brief batched lookup with software prefetching; result[i] is set for each key and the number of positives is returned */
+size_t crpx_bloom_filter_contains_uint64_array (crpx_bloom_filter_t bf, const uint64_t *keys, size_t n, bool *result);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
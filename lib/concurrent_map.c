@@ -0,0 +1,179 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file concurrent_map.c
+ *  \brief lock-free counting map: a slot, once claimed by a key, never changes key (there is no deletion), thus a
+ *  reader that sees a key can safely increment its counter. Uses gcc's __atomic builtins, which are compatible with
+ *  OpenMP threads. */
+
+#include "concurrent_map.h"
+
+#define CMAP_EMPTY UINT64_MAX
+#define CMAP_MIN_CAPACITY 1024 /* s.t. threads racing to insert beyond max_size still find empty slots */
+#define CMAP_BATCH 16
+
+static inline uint64_t
+cmap_slot (crpx_concurrent_map_t map, uint64_t key)
+{
+  return crpx_hashint_murmurmix64 (key) & (map->capacity - 1);
+}
+
+static bool
+cmap_allocate (crpx_concurrent_map_t map, uint64_t n_keys)
+{
+  map->capacity = CMAP_MIN_CAPACITY;
+  while (map->capacity - map->capacity / 8 < n_keys) map->capacity <<= 1;
+  map->max_size = map->capacity - map->capacity / 8;
+  map->key   = (uint64_t *) crpx_malloc (map->cglob, map->capacity * sizeof (uint64_t));
+  map->count = (uint32_t *) crpx_calloc (map->cglob, map->capacity, sizeof (uint32_t));
+  if (!map->key || !map->count) {
+    crpx_logger_error (map->cglob, "concurrent_map: could not allocate map with %lu slots", map->capacity);
+    if (map->key)   crpx_free (map->cglob, map->key);
+    if (map->count) crpx_free (map->cglob, map->count);
+    map->key = NULL;
+    map->count = NULL;
+    return false;
+  }
+  memset (map->key, 0xff, map->capacity * sizeof (uint64_t)); // all slots are CMAP_EMPTY
+  map->size = 0;
+  return true;
+}
+
+crpx_concurrent_map_t
+new_crpx_concurrent_map (crpx_global_t cglob, uint64_t n_keys)
+{
+  crpx_concurrent_map_t map = (crpx_concurrent_map_t) crpx_malloc (cglob, sizeof (crpx_concurrent_map_struct));
+  if (!map) return NULL;
+  map->cglob = cglob;
+  map->count_of_max_key = 0;
+  map->has_max_key = false;
+  if (!cmap_allocate (map, n_keys)) { free (map); return NULL; }
+  crpx_link_add_global_pointer (cglob, map->cglob); // thread-safe increase of ref_counter
+  return map;
+}
+
+void
+del_crpx_concurrent_map (crpx_concurrent_map_t map)
+{
+  if (!map) return;
+  if (map->key)   crpx_free (map->cglob, map->key);
+  if (map->count) crpx_free (map->cglob, map->count);
+  crpx_global_finalise (map->cglob); // it just decreases cglob->ref_counter
+  free (map);
+}
+
+void
+crpx_concurrent_map_clear (crpx_concurrent_map_t map)
+{
+  memset (map->key, 0xff, map->capacity * sizeof (uint64_t));
+  memset (map->count, 0, map->capacity * sizeof (uint32_t));
+  map->size = 0;
+  map->count_of_max_key = 0;
+  map->has_max_key = false;
+}
+
+bool
+crpx_concurrent_map_add (crpx_concurrent_map_t map, uint64_t key, uint32_t delta)
+{
+  uint64_t i = cmap_slot (map, key), mask = map->capacity - 1, k;
+  if (key == CMAP_EMPTY) { // key used as empty marker is stored outside table
+    __atomic_fetch_add (&map->count_of_max_key, delta, __ATOMIC_RELAXED);
+    __atomic_store_n (&map->has_max_key, true, __ATOMIC_RELAXED);
+    return true;
+  }
+  for (;; i = (i + 1) & mask) {
+    k = __atomic_load_n (&map->key[i], __ATOMIC_ACQUIRE);
+    if (k == CMAP_EMPTY) {
+      if (__atomic_load_n (&map->size, __ATOMIC_RELAXED) >= map->max_size) return false; // map is full
+      if (__atomic_compare_exchange_n (&map->key[i], &k, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add (&map->size, 1, __ATOMIC_RELAXED);
+        k = key;
+      } // if CAS fails, k has the key stored by another thread (which may be the same key)
+    }
+    if (k == key) {
+      __atomic_fetch_add (&map->count[i], delta, __ATOMIC_RELAXED);
+      return true;
+    }
+  }
+}
+
+bool
+crpx_concurrent_map_add_array (crpx_concurrent_map_t map, const uint64_t *keys, size_t n)
+{
+  size_t i;
+  bool success = true;
+#pragma omp parallel for schedule(static) reduction(&&:success)
+  for (i = 0; i < n; i += CMAP_BATCH) {
+    size_t j, m = CRPX_MIN (CMAP_BATCH, n - i);
+    for (j = 0; j < m; j++) __builtin_prefetch (map->key + cmap_slot (map, keys[i+j]), 1, 3);
+    for (j = 0; j < m; j++) success = crpx_concurrent_map_add (map, keys[i+j], 1) && success;
+  }
+  return success;
+}
+
+uint32_t
+crpx_concurrent_map_get (crpx_concurrent_map_t map, uint64_t key)
+{
+  uint64_t i = cmap_slot (map, key), mask = map->capacity - 1, k;
+  if (key == CMAP_EMPTY) return __atomic_load_n (&map->count_of_max_key, __ATOMIC_RELAXED);
+  for (;; i = (i + 1) & mask) {
+    k = __atomic_load_n (&map->key[i], __ATOMIC_ACQUIRE);
+    if (k == key) return __atomic_load_n (&map->count[i], __ATOMIC_RELAXED);
+    if (k == CMAP_EMPTY) return 0;
+  }
+}
+
+bool
+crpx_concurrent_map_next (crpx_concurrent_map_t map, uint64_t *iter, uint64_t *key, uint32_t *count)
+{
+  uint64_t i = *iter;
+  for (; i < map->capacity; i++) if (map->key[i] != CMAP_EMPTY) {
+    if (key)   *key   = map->key[i];
+    if (count) *count = map->count[i];
+    *iter = i + 1;
+    return true;
+  }
+  if ((i == map->capacity) && map->has_max_key) { // last element is the key UINT64_MAX
+    if (key)   *key   = CMAP_EMPTY;
+    if (count) *count = map->count_of_max_key;
+    *iter = i + 1;
+    return true;
+  }
+  *iter = map->capacity + 1;
+  return false;
+}
+
+bool
+crpx_concurrent_map_resize (crpx_concurrent_map_t map, uint64_t n_keys)
+{
+  uint64_t *old_key = map->key, i, j, old_capacity = map->capacity, old_size = map->size;
+  uint32_t *old_count = map->count;
+  if (n_keys < map->size) n_keys = map->size;
+  if (!cmap_allocate (map, n_keys)) {
+    map->key = old_key;
+    map->count = old_count;
+    map->capacity = old_capacity;
+    map->max_size = old_capacity - old_capacity / 8;
+    map->size = old_size;
+    return false;
+  }
+  for (i = 0; i < old_capacity; i++) if (old_key[i] != CMAP_EMPTY) {
+    for (j = cmap_slot (map, old_key[i]); map->key[j] != CMAP_EMPTY; j = (j + 1) & (map->capacity - 1));
+    map->key[j] = old_key[i];
+    map->count[j] = old_count[i];
+  }
+  map->size = old_size;
+  crpx_free (map->cglob, old_key);
+  crpx_free (map->cglob, old_count);
+  return true;
+}
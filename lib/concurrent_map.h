@@ -0,0 +1,56 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file concurrent_map.h
+ *  \brief lock-free map from uint64_t keys to uint32_t counters (e.g. parallel k-mer counting), with linear probing.
+ *  Keys are claimed with compare-and-swap and counters are incremented with atomic fetch-add, thus many OpenMP threads
+ *  can update it at the same time. Capacity is fixed; crpx_concurrent_map_resize() must be called outside parallel regions. */
+
+#ifndef _curupixa_concurrent_map_h_
+#define _curupixa_concurrent_map_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint64_t *key;     /*!< \brief key of each slot, or UINT64_MAX if empty */
+  uint32_t *count;
+  uint64_t capacity, /*!< \brief power of two */
+           max_size, /*!< \brief maximum number of keys (load factor of 0.875) */
+           size;     /*!< \brief number of keys, updated atomically */
+  uint32_t count_of_max_key; /*!< \brief counter of key UINT64_MAX, which is the empty marker */
+  bool has_max_key;
+  crpx_global_t cglob;
+} crpx_concurrent_map_struct, *crpx_concurrent_map_t;
+
+/*! \brief new map with room for at least n_keys; returns NULL if allocation fails */
+crpx_concurrent_map_t new_crpx_concurrent_map (crpx_global_t cglob, uint64_t n_keys);
+void del_crpx_concurrent_map (crpx_concurrent_map_t map);
+void crpx_concurrent_map_clear (crpx_concurrent_map_t map);
+/*! \brief thread-safe: adds delta to counter of key, inserting it if absent. Returns false only if map is full */
+bool crpx_concurrent_map_add (crpx_concurrent_map_t map, uint64_t key, uint32_t delta);
+/*! \brief thread-safe: counts each key once, in parallel; returns false if map became full (some keys not counted) */
+bool crpx_concurrent_map_add_array (crpx_concurrent_map_t map, const uint64_t *keys, size_t n);
+/*! \brief returns counter of key (zero if absent); exact only after all updates are finished */
+uint32_t crpx_concurrent_map_get (crpx_concurrent_map_t map, uint64_t key);
+/*! \brief iterates over keys: start with *iter = 0 and call while it returns true (not thread-safe) */
+bool crpx_concurrent_map_next (crpx_concurrent_map_t map, uint64_t *iter, uint64_t *key, uint32_t *count);
+/*! \brief rehash into a map with room for n_keys (not thread-safe) */
+bool crpx_concurrent_map_resize (crpx_concurrent_map_t map, uint64_t n_keys);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
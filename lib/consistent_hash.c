@@ -0,0 +1,193 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file consistent_hash.c
+ *  \brief jump consistent hash and weighted rendezvous hashing for sharding keys across processes. */
+
+#include "consistent_hash.h"
+
+#define RENDEZVOUS_PARALLEL_MIN 4096 /* arrays smaller than this are assigned by a single thread */
+#define RENDEZVOUS_TOP_STACK 64       /* scores of up to this many top nodes are kept on the stack, others on the heap */
+
+int32_t
+crpx_jump_consistent_hash (uint64_t key, int32_t n_buckets)
+{ // linear congruential steps give the next bucket where the key would jump to, as the number of buckets grows
+  int64_t b = -1, j = 0;
+  if (n_buckets < 1) return 0;
+  while (j < n_buckets) {
+    b = j;
+    key = key * 2862933555777941757ULL + 1;
+    j = (int64_t) ((double) (b + 1) * ((double) (1LL << 31) / (double) ((key >> 33) + 1)));
+  }
+  return (int32_t) b;
+}
+
+inline int32_t
+crpx_jump_consistent_hash_seed (uint64_t key, uint64_t seed, int32_t n_buckets)
+{ // consecutive integers (e.g. k-mers or tree ids) must be mixed, since the LCG alone would correlate neighbours
+  return crpx_jump_consistent_hash (crpx_hashint_splitmix64 (key ^ seed), n_buckets);
+}
+
+void
+crpx_jump_consistent_hash_array (const uint64_t *key, size_t n, uint64_t seed, int32_t n_buckets, int32_t *bucket)
+{
+  int64_t i;
+#pragma omp parallel for schedule(static) if (n > RENDEZVOUS_PARALLEL_MIN)
+  for (i = 0; i < (int64_t) n; i++) bucket[i] = crpx_jump_consistent_hash_seed (key[i], seed, n_buckets);
+}
+
+crpx_rendezvous_t
+new_crpx_rendezvous (crpx_global_t cglob, uint64_t seed)
+{
+  crpx_rendezvous_t rdv = (crpx_rendezvous_t) crpx_malloc (cglob, sizeof (crpx_rendezvous_struct));
+  if (!rdv) return NULL;
+  rdv->n_nodes = 0;
+  rdv->n_alloc = 8;
+  rdv->seed = crpx_hashint_splitmix64 (seed);
+  rdv->equal_weights = true;
+  rdv->node_id = (uint64_t *) crpx_malloc (cglob, rdv->n_alloc * sizeof (uint64_t));
+  rdv->node_hash = (uint64_t *) crpx_malloc (cglob, rdv->n_alloc * sizeof (uint64_t));
+  rdv->inv_weight = (double *) crpx_malloc (cglob, rdv->n_alloc * sizeof (double));
+  rdv->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, rdv->cglob);
+  if (!rdv->node_id || !rdv->node_hash || !rdv->inv_weight) { del_crpx_rendezvous (rdv); return NULL; }
+  return rdv;
+}
+
+void
+del_crpx_rendezvous (crpx_rendezvous_t rdv)
+{
+  if (!rdv) return;
+  if (rdv->node_id) crpx_free (rdv->cglob, rdv->node_id);
+  if (rdv->node_hash) crpx_free (rdv->cglob, rdv->node_hash);
+  if (rdv->inv_weight) crpx_free (rdv->cglob, rdv->inv_weight);
+  crpx_global_finalise (rdv->cglob);
+  free (rdv);
+}
+
+static void
+rendezvous_update_equal_weights (crpx_rendezvous_t rdv)
+{
+  uint32_t i;
+  rdv->equal_weights = true;
+  for (i = 1; (i < rdv->n_nodes) && rdv->equal_weights; i++) rdv->equal_weights = (rdv->inv_weight[i] == rdv->inv_weight[0]);
+}
+
+bool
+crpx_rendezvous_add_node (crpx_rendezvous_t rdv, uint64_t node_id, double weight)
+{
+  uint32_t i;
+  if (!(weight > 0.) || isinf (weight)) { crpx_logger_error (rdv->cglob, "crpx_rendezvous_add_node: weight must be positive and finite"); return false; }
+  for (i = 0; i < rdv->n_nodes; i++) if (rdv->node_id[i] == node_id) return false;
+  if (rdv->n_nodes == rdv->n_alloc) { // arrays that grew are kept, but n_alloc only changes if all three succeed
+    uint64_t *id, *hash;
+    double *inv_w;
+    if (!(id = (uint64_t *) crpx_realloc (rdv->cglob, rdv->node_id, 2 * rdv->n_alloc * sizeof (uint64_t)))) return false;
+    rdv->node_id = id;
+    if (!(hash = (uint64_t *) crpx_realloc (rdv->cglob, rdv->node_hash, 2 * rdv->n_alloc * sizeof (uint64_t)))) return false;
+    rdv->node_hash = hash;
+    if (!(inv_w = (double *) crpx_realloc (rdv->cglob, rdv->inv_weight, 2 * rdv->n_alloc * sizeof (double)))) return false;
+    rdv->inv_weight = inv_w;
+    rdv->n_alloc *= 2;
+  }
+  rdv->node_id[rdv->n_nodes] = node_id;
+  rdv->node_hash[rdv->n_nodes] = crpx_hashint_nasam64 (node_id ^ rdv->seed);
+  rdv->inv_weight[rdv->n_nodes++] = 1. / weight;
+  rendezvous_update_equal_weights (rdv);
+  return true;
+}
+
+bool
+crpx_rendezvous_remove_node (crpx_rendezvous_t rdv, uint64_t node_id)
+{ // order of nodes is irrelevant, thus last node takes its place
+  uint32_t i;
+  for (i = 0; (i < rdv->n_nodes) && (rdv->node_id[i] != node_id); i++);
+  if (i == rdv->n_nodes) return false;
+  rdv->n_nodes--;
+  rdv->node_id[i] = rdv->node_id[rdv->n_nodes];
+  rdv->node_hash[i] = rdv->node_hash[rdv->n_nodes];
+  rdv->inv_weight[i] = rdv->inv_weight[rdv->n_nodes];
+  rendezvous_update_equal_weights (rdv);
+  return true;
+}
+
+static inline double
+rendezvous_score (crpx_rendezvous_t rdv, uint64_t key_hash, uint32_t i)
+{ /* smaller is better. With u uniform in (0,1), -log(u)/w is exponential with rate w, and the minimum over nodes
+   * falls on node i with probability w_i / sum(w). With equal weights only the order matters, and the 53 bits of u
+   * are exactly representable as a double */
+  uint64_t h = crpx_hashint_moremur64 (key_hash ^ rdv->node_hash[i]) >> 11;
+  if (rdv->equal_weights) return -(double) h;
+  return -log (((double) h + 0.5) * 0x1p-53) * rdv->inv_weight[i];
+}
+
+static inline bool
+rendezvous_better (double score_a, uint64_t id_a, double score_b, uint64_t id_b)
+{ // ties are decided by node id, so that the result does not depend on the order of nodes
+  return (score_a < score_b) || ((score_a == score_b) && (id_a < id_b));
+}
+
+uint64_t
+crpx_rendezvous_node (crpx_rendezvous_t rdv, uint64_t key)
+{
+  uint64_t key_hash = crpx_hashint_splitmix64 (key ^ rdv->seed), h, best_h = 0;
+  uint32_t i, best = 0;
+  double score, best_score = HUGE_VAL;
+  if (!rdv->n_nodes) { crpx_logger_error (rdv->cglob, "crpx_rendezvous_node: no nodes available"); return 0; }
+  if (rdv->equal_weights) { // integer comparisons only, in the same order as rendezvous_score()
+    for (i = 0; i < rdv->n_nodes; i++) {
+      h = crpx_hashint_moremur64 (key_hash ^ rdv->node_hash[i]) >> 11;
+      if ((h > best_h) || (!i) || ((h == best_h) && (rdv->node_id[i] < rdv->node_id[best]))) { best_h = h; best = i; }
+    }
+    return rdv->node_id[best];
+  }
+  for (i = 0; i < rdv->n_nodes; i++) {
+    score = rendezvous_score (rdv, key_hash, i);
+    if ((!i) || rendezvous_better (score, rdv->node_id[i], best_score, rdv->node_id[best])) { best_score = score; best = i; }
+  }
+  return rdv->node_id[best];
+}
+
+uint32_t
+crpx_rendezvous_top_nodes (crpx_rendezvous_t rdv, uint64_t key, uint32_t n_top, uint64_t *out)
+{ // insertion sort into out[], keeping only the best n_top
+  uint64_t key_hash = crpx_hashint_splitmix64 (key ^ rdv->seed);
+  uint32_t i, j, n_out = 0;
+  double score, stack_score[RENDEZVOUS_TOP_STACK], *top_score = stack_score;
+  n_top = CRPX_MIN (n_top, rdv->n_nodes);
+  if (n_top > RENDEZVOUS_TOP_STACK) {
+    top_score = (double *) crpx_malloc (rdv->cglob, n_top * sizeof (double));
+    if (!top_score) { crpx_logger_error (rdv->cglob, "crpx_rendezvous_top_nodes: could not allocate %u scores", n_top); return 0; }
+  }
+  for (i = 0; i < rdv->n_nodes; i++) {
+    score = rendezvous_score (rdv, key_hash, i);
+    for (j = n_out; (j > 0) && rendezvous_better (score, rdv->node_id[i], top_score[j-1], out[j-1]); j--) if (j < n_top) {
+      top_score[j] = top_score[j-1];
+      out[j] = out[j-1];
+    }
+    if (j < n_top) { top_score[j] = score; out[j] = rdv->node_id[i]; }
+    if (n_out < n_top) n_out++;
+  }
+  if (top_score != stack_score) crpx_free (rdv->cglob, top_score);
+  return n_out;
+}
+
+void
+crpx_rendezvous_node_array (crpx_rendezvous_t rdv, const uint64_t *key, size_t n, uint64_t *node)
+{
+  int64_t i;
+  if (!rdv->n_nodes) { crpx_logger_error (rdv->cglob, "crpx_rendezvous_node_array: no nodes available"); return; }
+#pragma omp parallel for schedule(static) if (n > RENDEZVOUS_PARALLEL_MIN)
+  for (i = 0; i < (int64_t) n; i++) node[i] = crpx_rendezvous_node (rdv, key[i]);
+}
@@ -0,0 +1,67 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file consistent_hash.h
+ *  \brief consistent hashing of keys into shards (e.g. k-mers or trees distributed over worker processes or machines),
+ *  s.t. changing the number of shards only moves about 1/n of the keys, instead of reshuffling almost all of them
+ *  like key % n. Jump consistent hash (Lamping and Veach 2014) needs no memory but shards must be numbered 0...n-1 and
+ *  only the last one can be removed; weighted rendezvous (highest random weight) hashing (Thaler and Ravishankar 1998,
+ *  with logarithmic scores of Schindelhauer and Schomaker 2005) accepts arbitrary node ids and capacities, and any node
+ *  can be added or removed, at O(n_nodes) per key. Both only depend on key, seed and shards, thus independent processes
+ *  agree on the assignment without communication. */
+
+#ifndef _curupixa_consistent_hash_h_
+#define _curupixa_consistent_hash_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint64_t *node_id;    /*!< \brief user-defined node identifiers, returned by the lookup functions */
+  uint64_t *node_hash;  /*!< \brief mixed node ids, combined with each key hash */
+  double *inv_weight;   /*!< \brief 1/weight of each node; node with smallest -log(u)/weight wins */
+  uint32_t n_nodes, n_alloc;
+  uint64_t seed;
+  bool equal_weights;   /*!< \brief if all weights are the same, the largest hash wins and no logarithm is needed */
+  crpx_global_t cglob;
+} crpx_rendezvous_struct, *crpx_rendezvous_t;
+
+/*! \brief shard (from 0 to n_buckets-1) of key, as in Lamping and Veach; key should already be well mixed */
+int32_t crpx_jump_consistent_hash (uint64_t key, int32_t n_buckets);
+/*! \brief shard of arbitrary integer key, which is mixed with seed before the jump hash */
+extern int32_t crpx_jump_consistent_hash_seed (uint64_t key, uint64_t seed, int32_t n_buckets);
+/*! \brief bucket[i] = crpx_jump_consistent_hash_seed (key[i], seed, n_buckets) for n keys, in parallel */
+void crpx_jump_consistent_hash_array (const uint64_t *key, size_t n, uint64_t seed, int32_t n_buckets, int32_t *bucket);
+
+/*! \brief rendezvous table without nodes; all processes must use the same seed */
+crpx_rendezvous_t new_crpx_rendezvous (crpx_global_t cglob, uint64_t seed);
+void del_crpx_rendezvous (crpx_rendezvous_t rdv);
+/*! \brief adds node with relative capacity weight (> 0); returns false if node_id is already present */
+bool crpx_rendezvous_add_node (crpx_rendezvous_t rdv, uint64_t node_id, double weight);
+/*! \brief removes node; only keys assigned to it will move. Returns false if node_id is not present */
+bool crpx_rendezvous_remove_node (crpx_rendezvous_t rdv, uint64_t node_id);
+/*! \brief node_id of the node owning key. The result does not depend on the order in which nodes were added */
+uint64_t crpx_rendezvous_node (crpx_rendezvous_t rdv, uint64_t key);
+/*! \brief node_ids of the n_top preferred nodes for key, in decreasing order of preference (e.g. for replicas). Returns
+ *  the number of nodes stored in out, which is the minimum between n_top and the number of nodes */
+uint32_t crpx_rendezvous_top_nodes (crpx_rendezvous_t rdv, uint64_t key, uint32_t n_top, uint64_t *out);
+/*! \brief node[i] = crpx_rendezvous_node (rdv, key[i]) for n keys, in parallel */
+void crpx_rendezvous_node_array (crpx_rendezvous_t rdv, const uint64_t *key, size_t n, uint64_t *node);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
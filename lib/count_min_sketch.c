@@ -0,0 +1,337 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file count_min_sketch.c
+ *  \brief count-min sketch with conservative update and saturating counters. Row indices are h0 + i * h1 from the two
+ *  halves of crpx_murmurhash3_128bits(), reduced to the row width by Lemire's multiply-shift. */
+
+#include "count_min_sketch.h"
+
+#define CMS_BATCH (1UL << 16) /* keys per batch in bulk update; batch index must fit in 16 bits */
+
+typedef struct {
+  uint64_t key;
+  uint64_t count;
+} cms_key_count_t;
+
+static void cms_merge_counters (crpx_count_min_sketch_t dst, crpx_count_min_sketch_t src, bool use_max);
+
+static inline void
+cms_add_total (crpx_count_min_sketch_t cms, uint64_t count)
+{ // saturating, like the counters
+  if (__builtin_add_overflow (cms->total, count, &cms->total)) cms->total = UINT64_MAX;
+}
+static int compare_uint64_increasing (const void *a, const void *b);
+static int compare_cms_key_count_increasing (const void *a, const void *b);
+
+crpx_count_min_sketch_t
+new_crpx_count_min_sketch (crpx_global_t cglob, uint64_t width, uint8_t depth, uint8_t counter_bits, bool conservative, uint32_t seed)
+{
+  if ((counter_bits != 8) && (counter_bits != 16) && (counter_bits != 32)) {
+    crpx_logger_error (cglob, "new_crpx_count_min_sketch: counters must have 8, 16 or 32 bits, not %u", counter_bits);
+    return NULL;
+  }
+  if (!depth || (depth > CRPX_CMS_MAX_DEPTH) || !width || (width > (1ULL << 40))) {
+    crpx_logger_error (cglob, "new_crpx_count_min_sketch: invalid dimensions (width %lu and depth %u)", width, depth);
+    return NULL;
+  }
+  crpx_count_min_sketch_t cms = (crpx_count_min_sketch_t) crpx_malloc (cglob, sizeof (crpx_count_min_sketch_struct));
+  if (!cms) return NULL;
+  cms->counter = crpx_calloc (cglob, width * depth, counter_bits / 8);
+  if (!cms->counter) { free (cms); return NULL; }
+  cms->width = width;
+  cms->depth = depth;
+  cms->counter_bits = counter_bits;
+  cms->max_count = (counter_bits == 32) ? UINT32_MAX : (1U << counter_bits) - 1;
+  cms->conservative = conservative;
+  cms->seed = seed;
+  cms->total = 0;
+  cms->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, cms->cglob); // thread-safe increase of ref_counter
+  return cms;
+}
+
+crpx_count_min_sketch_t
+new_crpx_count_min_sketch_like (crpx_count_min_sketch_t cms)
+{
+  return new_crpx_count_min_sketch (cms->cglob, cms->width, cms->depth, cms->counter_bits, cms->conservative, cms->seed);
+}
+
+void
+del_crpx_count_min_sketch (crpx_count_min_sketch_t cms)
+{
+  if (!cms) return;
+  if (cms->counter) crpx_free (cms->cglob, cms->counter);
+  crpx_global_finalise (cms->cglob); // it just decreases cglob->ref_counter
+  free (cms);
+}
+
+void
+crpx_count_min_sketch_reset (crpx_count_min_sketch_t cms)
+{
+  memset (cms->counter, 0, cms->width * cms->depth * (cms->counter_bits / 8));
+  cms->total = 0;
+}
+
+static inline uint32_t
+cms_get (crpx_count_min_sketch_t cms, uint64_t pos)
+{
+  switch (cms->counter_bits) {
+    case 8:  return cms->c8[pos];
+    case 16: return cms->c16[pos];
+    default: return cms->c32[pos];
+  }
+}
+
+static inline void
+cms_set (crpx_count_min_sketch_t cms, uint64_t pos, uint32_t value)
+{ // value must be at most cms->max_count
+  switch (cms->counter_bits) {
+    case 8:  cms->c8[pos]  = (uint8_t) value; break;
+    case 16: cms->c16[pos] = (uint16_t) value; break;
+    default: cms->c32[pos] = value;
+  }
+}
+
+static inline uint32_t
+cms_saturated_sum (crpx_count_min_sketch_t cms, uint32_t a, uint64_t b)
+{
+  return (uint32_t) CRPX_MIN ((uint64_t) a + b, (uint64_t) cms->max_count);
+}
+
+static inline uint64_t
+cms_row_index (crpx_count_min_sketch_t cms, const uint64_t *hash, uint8_t row)
+{ // double hashing h0 + i*h1 (h1 odd), followed by fast range reduction
+  uint64_t h = hash[0] + (uint64_t) row * (hash[1] | 1ULL);
+  return (uint64_t)(((__uint128_t) h * (__uint128_t) cms->width) >> 64);
+}
+
+static inline void
+cms_update (crpx_count_min_sketch_t cms, const uint64_t *hash, uint64_t count)
+{
+  uint64_t pos[CRPX_CMS_MAX_DEPTH];
+  uint32_t min = UINT32_MAX, x;
+  uint8_t r;
+  cms_add_total (cms, count);
+  if (!cms->conservative) {
+    for (r = 0; r < cms->depth; r++) {
+      pos[r] = r * cms->width + cms_row_index (cms, hash, r);
+      cms_set (cms, pos[r], cms_saturated_sum (cms, cms_get (cms, pos[r]), count));
+    }
+    return;
+  }
+  for (r = 0; r < cms->depth; r++) {
+    pos[r] = r * cms->width + cms_row_index (cms, hash, r);
+    if ((x = cms_get (cms, pos[r])) < min) min = x;
+  }
+  min = cms_saturated_sum (cms, min, count); // only counters below new minimum are raised
+  for (r = 0; r < cms->depth; r++) if (cms_get (cms, pos[r]) < min) cms_set (cms, pos[r], min);
+}
+
+static inline uint32_t
+cms_query (crpx_count_min_sketch_t cms, const uint64_t *hash)
+{
+  uint32_t min = UINT32_MAX, x;
+  for (uint8_t r = 0; r < cms->depth; r++) if ((x = cms_get (cms, r * cms->width + cms_row_index (cms, hash, r))) < min) min = x;
+  return min;
+}
+
+void
+crpx_count_min_sketch_add (crpx_count_min_sketch_t cms, const void *key, size_t len, uint32_t count)
+{
+  uint64_t hash[2];
+  crpx_murmurhash3_128bits (key, len, cms->seed, hash);
+  cms_update (cms, hash, count);
+}
+
+void
+crpx_count_min_sketch_add_uint64 (crpx_count_min_sketch_t cms, uint64_t key, uint32_t count)
+{
+  uint64_t hash[2];
+  crpx_murmurhash3_128bits (&key, sizeof (uint64_t), cms->seed, hash);
+  cms_update (cms, hash, count);
+}
+
+uint32_t
+crpx_count_min_sketch_estimate (crpx_count_min_sketch_t cms, const void *key, size_t len)
+{
+  uint64_t hash[2];
+  crpx_murmurhash3_128bits (key, len, cms->seed, hash);
+  return cms_query (cms, hash);
+}
+
+uint32_t
+crpx_count_min_sketch_estimate_uint64 (crpx_count_min_sketch_t cms, uint64_t key)
+{
+  uint64_t hash[2];
+  crpx_murmurhash3_128bits (&key, sizeof (uint64_t), cms->seed, hash);
+  return cms_query (cms, hash);
+}
+
+bool
+crpx_count_min_sketch_add_uint64_array (crpx_count_min_sketch_t cms, const uint64_t *key, const uint32_t *count, size_t n)
+{ /* batches have at most CMS_BATCH distinct keys; entry[row][j] = (counter index << 16) | j is sorted within each row,
+   * s.t. each row is visited in increasing memory order. With conservative update the minimum of each key is taken
+   * before the batch is applied, which still gives upper bounds (all counters of a key are at least its true count) */
+  size_t start, i, j, m, r;
+  uint64_t hash[2];
+  cms_key_count_t *kc = (cms_key_count_t *) crpx_malloc (cms->cglob, CMS_BATCH * sizeof (cms_key_count_t));
+  uint64_t *entry = (uint64_t *) crpx_malloc (cms->cglob, CMS_BATCH * cms->depth * sizeof (uint64_t));
+  uint32_t *minimum = cms->conservative ? (uint32_t *) crpx_malloc (cms->cglob, CMS_BATCH * cms->depth * sizeof (uint32_t)) : NULL;
+  if (!kc || !entry || (cms->conservative && !minimum)) {
+    if (kc) crpx_free (cms->cglob, kc);
+    if (entry) crpx_free (cms->cglob, entry);
+    if (minimum) crpx_free (cms->cglob, minimum);
+    return false;
+  }
+
+  for (start = 0; start < n; start += CMS_BATCH) {
+    m = CRPX_MIN (n - start, CMS_BATCH);
+    for (i = 0; i < m; i++) { kc[i].key = key[start + i]; kc[i].count = count ? count[start + i] : 1; }
+    qsort (kc, m, sizeof (cms_key_count_t), compare_cms_key_count_increasing);
+    for (j = 0, i = 1; i < m; i++) { // aggregate counts of repeated keys
+      if (kc[i].key == kc[j].key) kc[j].count += kc[i].count;
+      else kc[++j] = kc[i];
+    }
+    m = j + 1;
+    for (i = 0; i < m; i++) cms_add_total (cms, kc[i].count);
+
+#pragma omp parallel for shared(cms, kc, entry, m) private(i, r, hash) schedule(static)
+    for (i = 0; i < m; i++) {
+      crpx_murmurhash3_128bits (&(kc[i].key), sizeof (uint64_t), cms->seed, hash);
+      for (r = 0; r < cms->depth; r++) entry[r * CMS_BATCH + i] = (cms_row_index (cms, hash, r) << 16) | i;
+    }
+
+#pragma omp parallel for shared(cms, kc, entry, minimum, m) private(i, r) schedule(dynamic, 1)
+    for (r = 0; r < cms->depth; r++) { // rows are independent, each is updated by one thread
+      uint64_t *e = entry + r * CMS_BATCH, row = r * cms->width;
+      qsort (e, m, sizeof (uint64_t), compare_uint64_increasing);
+      if (cms->conservative) for (i = 0; i < m; i++) minimum[r * CMS_BATCH + (e[i] & 0xffff)] = cms_get (cms, row + (e[i] >> 16));
+      else for (i = 0; i < m; i++) {
+        uint64_t pos = row + (e[i] >> 16);
+        cms_set (cms, pos, cms_saturated_sum (cms, cms_get (cms, pos), kc[e[i] & 0xffff].count));
+      }
+    }
+    if (!cms->conservative) continue;
+
+#pragma omp parallel for shared(cms, kc, minimum, m) private(i, r) schedule(static)
+    for (i = 0; i < m; i++) { // minimum[i] becomes the new value of all counters of key i
+      for (r = 1; r < cms->depth; r++) if (minimum[r * CMS_BATCH + i] < minimum[i]) minimum[i] = minimum[r * CMS_BATCH + i];
+      minimum[i] = cms_saturated_sum (cms, minimum[i], kc[i].count);
+    }
+#pragma omp parallel for shared(cms, entry, minimum, m) private(i, r) schedule(dynamic, 1)
+    for (r = 0; r < cms->depth; r++) {
+      uint64_t *e = entry + r * CMS_BATCH, row = r * cms->width;
+      for (i = 0; i < m; i++) {
+        uint64_t pos = row + (e[i] >> 16);
+        if (cms_get (cms, pos) < minimum[e[i] & 0xffff]) cms_set (cms, pos, minimum[e[i] & 0xffff]);
+      }
+    }
+  }
+
+  crpx_free (cms->cglob, kc);
+  crpx_free (cms->cglob, entry);
+  if (minimum) crpx_free (cms->cglob, minimum);
+  return true;
+}
+
+bool
+crpx_count_min_sketch_merge (crpx_count_min_sketch_t dst, crpx_count_min_sketch_t src, bool use_max)
+{
+  if ((dst->width != src->width) || (dst->depth != src->depth) || (dst->counter_bits != src->counter_bits) || (dst->seed != src->seed)) {
+    crpx_logger_error (dst->cglob, "crpx_count_min_sketch_merge: sketches must have same dimensions, counter size, and seed");
+    return false;
+  }
+  cms_merge_counters (dst, src, use_max);
+  if (use_max) dst->total = CRPX_MAX (dst->total, src->total);
+  else cms_add_total (dst, src->total);
+  return true;
+}
+
+static void
+cms_merge_counters (crpx_count_min_sketch_t dst, crpx_count_min_sketch_t src, bool use_max)
+{ // saturating add or max; there is no saturating add for 32 bits, thus overflow is detected as (a + b) < a
+  size_t i = 0, n = dst->width * dst->depth;
+#ifdef __AVX2__
+  if (dst->cglob->avx) {
+    const size_t step = 32 / (dst->counter_bits / 8);
+    for (; i + step <= n; i += step) {
+      __m256i a, b, c, s;
+      switch (dst->counter_bits) {
+        case 8:
+          a = _mm256_loadu_si256 ((const __m256i*)(dst->c8 + i)); b = _mm256_loadu_si256 ((const __m256i*)(src->c8 + i));
+          _mm256_storeu_si256 ((__m256i*)(dst->c8 + i), use_max ? _mm256_max_epu8 (a, b) : _mm256_adds_epu8 (a, b));
+          break;
+        case 16:
+          a = _mm256_loadu_si256 ((const __m256i*)(dst->c16 + i)); b = _mm256_loadu_si256 ((const __m256i*)(src->c16 + i));
+          _mm256_storeu_si256 ((__m256i*)(dst->c16 + i), use_max ? _mm256_max_epu16 (a, b) : _mm256_adds_epu16 (a, b));
+          break;
+        default:
+          a = _mm256_loadu_si256 ((const __m256i*)(dst->c32 + i)); b = _mm256_loadu_si256 ((const __m256i*)(src->c32 + i));
+          if (use_max) c = _mm256_max_epu32 (a, b);
+          else {
+            s = _mm256_add_epi32 (a, b);
+            c = _mm256_cmpeq_epi32 (_mm256_max_epu32 (s, a), s); // all ones where there was no overflow
+            c = _mm256_or_si256 (s, _mm256_xor_si256 (c, _mm256_set1_epi32 (-1)));
+          }
+          _mm256_storeu_si256 ((__m256i*)(dst->c32 + i), c);
+      }
+    }
+  }
+#endif
+#ifdef __SSE4_2__
+  if (dst->cglob->sse) {
+    const size_t step = 16 / (dst->counter_bits / 8);
+    for (; i + step <= n; i += step) {
+      __m128i a, b, c, s;
+      switch (dst->counter_bits) {
+        case 8:
+          a = _mm_loadu_si128 ((const __m128i*)(dst->c8 + i)); b = _mm_loadu_si128 ((const __m128i*)(src->c8 + i));
+          _mm_storeu_si128 ((__m128i*)(dst->c8 + i), use_max ? _mm_max_epu8 (a, b) : _mm_adds_epu8 (a, b));
+          break;
+        case 16:
+          a = _mm_loadu_si128 ((const __m128i*)(dst->c16 + i)); b = _mm_loadu_si128 ((const __m128i*)(src->c16 + i));
+          _mm_storeu_si128 ((__m128i*)(dst->c16 + i), use_max ? _mm_max_epu16 (a, b) : _mm_adds_epu16 (a, b));
+          break;
+        default:
+          a = _mm_loadu_si128 ((const __m128i*)(dst->c32 + i)); b = _mm_loadu_si128 ((const __m128i*)(src->c32 + i));
+          if (use_max) c = _mm_max_epu32 (a, b);
+          else {
+            s = _mm_add_epi32 (a, b);
+            c = _mm_cmpeq_epi32 (_mm_max_epu32 (s, a), s);
+            c = _mm_or_si128 (s, _mm_xor_si128 (c, _mm_set1_epi32 (-1)));
+          }
+          _mm_storeu_si128 ((__m128i*)(dst->c32 + i), c);
+      }
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    uint32_t a = cms_get (dst, i), b = cms_get (src, i);
+    cms_set (dst, i, use_max ? CRPX_MAX (a, b) : cms_saturated_sum (dst, a, b));
+  }
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+static int
+compare_cms_key_count_increasing (const void *a, const void *b)
+{
+  uint64_t x = ((const cms_key_count_t *) a)->key, y = ((const cms_key_count_t *) b)->key;
+  return (x > y) - (x < y);
+}
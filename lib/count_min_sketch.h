@@ -0,0 +1,68 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file count_min_sketch.h
+ *  \brief count-min sketch (Cormode and Muthukrishnan 2005) for approximate abundances, e.g. of k-mers. The d row
+ *  indices come from a single 128-bit hash by double hashing (Kirsch and Mitzenmacher 2006); counters have 8, 16 or 32
+ *  bits and saturate at their maximum; conservative update (Estan and Varghese 2002) reduces overestimation. */
+
+#ifndef _curupixa_count_min_sketch_h_
+#define _curupixa_count_min_sketch_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+#define CRPX_CMS_MAX_DEPTH 32
+
+typedef struct {
+  union {
+    uint8_t  *c8;
+    uint16_t *c16;
+    uint32_t *c32;
+    void     *counter; /*!< \brief depth x width counters, one row after the other */
+  };
+  uint64_t width;        /*!< \brief counters per row (error is about total/width) */
+  uint64_t total;        /*!< \brief sum of all increments (saturating) */
+  uint32_t seed, max_count; /*!< \brief max_count is the saturation value (2^counter_bits - 1) */
+  uint8_t depth,         /*!< \brief number of rows (failure probability is about exp(-depth)) */
+          counter_bits;  /*!< \brief 8, 16 or 32 */
+  bool conservative;     /*!< \brief conservative update: only the minimal counters of an element are increased */
+  crpx_global_t cglob;
+} crpx_count_min_sketch_struct, *crpx_count_min_sketch_t;
+
+/*! \brief new sketch with depth rows of width counters, each with counter_bits (8, 16 or 32) bits. Its memory does not
+ *  change with the number of elements added. Returns NULL in case of error */
+crpx_count_min_sketch_t new_crpx_count_min_sketch (crpx_global_t cglob, uint64_t width, uint8_t depth, uint8_t counter_bits, bool conservative, uint32_t seed);
+/*! \brief empty sketch with same dimensions and seed as cms, e.g. to be used by another thread and merged later */
+crpx_count_min_sketch_t new_crpx_count_min_sketch_like (crpx_count_min_sketch_t cms);
+void del_crpx_count_min_sketch (crpx_count_min_sketch_t cms);
+void crpx_count_min_sketch_reset (crpx_count_min_sketch_t cms);
+/*! \brief add count to element key of length len (bytes) */
+void crpx_count_min_sketch_add (crpx_count_min_sketch_t cms, const void *key, size_t len, uint32_t count);
+void crpx_count_min_sketch_add_uint64 (crpx_count_min_sketch_t cms, uint64_t key, uint32_t count);
+/*! \brief batched update of n integer keys (count=NULL means one per key). Keys are sorted and aggregated, and then
+ *  counters are updated row by row in increasing order, in parallel over rows. Uses a fixed amount of extra memory */
+bool crpx_count_min_sketch_add_uint64_array (crpx_count_min_sketch_t cms, const uint64_t *key, const uint32_t *count, size_t n);
+/*! \brief upper bound for the count of key (minimum over rows) */
+uint32_t crpx_count_min_sketch_estimate (crpx_count_min_sketch_t cms, const void *key, size_t len);
+uint32_t crpx_count_min_sketch_estimate_uint64 (crpx_count_min_sketch_t cms, uint64_t key);
+/*! \brief dst = dst + src (saturating), or elementwise maximum if use_max is true; both must have same dimensions and
+ *  seed. After merging by sum, conservative-update sketches are still upper bounds, but less tight */
+bool crpx_count_min_sketch_merge (crpx_count_min_sketch_t dst, crpx_count_min_sketch_t src, bool use_max);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
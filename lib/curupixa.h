@@ -25,6 +25,23 @@ extern "C" {
 
 #include "global/global_variable.h"
 #include "index_arrangement.h"
+#include "hyperloglog.h"
+#include "frac_minhash.h"
+#include "bloom_filter.h"
+#include "fuse_filter.h"
+#include "hashtable.h"
+#include "concurrent_map.h"
+#include "kmer_encoding.h"
+#include "kmer_counter.h"
+#include "kmer_store.h"
+#include "protein_kmer.h"
+#include "count_min_sketch.h"
+#include "split_hash.h"
+#include "multiset_hash.h"
+#include "perfect_hash.h"
+#include "hash_family.h"
+#include "consistent_hash.h"
+#include "lsh_index.h"
 #include "quasi_random.c"
 
 #ifdef __cplusplus
@@ -0,0 +1,278 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file frac_minhash.c
+ *  \brief FracMinHash sketches; pending hashes are sorted and merged in place into the sketch, as in the sparse mode
+ *  of hyperloglog.c */
+
+#include "frac_minhash.h"
+
+#define FMH_MIN_BUFFER 1024
+#define FMH_CHUNK 4096UL /* number of k-mers encoded and hashed at once from a sequence */
+
+static bool fmh_reserve (crpx_frac_minhash_t fmh, size_t n);
+static void fmh_grow_buffer (crpx_frac_minhash_t fmh, size_t max_buffer);
+static size_t fmh_filter_threshold (crpx_global_t cglob, const uint64_t *hash, size_t n, uint64_t threshold, uint64_t *out);
+static size_t fmh_intersection_size (crpx_global_t cglob, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+static bool fmh_compatible (crpx_frac_minhash_t a, crpx_frac_minhash_t b, const char *func);
+static int compare_uint64_increasing (const void *a, const void *b);
+
+crpx_frac_minhash_t
+new_crpx_frac_minhash (crpx_global_t cglob, uint8_t k, uint64_t scale, uint64_t seed)
+{
+  if ((k < 1) || (k > CRPX_KMER_MAX_K) || (scale < 1)) {
+    crpx_logger_error (cglob, "new_crpx_frac_minhash: k must be between 1 and %d, and scale positive (k=%u, scale=%lu)", CRPX_KMER_MAX_K, k, scale);
+    return NULL;
+  }
+  crpx_frac_minhash_t fmh = (crpx_frac_minhash_t) crpx_malloc (cglob, sizeof (crpx_frac_minhash_struct));
+  if (!fmh) return NULL;
+  fmh->k = k;
+  fmh->scale = scale;
+  fmh->threshold = UINT64_MAX / scale;
+  fmh->seed = seed;
+  fmh->n_hash = fmh->n_buffer = fmh->max_hash = 0;
+  fmh->max_buffer = FMH_MIN_BUFFER;
+  fmh->hash = (uint64_t *) crpx_malloc (cglob, fmh->max_buffer * sizeof (uint64_t));
+  fmh->buffer = (uint64_t *) crpx_malloc (cglob, fmh->max_buffer * sizeof (uint64_t));
+  fmh->cglob = cglob; // linked (ref_counter increased) only at the end, since del_() would decrease it
+  if (!fmh->hash || !fmh->buffer) { fmh->cglob = NULL; del_crpx_frac_minhash (fmh); return NULL; }
+  crpx_link_add_global_pointer (cglob, fmh->cglob); // thread-safe increase of ref_counter
+  return fmh;
+}
+
+void
+del_crpx_frac_minhash (crpx_frac_minhash_t fmh)
+{
+  if (!fmh) return;
+  if (fmh->hash)   crpx_free (fmh->cglob, fmh->hash);
+  if (fmh->buffer) crpx_free (fmh->cglob, fmh->buffer);
+  crpx_global_finalise (fmh->cglob); // it just decreases cglob->ref_counter
+  free (fmh);
+}
+
+void
+crpx_frac_minhash_reset (crpx_frac_minhash_t fmh)
+{
+  fmh->n_hash = fmh->n_buffer = 0;
+}
+
+static bool
+fmh_reserve (crpx_frac_minhash_t fmh, size_t n)
+{ // hash[] must have room for n sorted hashes plus the whole buffer, s.t. both can be merged in place
+  if (n <= fmh->max_hash) return true;
+  size_t max_hash = CRPX_MAX (n, 2 * fmh->max_hash);
+  uint64_t *h = (uint64_t *) crpx_realloc (fmh->cglob, fmh->hash, (max_hash + fmh->max_buffer) * sizeof (uint64_t));
+  if (!h) return false;
+  fmh->hash = h;
+  fmh->max_hash = max_hash;
+  return true;
+}
+
+inline uint64_t
+crpx_frac_minhash_kmer_hash (crpx_frac_minhash_t fmh, uint64_t kmer)
+{
+  return crpx_hashint_murmurmix64 (kmer ^ fmh->seed);
+}
+
+inline void
+crpx_frac_minhash_add_hash (crpx_frac_minhash_t fmh, uint64_t hash)
+{
+  if (hash >= fmh->threshold) return;
+  fmh->buffer[fmh->n_buffer++] = hash;
+  if (fmh->n_buffer == fmh->max_buffer) crpx_frac_minhash_flush (fmh);
+}
+
+void
+crpx_frac_minhash_add_hash_array (crpx_frac_minhash_t fmh, const uint64_t *hash, size_t n)
+{ // the buffer has room for max_buffer hashes: each block passing the filter fills at most what is left
+  size_t m;
+  while (n) {
+    m = CRPX_MIN (n, fmh->max_buffer - fmh->n_buffer);
+    fmh->n_buffer += fmh_filter_threshold (fmh->cglob, hash, m, fmh->threshold, fmh->buffer + fmh->n_buffer);
+    if (fmh->n_buffer == fmh->max_buffer) crpx_frac_minhash_flush (fmh);
+    hash += m; n -= m;
+  }
+}
+
+void
+crpx_frac_minhash_add_sequence (crpx_frac_minhash_t fmh, const char *seq, size_t len)
+{ // overlapping chunks of FMH_CHUNK + k - 1 chars, s.t. no k-mer is lost or repeated
+  uint64_t kmers[FMH_CHUNK];
+  size_t start, n, i;
+  for (start = 0; start + fmh->k <= len; start += FMH_CHUNK) {
+    n = crpx_kmer_encode_sequence (seq + start, CRPX_MIN (FMH_CHUNK + fmh->k - 1, len - start), fmh->k, true, kmers);
+    for (i = 0; i < n; i++) kmers[i] = crpx_frac_minhash_kmer_hash (fmh, kmers[i]);
+    crpx_frac_minhash_add_hash_array (fmh, kmers, n);
+  }
+}
+
+void
+crpx_frac_minhash_flush (crpx_frac_minhash_t fmh)
+{
+  size_t i, j, k, n;
+  uint64_t *s, *b = fmh->buffer;
+  if (!fmh->n_buffer) return;
+  if (!fmh_reserve (fmh, fmh->n_hash + fmh->n_buffer)) {
+    crpx_logger_error (fmh->cglob, "crpx_frac_minhash_flush: could not allocate memory, %lu hashes lost", fmh->n_buffer);
+    fmh->n_buffer = 0;
+    return;
+  }
+  s = fmh->hash;
+  qsort (b, fmh->n_buffer, sizeof (uint64_t), compare_uint64_increasing);
+  /* merge backwards, in place, since hash[] has room for the buffer */
+  i = fmh->n_hash; j = fmh->n_buffer; n = k = fmh->n_hash + fmh->n_buffer;
+  while (j > 0) {
+    if ((i > 0) && (s[i-1] > b[j-1])) s[--k] = s[--i];
+    else                              s[--k] = b[--j];
+  }
+  for (i = 0, k = 0; i < n; i++) if ((i + 1 == n) || (s[i] != s[i+1])) s[k++] = s[i];
+  fmh->n_hash = k;
+  fmh->n_buffer = 0;
+  if (fmh->n_hash / 2 > fmh->max_buffer) fmh_grow_buffer (fmh, fmh->n_hash / 2);
+}
+
+static void
+fmh_grow_buffer (crpx_frac_minhash_t fmh, size_t max_buffer)
+{ // buffer grows with the sketch, otherwise each flush would cost O(n_hash) for a constant number of new hashes
+  uint64_t *h = (uint64_t *) crpx_realloc (fmh->cglob, fmh->hash, (fmh->max_hash + max_buffer) * sizeof (uint64_t));
+  if (!h) return; // not an error, since the current buffer can still be used
+  fmh->hash = h;
+  uint64_t *b = (uint64_t *) crpx_realloc (fmh->cglob, fmh->buffer, max_buffer * sizeof (uint64_t));
+  if (!b) return;
+  fmh->buffer = b;
+  fmh->max_buffer = max_buffer;
+}
+
+static bool
+fmh_compatible (crpx_frac_minhash_t a, crpx_frac_minhash_t b, const char *func)
+{
+  if ((a->k == b->k) && (a->scale == b->scale) && (a->seed == b->seed)) return true;
+  crpx_logger_error (a->cglob, "%s: sketches have different k, scale or seed", func);
+  return false;
+}
+
+bool
+crpx_frac_minhash_merge (crpx_frac_minhash_t dst, crpx_frac_minhash_t src)
+{
+  size_t i;
+  if (!fmh_compatible (dst, src, "crpx_frac_minhash_merge")) return false;
+  crpx_frac_minhash_flush (src);
+  for (i = 0; i < src->n_hash; i += dst->max_buffer) { // src hashes are already below threshold
+    size_t m = CRPX_MIN (dst->max_buffer, src->n_hash - i);
+    crpx_frac_minhash_flush (dst);
+    memcpy (dst->buffer, src->hash + i, m * sizeof (uint64_t));
+    dst->n_buffer = m;
+  }
+  crpx_frac_minhash_flush (dst);
+  return true;
+}
+
+double
+crpx_frac_minhash_cardinality (crpx_frac_minhash_t fmh)
+{
+  crpx_frac_minhash_flush (fmh);
+  return (double) fmh->n_hash * (double) fmh->scale;
+}
+
+size_t
+crpx_frac_minhash_intersection_size (crpx_frac_minhash_t a, crpx_frac_minhash_t b)
+{
+  crpx_frac_minhash_flush (a);
+  crpx_frac_minhash_flush (b);
+  return fmh_intersection_size (a->cglob, a->hash, a->n_hash, b->hash, b->n_hash);
+}
+
+double
+crpx_frac_minhash_containment (crpx_frac_minhash_t a, crpx_frac_minhash_t b)
+{
+  if (!fmh_compatible (a, b, "crpx_frac_minhash_containment")) return 0.;
+  size_t common = crpx_frac_minhash_intersection_size (a, b);
+  return a->n_hash ? (double) common / (double) a->n_hash : 0.;
+}
+
+double
+crpx_frac_minhash_jaccard (crpx_frac_minhash_t a, crpx_frac_minhash_t b)
+{
+  if (!fmh_compatible (a, b, "crpx_frac_minhash_jaccard")) return 0.;
+  size_t common = crpx_frac_minhash_intersection_size (a, b), total = a->n_hash + b->n_hash - common;
+  return total ? (double) common / (double) total : 0.;
+}
+
+double
+crpx_frac_minhash_ani (crpx_frac_minhash_t a, crpx_frac_minhash_t b)
+{
+  double c = crpx_frac_minhash_containment (a, b);
+  return (c > 0.) ? pow (c, 1. / (double) a->k) : 0.;
+}
+
+static size_t
+fmh_filter_threshold (__attribute__((unused)) crpx_global_t cglob, const uint64_t *hash, size_t n, uint64_t threshold, uint64_t *out)
+{ // out[] may receive up to n elements; returns number of hashes below threshold
+  size_t i = 0, m = 0;
+#ifdef __AVX2__
+  if (cglob->avx) { // unsigned comparison by flipping sign bits; passing lanes are moved to the front by a permutation
+    static const uint32_t compress[16][8] = {
+      {0,1,2,3,4,5,6,7}, {0,1,2,3,4,5,6,7}, {2,3,0,1,4,5,6,7}, {0,1,2,3,4,5,6,7},
+      {4,5,0,1,2,3,6,7}, {0,1,4,5,2,3,6,7}, {2,3,4,5,0,1,6,7}, {0,1,2,3,4,5,6,7},
+      {6,7,0,1,2,3,4,5}, {0,1,6,7,2,3,4,5}, {2,3,6,7,0,1,4,5}, {0,1,2,3,6,7,4,5},
+      {4,5,6,7,0,1,2,3}, {0,1,4,5,6,7,2,3}, {2,3,4,5,6,7,0,1}, {0,1,2,3,4,5,6,7}};
+    const __m256i sign = _mm256_set1_epi64x (INT64_MIN), t = _mm256_set1_epi64x ((int64_t) (threshold ^ (1ULL << 63)));
+    for (; i + 4 <= n; i += 4) {
+      __m256i h = _mm256_loadu_si256 ((const __m256i *) (hash + i));
+      int mask = _mm256_movemask_pd (_mm256_castsi256_pd (_mm256_cmpgt_epi64 (t, _mm256_xor_si256 (h, sign))));
+      h = _mm256_permutevar8x32_epi32 (h, _mm256_loadu_si256 ((const __m256i *) compress[mask]));
+      _mm256_storeu_si256 ((__m256i *) (out + m), h); // writes 4 elements, but only popcount(mask) are kept
+      m += __builtin_popcount (mask);
+    }
+  }
+#endif
+  for (; i < n; i++) { out[m] = hash[i]; m += (hash[i] < threshold); } // branch-free: always writes, advances if kept
+  return m;
+}
+
+static size_t
+fmh_intersection_size (__attribute__((unused)) crpx_global_t cglob, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+{ // sorted arrays of distinct values
+  size_t i = 0, j = 0, common = 0;
+#ifdef __AVX2__
+  if (cglob->avx) { // blocks of 4 x 4 elements are compared all against all, by rotating the second block (Schlegel et al. 2011)
+    while ((i + 4 <= na) && (j + 4 <= nb)) {
+      __m256i va = _mm256_loadu_si256 ((const __m256i *) (a + i)), vb = _mm256_loadu_si256 ((const __m256i *) (b + j));
+      __m256i eq = _mm256_cmpeq_epi64 (va, vb);
+      eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi64 (va, _mm256_permute4x64_epi64 (vb, 0x39)));
+      eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi64 (va, _mm256_permute4x64_epi64 (vb, 0x4e)));
+      eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi64 (va, _mm256_permute4x64_epi64 (vb, 0x93)));
+      common += __builtin_popcount (_mm256_movemask_pd (_mm256_castsi256_pd (eq)));
+      uint64_t amax = a[i+3], bmax = b[j+3];
+      i += (amax <= bmax) ? 4 : 0;
+      j += (bmax <= amax) ? 4 : 0;
+    }
+  }
+#endif
+  while ((i < na) && (j < nb)) { // branch-free merge
+    uint64_t x = a[i], y = b[j];
+    common += (x == y);
+    i += (x <= y);
+    j += (y <= x);
+  }
+  return common;
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  if (*(const uint64_t *) a > *(const uint64_t *) b) return 1;
+  if (*(const uint64_t *) a < *(const uint64_t *) b) return -1;
+  return 0;
+}
@@ -0,0 +1,67 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file frac_minhash.h
+ *  \brief FracMinHash ("scaled" MinHash, as in sourmash; Irber et al. 2022): keeps every canonical k-mer hash below
+ *  UINT64_MAX/scale, s.t. the sketch size is proportional to the number of distinct k-mers and sketches of genomes of
+ *  very different sizes can be compared by containment. Sketches are sorted arrays of distinct 64 bits hashes. */
+
+#ifndef _curupixa_frac_minhash_h_
+#define _curupixa_frac_minhash_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "kmer_encoding.h"
+
+typedef struct {
+  uint64_t *hash,       /*!< \brief sorted distinct hashes below threshold (with room for the buffer, for merging) */
+           *buffer;     /*!< \brief unsorted hashes below threshold, waiting to be merged into hash[] */
+  size_t n_hash, n_buffer, max_hash, max_buffer;
+  uint64_t scale, threshold; /*!< \brief hashes smaller than threshold = UINT64_MAX/scale are kept */
+  uint64_t seed;
+  uint8_t k;
+  crpx_global_t cglob;
+} crpx_frac_minhash_struct, *crpx_frac_minhash_t;
+
+/*! \brief new sketch for canonical k-mers of size k (up to 32), keeping about 1/scale of them. Returns NULL in case of error */
+crpx_frac_minhash_t new_crpx_frac_minhash (crpx_global_t cglob, uint8_t k, uint64_t scale, uint64_t seed);
+void del_crpx_frac_minhash (crpx_frac_minhash_t fmh);
+void crpx_frac_minhash_reset (crpx_frac_minhash_t fmh);
+/*! \brief hash of 2-bit encoded k-mer used by the sketch (a bijection, thus distinct k-mers never collide) */
+extern uint64_t crpx_frac_minhash_kmer_hash (crpx_frac_minhash_t fmh, uint64_t kmer);
+/*! \brief add hash value, if below threshold */
+void crpx_frac_minhash_add_hash (crpx_frac_minhash_t fmh, uint64_t hash);
+/*! \brief add hashes below threshold from array, with a branch-free filter (AVX2 compare and compress when available) */
+void crpx_frac_minhash_add_hash_array (crpx_frac_minhash_t fmh, const uint64_t *hash, size_t n);
+/*! \brief add canonical k-mers of sequence (k-mers with non-ACGT characters are skipped) */
+void crpx_frac_minhash_add_sequence (crpx_frac_minhash_t fmh, const char *seq, size_t len);
+/*! \brief merge pending hashes into the sorted array (called by all functions below) */
+void crpx_frac_minhash_flush (crpx_frac_minhash_t fmh);
+/*! \brief dst = union(dst, src); both must have same k, scale and seed */
+bool crpx_frac_minhash_merge (crpx_frac_minhash_t dst, crpx_frac_minhash_t src);
+/*! \brief number of distinct k-mers, estimated as sketch size times scale */
+double crpx_frac_minhash_cardinality (crpx_frac_minhash_t fmh);
+/*! \brief number of hashes shared by a and b (sorted set intersection, with AVX2 kernel) */
+size_t crpx_frac_minhash_intersection_size (crpx_frac_minhash_t a, crpx_frac_minhash_t b);
+/*! \brief fraction of k-mers of a that are also in b (a and b must have same k, scale and seed) */
+double crpx_frac_minhash_containment (crpx_frac_minhash_t a, crpx_frac_minhash_t b);
+double crpx_frac_minhash_jaccard (crpx_frac_minhash_t a, crpx_frac_minhash_t b);
+/*! \brief average nucleotide identity of a to b, from containment C as C^(1/k) (Blanca et al. 2021) */
+double crpx_frac_minhash_ani (crpx_frac_minhash_t a, crpx_frac_minhash_t b);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,357 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file fuse_filter.c
+ *  \brief binary fuse filter with 3 hash functions, based on https://github.com/FastFilter/xor_singleheader
+ *  (Apache-2.0 license) by Thomas Mueller Graf and Daniel Lemire. Our construction removes duplicates exactly by
+ *  sorting the hashes within each segment bucket, s.t. the counting step can run in parallel. */
+
+#include "fuse_filter.h"
+
+#define FUSE_MAX_ITERATIONS 100
+#define FUSE_MAX_SEGMENT_LENGTH 262144
+#define FUSE_BATCH 32
+#define FUSE_HEADER_SIZE 64 /* in bytes, s.t. mmapped fingerprints are aligned */
+#define FUSE_MAGIC 0x3153554658505243ULL /* "CRPXFUS1" in little endian */
+
+static void fuse_set_dimensions (crpx_fuse_filter_t ff, size_t n);
+static bool fuse_populate (crpx_fuse_filter_t ff, const uint64_t *keys, size_t n);
+static int compare_uint64_increasing (const void *a, const void *b);
+
+static inline uint64_t
+fuse_mix (uint64_t key, uint64_t seed)
+{
+  return crpx_hashint_murmurmix64 (key + seed);
+}
+
+static inline uint64_t
+fuse_fingerprint (uint64_t hash)
+{
+  return hash ^ (hash >> 32);
+}
+
+static inline void
+fuse_positions (crpx_fuse_filter_t ff, uint64_t hash, uint32_t *p)
+{ // p[0] in segment s, p[1] in s+1 and p[2] in s+2, where s depends on the high bits of hash
+  p[0] = (uint32_t)(((__uint128_t) hash * (__uint128_t) ff->segment_count_length) >> 64);
+  p[1] = (p[0] + ff->segment_length) ^ ((uint32_t)(hash >> 18) & ff->segment_length_mask);
+  p[2] = (p[0] + 2 * ff->segment_length) ^ ((uint32_t)(hash) & ff->segment_length_mask);
+}
+
+crpx_fuse_filter_t
+new_crpx_fuse_filter (crpx_global_t cglob, const uint64_t *keys, size_t n, uint8_t fingerprint_bits)
+{
+  if ((fingerprint_bits != 8) && (fingerprint_bits != 16)) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter: fingerprints must have 8 or 16 bits, not %u", fingerprint_bits);
+    return NULL;
+  }
+  if (n > UINT32_MAX - (UINT32_MAX >> 3)) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter: too many keys (%lu), maximum is around 3.7 billion", n);
+    return NULL;
+  }
+  crpx_fuse_filter_t ff = (crpx_fuse_filter_t) crpx_malloc (cglob, sizeof (crpx_fuse_filter_struct));
+  if (!ff) return NULL;
+  ff->fp8 = NULL;
+  ff->fp16 = NULL;
+  ff->mmap_ptr = NULL;
+  ff->mmap_size = 0;
+  ff->fingerprint_bits = fingerprint_bits;
+  ff->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, ff->cglob); // thread-safe increase of ref_counter
+  fuse_set_dimensions (ff, n);
+  if (fingerprint_bits == 8) ff->fp8  = (uint8_t *)  crpx_calloc (cglob, ff->array_length, sizeof (uint8_t));
+  else                       ff->fp16 = (uint16_t *) crpx_calloc (cglob, ff->array_length, sizeof (uint16_t));
+  if ((!ff->fp8 && !ff->fp16) || !fuse_populate (ff, keys, n)) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter: could not build filter for %lu keys", n);
+    del_crpx_fuse_filter (ff);
+    return NULL;
+  }
+  crpx_logger_verbose (cglob, "Binary fuse filter with %lu distinct keys in %lu bytes", ff->n_keys, crpx_fuse_filter_size_in_bytes (ff));
+  return ff;
+}
+
+void
+del_crpx_fuse_filter (crpx_fuse_filter_t ff)
+{
+  if (!ff) return;
+  if (ff->mmap_ptr) {
+#ifndef CRPX_OS_WINDOWS
+    munmap (ff->mmap_ptr, ff->mmap_size);
+#endif
+  }
+  else {
+    if (ff->fp8)  crpx_free (ff->cglob, ff->fp8);
+    if (ff->fp16) crpx_free (ff->cglob, ff->fp16);
+  }
+  crpx_global_finalise (ff->cglob); // it just decreases cglob->ref_counter
+  free (ff);
+}
+
+size_t
+crpx_fuse_filter_size_in_bytes (crpx_fuse_filter_t ff)
+{
+  return (size_t) ff->array_length * (ff->fingerprint_bits / 8);
+}
+
+static void
+fuse_set_dimensions (crpx_fuse_filter_t ff, size_t n)
+{ // same dimensions as binary_fuse8_allocate() from reference implementation, for arity 3
+  double size_factor = 0.;
+  uint64_t capacity, segment_count;
+  ff->segment_length = (n < 2) ? 4 : 1U << (int) floor (log ((double) n) / log (3.33) + 2.25);
+  if (ff->segment_length > FUSE_MAX_SEGMENT_LENGTH) ff->segment_length = FUSE_MAX_SEGMENT_LENGTH;
+  ff->segment_length_mask = ff->segment_length - 1;
+  if (n > 1) size_factor = CRPX_MAX (1.125, 0.875 + 0.25 * log (1000000.) / log ((double) n));
+  capacity = (uint64_t) round ((double) n * size_factor);
+  segment_count = (capacity + ff->segment_length - 1) / ff->segment_length;
+  ff->segment_count = (segment_count > 2) ? (uint32_t)(segment_count - 2) : 1;
+  ff->array_length = (ff->segment_count + 2) * ff->segment_length;
+  ff->segment_count_length = ff->segment_count * ff->segment_length;
+}
+
+static bool
+fuse_populate (crpx_fuse_filter_t ff, const uint64_t *keys, size_t n)
+{
+  crpx_global_t cglob = ff->cglob;
+  uint64_t rng_counter = 0x726b2b9d438b9d4dULL; // same initial state as reference implementation
+  size_t i, b, c, n_unique = 0, stack_size = 0, q_size, capacity = ff->array_length;
+  size_t n_chunks = CRPX_MAX (1, cglob->nthreads), n_buckets, bucket_bits = 1;
+  bool success = false, overflow;
+
+  while ((1UL << bucket_bits) < ff->segment_count) bucket_bits++; // bucket = contiguous range of segments
+  n_buckets = 1UL << bucket_bits;
+
+  uint64_t *hash    = (uint64_t *) crpx_malloc (cglob, (n + 1) * sizeof (uint64_t)); // reused as stack of peeled hashes
+  uint64_t *sorted  = (uint64_t *) crpx_malloc (cglob, (n + 1) * sizeof (uint64_t));
+  uint64_t *t2hash  = (uint64_t *) crpx_malloc (cglob, capacity * sizeof (uint64_t));
+  uint32_t *alone   = (uint32_t *) crpx_malloc (cglob, capacity * sizeof (uint32_t));
+  uint8_t  *t2count = (uint8_t *)  crpx_malloc (cglob, capacity * sizeof (uint8_t));
+  uint8_t  *found   = (uint8_t *)  crpx_malloc (cglob, (n + 1) * sizeof (uint8_t));
+  size_t   *offset  = (size_t *)   crpx_malloc (cglob, n_chunks * n_buckets * sizeof (size_t));
+  size_t   *bucket  = (size_t *)   crpx_malloc (cglob, (n_buckets + 1) * sizeof (size_t));
+  size_t   *b_size  = (size_t *)   crpx_malloc (cglob, n_buckets * sizeof (size_t));
+  if (!hash || !sorted || !t2hash || !alone || !t2count || !found || !offset || !bucket || !b_size) goto fuse_populate_cleanup;
+
+  for (int iter = 0; (iter < FUSE_MAX_ITERATIONS) && !success; iter++) {
+    rng_counter += 0x9e3779b97f4a7c15ULL; // splitmix64 generator, as in the reference implementation
+    ff->seed = crpx_hashint_splitmix64 (rng_counter);
+    memset (t2hash, 0, capacity * sizeof (uint64_t));
+    memset (t2count, 0, capacity * sizeof (uint8_t));
+    memset (offset, 0, n_chunks * n_buckets * sizeof (size_t));
+
+    /* 1. counting sort of hashes into buckets (chunks of keys are stable, thus result is independent of n_chunks) */
+#pragma omp parallel for schedule(static) private(i)
+    for (c = 0; c < n_chunks; c++) for (i = (c * n) / n_chunks; i < ((c + 1) * n) / n_chunks; i++) {
+      hash[i] = fuse_mix (keys[i], ff->seed);
+      offset[c * n_buckets + (hash[i] >> (64 - bucket_bits))]++;
+    }
+    for (i = b = 0; b < n_buckets; b++) {
+      bucket[b] = i;
+      for (c = 0; c < n_chunks; c++) { size_t x = offset[c * n_buckets + b]; offset[c * n_buckets + b] = i; i += x; }
+    }
+    bucket[n_buckets] = n;
+#pragma omp parallel for schedule(static) private(i)
+    for (c = 0; c < n_chunks; c++) for (i = (c * n) / n_chunks; i < ((c + 1) * n) / n_chunks; i++)
+      sorted[ offset[c * n_buckets + (hash[i] >> (64 - bucket_bits))]++ ] = hash[i];
+
+    /* 2. sort within buckets and remove duplicates (same key, or rare full 64 bits collisions) */
+#pragma omp parallel for schedule(dynamic) private(i)
+    for (b = 0; b < n_buckets; b++) {
+      size_t j = bucket[b];
+      if (bucket[b+1] > bucket[b]) {
+        qsort (sorted + bucket[b], bucket[b+1] - bucket[b], sizeof (uint64_t), compare_uint64_increasing);
+        for (i = bucket[b] + 1; i < bucket[b+1]; i++) if (sorted[i] != sorted[j]) sorted[++j] = sorted[i];
+        j++;
+      }
+      b_size[b] = j - bucket[b];
+    }
+
+    /* 3. count how many hashes hit each position, with xor of hashes and xor of hash indices (parallel over buckets) */
+    overflow = false;
+#pragma omp parallel for schedule(dynamic) private(i) reduction(||:overflow)
+    for (b = 0; b < n_buckets; b++) for (i = bucket[b]; i < bucket[b] + b_size[b]; i++) {
+      uint32_t p[3];
+      uint8_t count;
+      fuse_positions (ff, sorted[i], p);
+      for (int k = 0; k < 3; k++) {
+        #pragma omp atomic capture
+        { t2count[p[k]] += 4; count = t2count[p[k]]; }
+        overflow = overflow || (count < 4); // more than 63 hashes at same position
+        if (k) {
+          #pragma omp atomic
+          t2count[p[k]] ^= (uint8_t) k;
+        }
+        #pragma omp atomic
+        t2hash[p[k]] ^= sorted[i];
+      }
+    }
+    if (overflow) continue;
+    for (n_unique = b = 0; b < n_buckets; b++) n_unique += b_size[b];
+
+    /* 4. peeling: positions with a single hash are removed, possibly making other positions single */
+    for (q_size = i = 0; i < capacity; i++) { alone[q_size] = (uint32_t) i; q_size += ((t2count[i] >> 2) == 1); }
+    stack_size = 0;
+    while (q_size > 0) {
+      uint32_t idx = alone[--q_size], p[3], other;
+      if ((t2count[idx] >> 2) != 1) continue;
+      uint64_t h = t2hash[idx];
+      uint8_t f = t2count[idx] & 3, k;
+      fuse_positions (ff, h, p);
+      found[stack_size] = f;
+      hash[stack_size++] = h;
+      for (k = 1; k < 3; k++) {
+        other = p[(f + k) % 3];
+        alone[q_size] = other;
+        q_size += ((t2count[other] >> 2) == 2);
+        t2count[other] -= 4;
+        t2count[other] ^= (uint8_t)((f + k) % 3);
+        t2hash[other] ^= h;
+      }
+    }
+    success = (stack_size == n_unique);
+    if (!success) crpx_logger_verbose (cglob, "fuse filter: peeling failed at iteration %d, trying new seed", iter);
+  }
+
+  /* 5. assign fingerprints in reverse peeling order */
+  if (success) for (i = stack_size; i-- > 0;) {
+    uint32_t p[3];
+    uint64_t f = fuse_fingerprint (hash[i]);
+    fuse_positions (ff, hash[i], p);
+    if (ff->fp8) ff->fp8[ p[found[i]] ] = (uint8_t)(f ^ ff->fp8[ p[(found[i] + 1) % 3] ] ^ ff->fp8[ p[(found[i] + 2) % 3] ]);
+    else ff->fp16[ p[found[i]] ] = (uint16_t)(f ^ ff->fp16[ p[(found[i] + 1) % 3] ] ^ ff->fp16[ p[(found[i] + 2) % 3] ]);
+  }
+  ff->n_keys = n_unique;
+
+fuse_populate_cleanup:
+  if (hash)    crpx_free (cglob, hash);
+  if (sorted)  crpx_free (cglob, sorted);
+  if (t2hash)  crpx_free (cglob, t2hash);
+  if (alone)   crpx_free (cglob, alone);
+  if (t2count) crpx_free (cglob, t2count);
+  if (found)   crpx_free (cglob, found);
+  if (offset)  crpx_free (cglob, offset);
+  if (bucket)  crpx_free (cglob, bucket);
+  if (b_size)  crpx_free (cglob, b_size);
+  return success;
+}
+
+bool
+crpx_fuse_filter_contains (crpx_fuse_filter_t ff, uint64_t key)
+{
+  uint32_t p[3];
+  uint64_t hash = fuse_mix (key, ff->seed);
+  fuse_positions (ff, hash, p);
+  if (ff->fp8) return (uint8_t)(fuse_fingerprint (hash) ^ ff->fp8[p[0]] ^ ff->fp8[p[1]] ^ ff->fp8[p[2]]) == 0;
+  return (uint16_t)(fuse_fingerprint (hash) ^ ff->fp16[p[0]] ^ ff->fp16[p[1]] ^ ff->fp16[p[2]]) == 0;
+}
+
+size_t
+crpx_fuse_filter_contains_array (crpx_fuse_filter_t ff, const uint64_t *keys, size_t n, bool *result)
+{
+  size_t i, found = 0;
+#pragma omp parallel for schedule(static) reduction(+:found) if (n > FUSE_BATCH * 1024)
+  for (i = 0; i < n; i += FUSE_BATCH) {
+    uint64_t hash[FUSE_BATCH];
+    uint32_t p[FUSE_BATCH][3];
+    size_t j, m = CRPX_MIN (FUSE_BATCH, n - i);
+    for (j = 0; j < m; j++) { // all three positions of all keys are requested before the first one is read
+      hash[j] = fuse_mix (keys[i+j], ff->seed);
+      fuse_positions (ff, hash[j], p[j]);
+      if (ff->fp8) for (int k = 0; k < 3; k++) __builtin_prefetch (ff->fp8  + p[j][k], 0, 1);
+      else         for (int k = 0; k < 3; k++) __builtin_prefetch (ff->fp16 + p[j][k], 0, 1);
+    }
+    if (ff->fp8) for (j = 0; j < m; j++)
+      found += (result[i+j] = ((uint8_t)(fuse_fingerprint (hash[j]) ^ ff->fp8[p[j][0]] ^ ff->fp8[p[j][1]] ^ ff->fp8[p[j][2]]) == 0));
+    else for (j = 0; j < m; j++)
+      found += (result[i+j] = ((uint16_t)(fuse_fingerprint (hash[j]) ^ ff->fp16[p[j][0]] ^ ff->fp16[p[j][1]] ^ ff->fp16[p[j][2]]) == 0));
+  }
+  return found;
+}
+
+/* file = 64 bytes header (8 x uint64_t in native byte order) followed by the fingerprints */
+bool
+crpx_fuse_filter_save (crpx_fuse_filter_t ff, const char *filename)
+{
+  uint64_t header[FUSE_HEADER_SIZE / sizeof (uint64_t)] = {FUSE_MAGIC, ff->seed, ff->n_keys, ff->segment_length,
+    ff->segment_count, ff->array_length, ff->fingerprint_bits, 0};
+  const void *data = ff->fp8 ? (const void *) ff->fp8 : (const void *) ff->fp16;
+  FILE *fp = fopen (filename, "wb");
+  if (!fp) {
+    crpx_logger_error (ff->cglob, "crpx_fuse_filter_save: could not open file %s: %s", filename, strerror (errno));
+    return false;
+  }
+  bool ok = (fwrite (header, FUSE_HEADER_SIZE, 1, fp) == 1) && (fwrite (data, crpx_fuse_filter_size_in_bytes (ff), 1, fp) == 1);
+  ok = (fclose (fp) == 0) && ok;
+  if (!ok) crpx_logger_error (ff->cglob, "crpx_fuse_filter_save: could not write to file %s", filename);
+  return ok;
+}
+
+crpx_fuse_filter_t
+new_crpx_fuse_filter_from_file (crpx_global_t cglob, const char *filename)
+{
+#ifdef CRPX_OS_WINDOWS
+  crpx_logger_error (cglob, "new_crpx_fuse_filter_from_file: memory mapped files not supported on this system (file %s)", filename);
+  return NULL;
+#else
+  struct stat st;
+  const uint64_t *header;
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter_from_file: could not open file %s: %s", filename, strerror (errno));
+    return NULL;
+  }
+  if ((fstat (fd, &st) < 0) || (st.st_size < FUSE_HEADER_SIZE)) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter_from_file: file %s is too small or could not be read", filename);
+    close (fd);
+    return NULL;
+  }
+  void *ptr = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd); // mapping remains valid after closing file
+  if (ptr == MAP_FAILED) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter_from_file: could not map file %s: %s", filename, strerror (errno));
+    return NULL;
+  }
+  header = (const uint64_t *) ptr;
+  if ((header[0] != FUSE_MAGIC) || ((header[6] != 8) && (header[6] != 16)) || !header[3] || (header[3] & (header[3] - 1)) ||
+      (header[5] != (header[4] + 2) * header[3]) || ((uint64_t) st.st_size != FUSE_HEADER_SIZE + header[5] * (header[6] / 8))) {
+    crpx_logger_error (cglob, "new_crpx_fuse_filter_from_file: file %s is not a valid fuse filter", filename);
+    munmap (ptr, (size_t) st.st_size);
+    return NULL;
+  }
+  crpx_fuse_filter_t ff = (crpx_fuse_filter_t) crpx_malloc (cglob, sizeof (crpx_fuse_filter_struct));
+  if (!ff) { munmap (ptr, (size_t) st.st_size); return NULL; }
+  ff->mmap_ptr = ptr;
+  ff->mmap_size = (size_t) st.st_size;
+  ff->seed = header[1];
+  ff->n_keys = header[2];
+  ff->segment_length = (uint32_t) header[3];
+  ff->segment_length_mask = ff->segment_length - 1;
+  ff->segment_count = (uint32_t) header[4];
+  ff->segment_count_length = ff->segment_count * ff->segment_length;
+  ff->array_length = (uint32_t) header[5];
+  ff->fingerprint_bits = (uint8_t) header[6];
+  ff->fp8  = (ff->fingerprint_bits == 8)  ? (uint8_t *)  ((char *) ptr + FUSE_HEADER_SIZE) : NULL; // read-only memory
+  ff->fp16 = (ff->fingerprint_bits == 16) ? (uint16_t *) ((char *) ptr + FUSE_HEADER_SIZE) : NULL;
+  ff->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, ff->cglob); // thread-safe increase of ref_counter
+  return ff;
+#endif
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  if (*(const uint64_t *) a > *(const uint64_t *) b) return 1;
+  if (*(const uint64_t *) a < *(const uint64_t *) b) return -1;
+  return 0;
+}
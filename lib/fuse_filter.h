@@ -0,0 +1,52 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file fuse_filter.h
+ *  \brief static binary fuse filter (Graf and Lemire 2022) for immutable sets of 64 bits keys (e.g. k-mers), with
+ *  8 or 16 bits fingerprints. It uses approx. 1.13 x fingerprint bits per key, and a lookup reads 3 fingerprints. */
+
+#ifndef _curupixa_fuse_filter_h_
+#define _curupixa_fuse_filter_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint8_t  *fp8;    /*!< \brief 8 bits fingerprints (false positive rate approx. 1/256), or NULL */
+  uint16_t *fp16;   /*!< \brief 16 bits fingerprints (false positive rate approx. 1/65536), or NULL */
+  uint64_t seed, n_keys;
+  uint32_t segment_length, segment_length_mask, segment_count, segment_count_length, array_length;
+  uint8_t fingerprint_bits;
+  void *mmap_ptr;   /*!< \brief if loaded from file, fingerprints point to this memory mapped region */
+  size_t mmap_size;
+  crpx_global_t cglob;
+} crpx_fuse_filter_struct, *crpx_fuse_filter_t;
+
+/*! \brief build filter from n keys (duplicates allowed) with fingerprint_bits equal to 8 or 16; construction uses
+ *  OpenMP threads for hashing, bucketing and counting, and the result does not depend on the number of threads */
+crpx_fuse_filter_t new_crpx_fuse_filter (crpx_global_t cglob, const uint64_t *keys, size_t n, uint8_t fingerprint_bits);
+/*! \brief memory-maps a file created by crpx_fuse_filter_save(); returns NULL if file is invalid */
+crpx_fuse_filter_t new_crpx_fuse_filter_from_file (crpx_global_t cglob, const char *filename);
+void del_crpx_fuse_filter (crpx_fuse_filter_t ff);
+bool crpx_fuse_filter_contains (crpx_fuse_filter_t ff, uint64_t key);
+/*! \brief batched lookup with software prefetching; result[i] is set for each key and the number of positives is returned */
+size_t crpx_fuse_filter_contains_array (crpx_fuse_filter_t ff, const uint64_t *keys, size_t n, bool *result);
+bool crpx_fuse_filter_save (crpx_fuse_filter_t ff, const char *filename);
+size_t crpx_fuse_filter_size_in_bytes (crpx_fuse_filter_t ff);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -30,6 +30,7 @@ crpx_global_init (__attribute__((unused)) uint64_t seed, const char *level_strin
   cglob->error = false;
   cglob->rng_seed_vector = NULL; // will be initialized by crpx_global_init_threads_rng() o.w. should return failure 
   cglob->rng_get = NULL;
+  cglob->hash_get = NULL;
 
   crpx_get_time_128bits (cglob->elapsed_time);
 
@@ -58,6 +59,7 @@ global_init_logger (crpx_global_t cglob, const char *level_string)
 void
 global_init_simd_instructions (crpx_global_t cglob)
 {
+  cglob->sse = cglob->avx = cglob->aes = false;
 #ifdef __SSE4_2__
   cglob->sse = (__builtin_cpu_supports ("sse4.2") > 0);
   crpx_logger_verbose (cglob, "Compiled with SSE4.2 instructions, which are %s by host machine", cglob->sse ? "enabled" : "disabled");
@@ -66,8 +68,11 @@ global_init_simd_instructions (crpx_global_t cglob)
   cglob->avx = (__builtin_cpu_supports ("avx2") > 0);
   crpx_logger_verbose (cglob, "Compiled with AVX2 instructions, which are %s by host machine", cglob->avx ? "enabled" : "disabled");
 #endif
+#ifdef __AES__
+  cglob->aes = (__builtin_cpu_supports ("aes") > 0);
+  crpx_logger_verbose (cglob, "Compiled with AES-NI instructions, which are %s by host machine", cglob->aes ? "enabled" : "disabled");
+#endif
 #if !defined(__SSE4_2__) && !defined(__AVX2__)
-  cglob->sse = cglob->avx = false;
   crpx_logger_verbose (cglob, "Compiled without SSE3 or AVX2 instructions, irrespective of host machine capabilities");
 #endif
   return;
@@ -86,6 +91,7 @@ global_init_threads_rng (crpx_global_t cglob, __attribute__((unused)) uint64_t s
   cglob->rng_get = NULL;
   cglob->rng_size = 0;
   crpx_set_random_generator (cglob, seed, 0); // 0=wyhash, 1=lehmer, etc.
+  crpx_set_hash_function (cglob, 0); // needs cglob->sse, thus after global_init_simd_instructions()
   return;
 }
 
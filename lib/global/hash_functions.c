@@ -17,6 +17,8 @@
 #include "hash_functions.h"
 #include "internal_random_constants.h" // not available to the user, only locally
 
+#define SIPHASH_BATCH_CHUNK 4096UL /* keys per thread in crpx_hash_siphash_batch() */
+
 #ifdef CRPX_OS_WINDOWS
 int windows_getentropy (void* buf, size_t n);
 #endif
@@ -143,3 +145,230 @@ crpx_update_elapsed_time_128bits (uint64_t past[2])
   past[0] = now[0]; past[1] = now[1];
   return seconds;
 }
+
+uint32_t
+crpx_crc32c (__attribute__((unused)) crpx_global_t cglob, const void *data, size_t len, uint32_t crc)
+{
+#ifdef __SSE4_2__
+  if (cglob->sse) return crpx_crc32c_sse42 (data, len, crc);
+#endif
+  return crpx_crc32c_table (data, len, crc);
+}
+
+uint32_t
+crpx_crc32c_parallel (crpx_global_t cglob, const void *data, size_t len, uint32_t crc)
+{
+  const size_t chunk = 1UL << 20;
+  size_t i, n_chunks = (len + chunk - 1) / chunk;
+  const uint8_t *p = (const uint8_t *) data;
+  if (n_chunks < 2) return crpx_crc32c (cglob, data, len, crc);
+  uint32_t *part = (uint32_t *) crpx_malloc (cglob, n_chunks * sizeof (uint32_t));
+  if (!part) return crpx_crc32c (cglob, data, len, crc);
+#pragma omp parallel for shared(part, p, n_chunks, len) private(i) schedule(static)
+  for (i = 0; i < n_chunks; i++) part[i] = crpx_crc32c (cglob, p + i * chunk, CRPX_MIN (chunk, len - i * chunk), 0);
+  for (i = 0; i < n_chunks; i++) crc = crpx_crc32c_combine (crc, part[i], CRPX_MIN (chunk, len - i * chunk));
+  crpx_free (cglob, part);
+  return crc;
+}
+
+uint64_t
+crpx_hash_crc32c_seed64 (__attribute__((unused)) crpx_global_t cglob, const void *data, size_t len, uint64_t seed)
+{
+#ifdef __SSE4_2__
+  if (cglob->sse) return crpx_crc32c_seed64_sse42 (data, len, seed);
+#endif
+  return crpx_crc32c_seed64_table (data, len, seed);
+}
+
+uint64_t
+crpx_hash_xxh3_seed64 (__attribute__((unused)) crpx_global_t cglob, const void *data, size_t len, uint64_t seed, void *out)
+{
+#ifdef __AVX2__
+  if (cglob->avx) return crpx_xxh3_seed64_avx2 (data, len, seed, out);
+#endif
+#ifdef __SSE4_2__
+  if (cglob->sse) return crpx_xxh3_seed64_sse42 (data, len, seed, out);
+#endif
+  return crpx_xxh3_seed64_scalar (data, len, seed, out);
+}
+
+uint64_t
+crpx_hash_aes_seed128 (__attribute__((unused)) crpx_global_t cglob, const void *data, size_t len, const void *seed)
+{
+#ifdef __AES__
+  if (cglob->aes) return crpx_aeshash_seed128_aesni (data, len, seed);
+#endif
+  return crpx_aeshash_seed128_soft (data, len, seed);
+}
+
+void
+crpx_hash_siphash_batch (__attribute__((unused)) crpx_global_t cglob, const void * const *data, const size_t *len, size_t n,
+                         const void *seed, bool siphash13, uint64_t *out)
+{ // SSE4.2 (two lanes) was not faster than the scalar version, thus there is no such kernel
+  int64_t c, n_chunks = (int64_t) ((n + SIPHASH_BATCH_CHUNK - 1) / SIPHASH_BATCH_CHUNK);
+#pragma omp parallel for schedule(dynamic) if (n_chunks > 1)
+  for (c = 0; c < n_chunks; c++) {
+    size_t first = (size_t) c * SIPHASH_BATCH_CHUNK, m = CRPX_MIN (SIPHASH_BATCH_CHUNK, n - first);
+    const size_t *l = len ? len + first : NULL;
+#ifdef __AVX2__
+    if (cglob->avx) { crpx_siphash_batch_avx2 (data + first, l, m, seed, siphash13, out + first); continue; }
+#endif
+    crpx_siphash_batch_scalar (data + first, l, m, seed, siphash13, out + first);
+  }
+}
+
+/* registry of byte hashes with a uniform signature. Hashes seeded by tables (Pearson and pseudocrc32) use the internal
+ * list of random numbers as table, and the seed only as initial CRC value (pseudocrc32) or not at all (Pearson) */
+
+static uint64_t
+hash_pearson (const void *key, size_t len, __attribute__((unused)) uint64_t seed)
+{
+  return crpx_hash_pearson_seed2048 (key, len, crpx_list_of_128_random64);
+}
+
+static uint64_t
+hash_pseudocrc32 (const void *key, size_t len, uint64_t seed)
+{
+  return crpx_hash_pseudocrc32_seed8192 (key, len, crpx_list_of_128_random64, (uint32_t) seed);
+}
+
+static uint64_t hash_fletcher32 (const void *key, size_t len, __attribute__((unused)) uint64_t seed) { return crpx_hash_fletcher32 (key, len); }
+static uint64_t hash_jenkins (const void *key, size_t len, __attribute__((unused)) uint64_t seed) { return crpx_hash_jenkins (key, len); }
+static uint64_t hash_fnv32 (const void *key, size_t len, __attribute__((unused)) uint64_t seed) { return crpx_fnv_hash32 (key, len); }
+static uint64_t hash_fnv64 (const void *key, size_t len, __attribute__((unused)) uint64_t seed) { return crpx_fnv_hash64 (key, len); }
+static uint64_t hash_jenkins_mailund (const void *key, size_t len, uint64_t seed) { return crpx_hash_jenkins_mailund_seed32 (key, len, &seed); }
+static uint64_t hash_mailund (const void *key, size_t len, uint64_t seed) { return crpx_hash_mailund_seed32 (key, len, &seed); }
+static uint64_t hash_rotating (const void *key, size_t len, uint64_t seed) { return crpx_hash_rotating_seed32 (key, len, &seed); }
+static uint64_t hash_hsieh (const void *key, size_t len, uint64_t seed) { return crpx_hsieh_hash32_seed32 (key, len, &seed); }
+static uint64_t hash_fasthash64 (const void *key, size_t len, uint64_t seed) { return crpx_fasthash64_seed64 (key, len, &seed); }
+static uint64_t hash_metrohash64_v1 (const void *key, size_t len, uint64_t seed) { return crpx_metrohash64_v1_seed64 (key, len, &seed); }
+static uint64_t hash_metrohash64_v2 (const void *key, size_t len, uint64_t seed) { return crpx_metrohash64_v2_seed64 (key, len, &seed); }
+static uint64_t hash_metrohash128_v1 (const void *key, size_t len, uint64_t seed) { uint64_t out[2]; return crpx_metrohash128_v1_seed64 (key, len, &seed, out); }
+static uint64_t hash_metrohash128_v2 (const void *key, size_t len, uint64_t seed) { uint64_t out[2]; return crpx_metrohash128_v2_seed64 (key, len, &seed, out); }
+static uint64_t hash_murmurhash3_128 (const void *key, size_t len, uint64_t seed) { uint64_t out[2]; return crpx_murmurhash3_128bits (key, len, (uint32_t) seed, out); }
+static uint64_t hash_murmurhash3_32 (const void *key, size_t len, uint64_t seed) { return crpx_murmurhash3_32bits (key, len, (uint32_t) seed); }
+static uint64_t hash_siphash64 (const void *key, size_t len, uint64_t seed) { uint64_t s[2] = {seed, ~seed}; return crpx_siphash64_seed128 (key, len, s); }
+static uint64_t hash_siphash13 (const void *key, size_t len, uint64_t seed) { uint64_t s[2] = {seed, ~seed}; return crpx_siphash13_seed128 (key, len, s); }
+static uint64_t hash_xxh3 (const void *key, size_t len, uint64_t seed) { return crpx_xxh3_seed64_scalar (key, len, seed, NULL); }
+#ifdef __SSE4_2__
+static uint64_t hash_xxh3_sse42 (const void *key, size_t len, uint64_t seed) { return crpx_xxh3_seed64_sse42 (key, len, seed, NULL); }
+#endif
+#ifdef __AVX2__
+static uint64_t hash_xxh3_avx2 (const void *key, size_t len, uint64_t seed) { return crpx_xxh3_seed64_avx2 (key, len, seed, NULL); }
+#endif
+static uint64_t hash_aes (const void *key, size_t len, uint64_t seed) { uint64_t s[2] = {seed, ~seed}; return crpx_aeshash_seed128_soft (key, len, s); }
+#ifdef __AES__
+static uint64_t hash_aes_aesni (const void *key, size_t len, uint64_t seed) { uint64_t s[2] = {seed, ~seed}; return crpx_aeshash_seed128_aesni (key, len, s); }
+#endif
+static uint64_t hash_siphash128 (const void *key, size_t len, uint64_t seed) { uint64_t s[2] = {seed, ~seed}, out[2]; return crpx_siphash128_seed128 (key, len, s, out); }
+#ifdef __SSE4_2__
+#define HASH_SSE42(f) (f)
+#else
+#define HASH_SSE42(f) NULL
+#endif
+#ifdef __AVX2__
+#define HASH_AVX2(f) (f)
+#else
+#define HASH_AVX2(f) NULL
+#endif
+#ifdef __AES__
+#define HASH_AESNI(f) (f)
+#else
+#define HASH_AESNI(f) NULL
+#endif
+
+const crpx_hash_function_info_t crpx_hash_function_list[] = { // new functions must be appended, s.t. ids do not change
+  {"metrohash64_v1",      hash_metrohash64_v1,      NULL, NULL, NULL, 64, true},
+  {"metrohash64_v2",      hash_metrohash64_v2,      NULL, NULL, NULL, 64, true},
+  {"metrohash128_v1",     hash_metrohash128_v1,     NULL, NULL, NULL, 64, true},
+  {"metrohash128_v2",     hash_metrohash128_v2,     NULL, NULL, NULL, 64, true},
+  {"murmurhash3_128bits", hash_murmurhash3_128,     NULL, NULL, NULL, 64, true},
+  {"murmurhash3_32bits",  hash_murmurhash3_32,      NULL, NULL, NULL, 32, true},
+  {"siphash64_seed128",   hash_siphash64,           NULL, NULL, NULL, 64, true},
+  {"siphash128_seed128",  hash_siphash128,          NULL, NULL, NULL, 64, true},
+  {"fasthash64_seed64",   hash_fasthash64,          NULL, NULL, NULL, 64, true},
+  {"crc32c_seed64",       crpx_crc32c_seed64_table, HASH_SSE42(crpx_crc32c_seed64_sse42), NULL, NULL, 64, true},
+  {"hsieh_hash32_seed32", hash_hsieh,               NULL, NULL, NULL, 32, true},
+  {"mailund_seed32",      hash_mailund,             NULL, NULL, NULL, 32, true},
+  {"jenkins_mailund_seed32", hash_jenkins_mailund,  NULL, NULL, NULL, 32, true},
+  {"rotating_seed32",     hash_rotating,            NULL, NULL, NULL, 32, true},
+  {"pseudocrc32_seed8192", hash_pseudocrc32,        NULL, NULL, NULL, 32, true},
+  {"pearson_seed2048",    hash_pearson,             NULL, NULL, NULL, 64, false},
+  {"jenkins",             hash_jenkins,             NULL, NULL, NULL, 32, false},
+  {"fnv_hash32",          hash_fnv32,               NULL, NULL, NULL, 32, false},
+  {"fnv_hash64",          hash_fnv64,               NULL, NULL, NULL, 64, false},
+  {"fletcher32",          hash_fletcher32,          NULL, NULL, NULL, 32, false},
+  {"wyhash64_seed64",     crpx_wyhash64_seed64,     NULL, NULL, NULL, 64, true},
+  {"xxh3_seed64",         hash_xxh3,                HASH_SSE42(hash_xxh3_sse42), HASH_AVX2(hash_xxh3_avx2), NULL, 64, true},
+  {"aeshash_seed128",     hash_aes,                 NULL, NULL, HASH_AESNI(hash_aes_aesni), 64, true},
+  {"siphash13_seed128",   hash_siphash13,           NULL, NULL, NULL, 64, true}
+};
+const uint8_t crpx_hash_function_list_size = sizeof (crpx_hash_function_list) / sizeof (crpx_hash_function_info_t);
+
+int
+crpx_hash_function_id (const char *name)
+{
+  for (int i = 0; i < crpx_hash_function_list_size; i++) if (!strcmp (name, crpx_hash_function_list[i].name)) return i;
+  return -1;
+}
+
+static crpx_hash_func
+hash_function_kernel (crpx_global_t cglob, const crpx_hash_function_info_t *h)
+{ // fastest implementation supported by host
+  if (cglob->aes && h->func_aesni) return h->func_aesni;
+  if (cglob->avx && h->func_avx2) return h->func_avx2;
+  if (cglob->sse && h->func_sse42) return h->func_sse42;
+  return h->func;
+}
+
+void
+crpx_set_hash_function (crpx_global_t cglob, uint8_t hash_id)
+{
+  if (hash_id >= crpx_hash_function_list_size) {
+    crpx_logger_warning (cglob, "crpx_set_hash_function: hash id %u does not exist, using 0 (%s) instead", hash_id, crpx_hash_function_list[0].name);
+    hash_id = 0;
+  }
+  const crpx_hash_function_info_t *h = crpx_hash_function_list + hash_id;
+  cglob->hash_get = hash_function_kernel (cglob, h);
+  snprintf (cglob->hash_name, sizeof (cglob->hash_name), "%u.%s", hash_id, h->name);
+  crpx_logger_verbose (cglob, "Hash function set to '%s'%s", cglob->hash_name,
+                       (cglob->hash_get == h->func_aesni) ? " (with AES-NI)" : (cglob->hash_get == h->func_avx2) ? " (with AVX2)" :
+                       ((cglob->hash_get == h->func_sse42) ? " (with SSE4.2)" : ""));
+}
+
+inline uint64_t
+crpx_hash (crpx_global_t cglob, const void *key, size_t len, uint64_t seed)
+{
+  return cglob->hash_get (key, len, seed);
+}
+
+uint64_t
+crpx_hash_tree (crpx_global_t cglob, const void *data, size_t len, uint8_t hash_id, uint64_t seed, size_t chunk_size)
+{ /* leaves are the chunks, hashed with seed xor chunk index; each level hashes pairs of digests (a last, odd one is
+   * promoted to next level) with a seed depending on the level; the root is hashed together with the total length. */
+  const uint8_t *p = (const uint8_t *) data;
+  size_t i, n_chunks, level;
+  uint64_t *digest, pair[2], single;
+  if (hash_id >= crpx_hash_function_list_size) {
+    crpx_logger_warning (cglob, "crpx_hash_tree: hash id %u does not exist, using 0 (%s) instead", hash_id, crpx_hash_function_list[0].name);
+    hash_id = 0;
+  }
+  crpx_hash_func f = hash_function_kernel (cglob, crpx_hash_function_list + hash_id);
+  if (!chunk_size) chunk_size = CRPX_HASH_TREE_CHUNK;
+  n_chunks = len ? (len + chunk_size - 1) / chunk_size : 1;
+  digest = (n_chunks > 1) ? (uint64_t *) crpx_malloc (cglob, n_chunks * sizeof (uint64_t)) : &single;
+  if (!digest) return 0;
+
+#pragma omp parallel for shared(digest, p, n_chunks, len, chunk_size, f, seed) private(i) schedule(static) if(n_chunks > 1)
+  for (i = 0; i < n_chunks; i++) digest[i] = f (p + i * chunk_size, CRPX_MIN (chunk_size, len - i * chunk_size), seed ^ i);
+
+  for (level = 1; n_chunks > 1; level++) { // in place, since digest[i] depends only on digest[2i] and digest[2i+1]
+    uint64_t level_seed = seed ^ (level * 0x9e3779b97f4a7c15ULL);
+    for (i = 0; 2 * i + 1 < n_chunks; i++) digest[i] = f (digest + 2 * i, 2 * sizeof (uint64_t), level_seed);
+    if (n_chunks & 1) digest[i++] = digest[n_chunks - 1];
+    n_chunks = i;
+  }
+  pair[0] = digest[0]; pair[1] = (uint64_t) len;
+  if (digest != &single) crpx_free (cglob, digest);
+  return f (pair, sizeof (pair), ~seed);
+}
@@ -21,6 +21,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 #include "hash_functions_generators.h"
+#include "hash_functions_simd.h"
 
 size_t crpx_generate_bytesized_random_seeds_from_cpu  (crpx_global_t cglob, void *seed, size_t seed_size);
 void   crpx_generate_bytesized_random_seeds_from_seed (crpx_global_t cglob, void *seed, size_t seed_size, uint64_t initial_seed);
@@ -28,6 +29,49 @@ void   crpx_generate_bytesized_random_seeds_from_seed (crpx_global_t cglob, void
 void crpx_get_time_128bits (uint64_t time[2]);
 double crpx_update_elapsed_time_128bits (uint64_t past[2]);
 
+/*! \brief uniform signature of the byte hashes from the registry; seed is ignored by unseeded hashes */
+typedef uint64_t (*crpx_hash_func) (const void *key, size_t len, uint64_t seed);
+
+typedef struct {
+  const char *name;
+  crpx_hash_func func;       /*!< \brief portable implementation */
+  crpx_hash_func func_sse42; /*!< \brief faster implementation with same output if host has SSE4.2, or NULL */
+  crpx_hash_func func_avx2;  /*!< \brief faster implementation with same output if host has AVX2, or NULL */
+  crpx_hash_func func_aesni; /*!< \brief faster implementation with same output if host has AES-NI, or NULL */
+  uint8_t out_bits;          /*!< \brief 32 or 64 (hashes of 128 bits return a 64 bits mix) */
+  bool seeded;               /*!< \brief false if output does not depend on seed */
+} crpx_hash_function_info_t;
+
+extern const crpx_hash_function_info_t crpx_hash_function_list[];
+extern const uint8_t crpx_hash_function_list_size;
+
+/*! \brief position of hash function in crpx_hash_function_list[] (name as in list), or -1 if not found */
+int crpx_hash_function_id (const char *name);
+/*! \brief sets cglob->hash_get to hash function hash_id (with hardware kernel when available); default is 0.metrohash64_v1 */
+void crpx_set_hash_function (crpx_global_t cglob, uint8_t hash_id);
+/*! \brief byte hash of key with function chosen by crpx_set_hash_function() */
+extern uint64_t crpx_hash (crpx_global_t cglob, const void *key, size_t len, uint64_t seed);
+
+#define CRPX_HASH_TREE_CHUNK (1UL << 20) /*!< \brief default chunk size (bytes) for crpx_hash_tree() */
+/*! \brief 64 bits hash of a huge buffer: fixed-size chunks (chunk_size=0 uses CRPX_HASH_TREE_CHUNK) are hashed in
+ *  parallel with registry function hash_id, and their digests are combined in a binary tree. Result depends on
+ *  hash_id, seed and chunk_size, but not on the number of threads */
+uint64_t crpx_hash_tree (crpx_global_t cglob, const void *data, size_t len, uint8_t hash_id, uint64_t seed, size_t chunk_size);
+
+/*! \brief CRC32C checksum using the SSE4.2 instruction if available, or a table otherwise; crc=0 at start, for chaining */
+uint32_t crpx_crc32c (crpx_global_t cglob, const void *data, size_t len, uint32_t crc);
+/*! \brief CRC32C over fixed-size chunks in parallel, combined at the end (same result as crpx_crc32c()) */
+uint32_t crpx_crc32c_parallel (crpx_global_t cglob, const void *data, size_t len, uint32_t crc);
+/*! \brief seeded 64 bits hash from two CRC32C lanes and a mixer: fast for buckets, but not collision-resistant */
+uint64_t crpx_hash_crc32c_seed64 (crpx_global_t cglob, const void *data, size_t len, uint64_t seed);
+/*! \brief XXH3-style 64 bits hash (and 128 bits in out, if not NULL) with AVX2 or SSE2 kernel when available */
+uint64_t crpx_hash_xxh3_seed64 (crpx_global_t cglob, const void *data, size_t len, uint64_t seed, void *out);
+/*! \brief AES-round keyed hash with 128 bits seed, using AES-NI instructions when available */
+uint64_t crpx_hash_aes_seed128 (crpx_global_t cglob, const void *data, size_t len, const void *seed);
+/*! \brief SipHash-2-4 (or SipHash-1-3 if siphash13 is true) of n keys (len=NULL for null-terminated strings) with 128
+ *  bits seed, several keys at once with AVX2, and in parallel for large n. Same as the scalar functions */
+void crpx_hash_siphash_batch (crpx_global_t cglob, const void * const *data, const size_t *len, size_t n, const void *seed, bool siphash13, uint64_t *out);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
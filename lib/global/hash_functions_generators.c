@@ -17,23 +17,25 @@
 #include "hash_functions_generators.h"
 #include "internal_random_constants.h" // not available to the user, only locally
 
+inline void
+crpx_mul128 (uint64_t *a, uint64_t *b)
+{ // compilers map the 128 bits product to a single mul (or mulx with -mbmi2) on 64 bits CPUs
+  __uint128_t r = (__uint128_t) (*a) * (*b);
+  *a = (uint64_t) r; *b = (uint64_t) (r >> 64);
+}
+
 inline uint64_t
 crpx_mumhash64_mixer (uint64_t a, uint64_t b)
-{ 
-  uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xFFFFFFFF00000000ULL, lb = b & 0xFFFFFFFF00000000ULL;
-  uint64_t rh = ha * hb, rm_0 = ha * lb, rm_1 = hb * la, rl =  la * lb, t = rl + (rm_0<<32);
-  a = t + (rm_1 << 32); b = rh + (rm_0 >> 32) + (rm_1 >> 32); a += b;
-  return a;
+{ // Vladimir Makarov's mum: sum of low and high halves of product
+  crpx_mul128 (&a, &b);
+  return a + b;
 }
 
 inline uint64_t
 crpx_wyhash64_mixer (uint64_t a, uint64_t b)
-{  // from  Wang Yi wyhash, very similar to mumhash
-  uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xFFFFFFFF00000000ULL, lb = b & 0xFFFFFFFF00000000ULL;
-  uint64_t rh = ha * hb, rm_0 = ha * lb, rm_1 = hb * la, rl =  la * lb, t = rl + (rm_0<<32), c = t < rl;
-  b ^= 0x60bee2bee120fc15ull;
-  a = t + (rm_1 << 32); c += a < t; b = rh + (rm_0 >> 32) + (rm_1 >> 32) + c; a ^= b;
-  return a;
+{  // from  Wang Yi wyhash, very similar to mumhash (xor instead of sum)
+  crpx_mul128 (&a, &b);
+  return a ^ b;
 }
 
 inline uint32_t 
@@ -264,16 +266,17 @@ crpx_hashint_noxor_16bits (uint16_t x) // No multiplication; bias = 0.02384
 
 uint64_t
 crpx_hash_pearson_seed2048 (const void *vkey, size_t len, const void *vseed) // seed must have >= 256 bytes
-{ // https://github.com/maciejczyzewski/retter/blob/master/algorithms/Pearson/pearson.c
+{ /* https://github.com/maciejczyzewski/retter/blob/master/algorithms/Pearson/pearson.c
+   * The eight passes are independent chains, thus they are run together in one pass over the key. Originally the bytes
+   * were combined as "hash ^= h << (j * 8)" with h an unsigned char, i.e. an int shift which on x86 uses (j * 8) mod 32
+   * and is sign-extended to 64 bits: this is reproduced explicitly below, s.t. old hash values are preserved */
   const uint8_t *key = (const uint8_t *) vkey, *seed = (uint8_t *) vseed;
   uint64_t hash = 0;
-  unsigned char h = 0;
-  size_t i,j;
-  for (j = 0; j < 8; j++) {
-    h = seed[(key[0] + j) & 0xff ]; // 0xff = 255
-    for (i = 1; i < len; i++) h = seed[h ^ key[i]];
-    hash ^= h << (j * 8);
-  }
+  uint8_t h[8];
+  size_t i, j;
+  for (j = 0; j < 8; j++) h[j] = seed[(key[0] + j) & 0xff]; // 0xff = 255
+  for (i = 1; i < len; i++) for (j = 0; j < 8; j++) h[j] = seed[h[j] ^ key[i]];
+  for (j = 0; j < 8; j++) hash ^= (uint64_t)(int64_t)(int32_t)((uint32_t) h[j] << ((j * 8) & 31));
   return hash;
 }
 
@@ -315,33 +318,94 @@ crpx_hash_pseudocrc32_seed8192 (const void *vkey, size_t len, const void *vseed,
   return crc ^ ~0U;
 }
 
+bool
+crpx_hash_pseudocrc32_expand_seed (const void *vseed, void *vexpanded, int n_slices)
+{ /* slicing-by-N tables T_k[i] = (T_{k-1}[i] >> 8) ^ T_0[T_{k-1}[i] & 0xff] are only valid if T_0 is linear over GF(2),
+   * i.e. T_0[a ^ b] = T_0[a] ^ T_0[b], as in CRC tables (https://github.com/stbrumme/crc32). Random seeds are usually
+   * not linear, and then only bytewise crpx_hash_pseudocrc32_seed8192() gives the same result */
+  const uint32_t *seed = (const uint32_t *) vseed;
+  uint32_t *table = (uint32_t *) vexpanded, x;
+  int i, b, k;
+  for (i = 0; i < 256; i++) {
+    for (x = 0, b = 0; b < 8; b++) if (i & (1 << b)) x ^= seed[1 << b];
+    if (x != seed[i]) return false; // also checks that seed[0] == 0
+  }
+  memcpy (table, seed, 256 * sizeof (uint32_t));
+  for (k = 1; k < n_slices; k++) for (i = 0; i < 256; i++) {
+    x = table[(k - 1) * 256 + i];
+    table[k * 256 + i] = (x >> 8) ^ table[x & 0xff];
+  }
+  return true;
+}
+
+uint32_t
+crpx_hash_pseudocrc32_slicing8_seed65536 (const void *vkey, size_t len, const void *vexpanded, uint32_t crc)
+{ // same as crpx_hash_pseudocrc32_seed8192() for linear seeds, with 8 independent lookups per 8 bytes
+  const uint8_t *key = (const uint8_t*) vkey;
+  const uint32_t *t = (const uint32_t *) vexpanded;
+  uint64_t w;
+  crc = crc ^ ~0U;
+  for (; len >= 8; len -= 8, key += 8) {
+    memcpy (&w, key, 8);
+    w ^= crc;
+    crc = t[7 * 256 + (w & 0xff)]         ^ t[6 * 256 + ((w >> 8) & 0xff)]  ^ t[5 * 256 + ((w >> 16) & 0xff)] ^
+          t[4 * 256 + ((w >> 24) & 0xff)] ^ t[3 * 256 + ((w >> 32) & 0xff)] ^ t[2 * 256 + ((w >> 40) & 0xff)] ^
+          t[1 * 256 + ((w >> 48) & 0xff)] ^ t[w >> 56];
+  }
+  while (len--) crc = t[(crc ^ *key++) & 0xFF] ^ (crc >> 8);
+  return crc ^ ~0U;
+}
+
+uint32_t
+crpx_hash_pseudocrc32_slicing16_seed131072 (const void *vkey, size_t len, const void *vexpanded, uint32_t crc)
+{ // same as crpx_hash_pseudocrc32_seed8192() for linear seeds, with 16 independent lookups per 16 bytes
+  const uint8_t *key = (const uint8_t*) vkey;
+  const uint32_t *t = (const uint32_t *) vexpanded;
+  uint64_t w0, w1;
+  crc = crc ^ ~0U;
+  for (; len >= 16; len -= 16, key += 16) {
+    memcpy (&w0, key, 8);
+    memcpy (&w1, key + 8, 8);
+    w0 ^= crc;
+    crc = t[15 * 256 + (w0 & 0xff)]         ^ t[14 * 256 + ((w0 >> 8) & 0xff)]  ^ t[13 * 256 + ((w0 >> 16) & 0xff)] ^
+          t[12 * 256 + ((w0 >> 24) & 0xff)] ^ t[11 * 256 + ((w0 >> 32) & 0xff)] ^ t[10 * 256 + ((w0 >> 40) & 0xff)] ^
+          t[ 9 * 256 + ((w0 >> 48) & 0xff)] ^ t[ 8 * 256 + (w0 >> 56)] ^
+          t[ 7 * 256 + (w1 & 0xff)]         ^ t[ 6 * 256 + ((w1 >> 8) & 0xff)]  ^ t[ 5 * 256 + ((w1 >> 16) & 0xff)] ^
+          t[ 4 * 256 + ((w1 >> 24) & 0xff)] ^ t[ 3 * 256 + ((w1 >> 32) & 0xff)] ^ t[ 2 * 256 + ((w1 >> 40) & 0xff)] ^
+          t[ 1 * 256 + ((w1 >> 48) & 0xff)] ^ t[w1 >> 56];
+  }
+  while (len--) crc = t[(crc ^ *key++) & 0xFF] ^ (crc >> 8);
+  return crc ^ ~0U;
+}
+
 uint32_t 
 crpx_hash_jenkins_mailund_seed32 (const void *vkey, size_t len, void *vseed)
 { // https://github.com/mailund/hash/blob/master/HashFunctions/source/hash_strings.c
   uint8_t *input = (uint8_t*) vkey;
-  uint32_t a, b; a = b = 0x9e3779b9;
+  uint32_t a, b, w[3]; a = b = 0x9e3779b9;
   uint32_t c = *(uint32_t*)(vseed);
 
-  while (len >= 12) {
-      a += *((uint32_t*)input);
-      b += *((uint32_t*)input + 4);
-      c += *((uint32_t*)input + 8);
+  while (len >= 12) { // unaligned words 0..3, 4..7 and 8..11 of the block
+      memcpy (w, input, 12);
+      a += w[0];
+      b += w[1];
+      c += w[2];
       MIX32(a,b,c);
       input += 12;
       len -= 12;
   }
   c += len;
   switch(len) {
-      case 11: c += input[10] << 24; CRPX_attribute_FALLTHROUGH
-      case 10: c += input[9] << 16;  CRPX_attribute_FALLTHROUGH
-      case 9 : c += input[8] << 8;   CRPX_attribute_FALLTHROUGH
-      case 8 : b += input[7] << 24;  CRPX_attribute_FALLTHROUGH
-      case 7 : b += input[6] << 16;  CRPX_attribute_FALLTHROUGH
-      case 6 : b += input[5] << 8;   CRPX_attribute_FALLTHROUGH
+      case 11: c += (uint32_t) input[10] << 24; CRPX_attribute_FALLTHROUGH
+      case 10: c += (uint32_t) input[9] << 16;  CRPX_attribute_FALLTHROUGH
+      case 9 : c += (uint32_t) input[8] << 8;   CRPX_attribute_FALLTHROUGH
+      case 8 : b += (uint32_t) input[7] << 24;  CRPX_attribute_FALLTHROUGH
+      case 7 : b += (uint32_t) input[6] << 16;  CRPX_attribute_FALLTHROUGH
+      case 6 : b += (uint32_t) input[5] << 8;   CRPX_attribute_FALLTHROUGH
       case 5 : b += input[4];        CRPX_attribute_FALLTHROUGH
-      case 4 : a += input[3] << 24;  CRPX_attribute_FALLTHROUGH
-      case 3 : a += input[2] << 16;  CRPX_attribute_FALLTHROUGH
-      case 2 : a += input[1] << 8;   CRPX_attribute_FALLTHROUGH
+      case 4 : a += (uint32_t) input[3] << 24;  CRPX_attribute_FALLTHROUGH
+      case 3 : a += (uint32_t) input[2] << 16;  CRPX_attribute_FALLTHROUGH
+      case 2 : a += (uint32_t) input[1] << 8;   CRPX_attribute_FALLTHROUGH
       case 1 : a += input[0]; break;
   }
   MIX32(a,b,c);
@@ -433,7 +497,7 @@ crpx_hash_fletcher32 (const void *vkey, size_t len) // assumes vkey has pair num
  * For example, if a 16-bit block in the data word changes from 0x0000 to 0xFFFF, the Fletcher-32 checksum remains the same. */
   const uint16_t *key = (const uint16_t *) vkey;
   uint32_t sum1 = 0xffff, sum2 = 0xffff;
-  len <<= 1; // len is in bytes, but we assume 16 bits per key element
+  len >>= 1; // len is in bytes, but we assume 16 bits per key element
 
   while (len) {
     unsigned tlen = len > 359 ? 359 : len; // in https://github.com/opencoff/portable-lib they use 360
@@ -452,7 +516,7 @@ uint64_t
 crpx_fasthash64_seed64 (const void *vkey, size_t len, void *vseed)
 { // https://github.com/opencoff/portable-lib/blob/master/src/fasthash.c and https://github.com/drobilla/zix/blob/main/src/digest.c
   const uint64_t m = 0x880355f21e6d1965ULL;
-  const uint64_t *pos = (const uint64_t *) vkey, *end = pos + (len << 3);
+  const uint64_t *pos = (const uint64_t *) vkey, *end = pos + (len >> 3);
   uint64_t h = (*(uint64_t*)(vseed)) ^ (len * m);
   uint64_t v;
 
@@ -783,8 +847,8 @@ crpx_siphash128_seed128 (const void *in, const size_t inlen, const void *seed, v
   return crpx_wyhash64_mixer (result[0], result[1]);
 }
 
-uint64_t 
-crpx_siphash64_seed128 (const void *in, const size_t inlen, const void *seed)
+static inline uint64_t
+siphash64_rounds (const void *in, const size_t inlen, const void *seed, const uint8_t c_rounds, const uint8_t d_rounds)
 { // k is 16 bytes seed (128bits)
   const uint8_t *ni = (const uint8_t*) in;
   const uint8_t *kk = (const uint8_t*) seed;
@@ -792,7 +856,7 @@ crpx_siphash64_seed128 (const void *in, const size_t inlen, const void *seed)
   uint64_t k0 = U8TO64_LE(kk);
   uint64_t k1 = U8TO64_LE(kk + 8);
   uint64_t m;
-  uint8_t i, c_rounds = 2, d_rounds = 4; // main constants for algo, this means siphash-2-4
+  uint8_t i;
   const uint8_t *end = ni + inlen - (inlen % sizeof(uint64_t));
   const int left = inlen & 7;
   uint64_t b = ((uint64_t)inlen) << 56;
@@ -823,3 +887,58 @@ crpx_siphash64_seed128 (const void *in, const size_t inlen, const void *seed)
   for (i = 0; i < d_rounds; ++i) SIPROUND;
   return v0 ^ v1 ^ v2 ^ v3;
 }
+
+uint64_t 
+crpx_siphash64_seed128 (const void *in, const size_t inlen, const void *seed)
+{ // main constants for algo, this means siphash-2-4
+  return siphash64_rounds (in, inlen, seed, 2, 4);
+}
+
+uint64_t 
+crpx_siphash13_seed128 (const void *in, const size_t inlen, const void *seed)
+{ // siphash-1-3, as used by Rust's HashMap
+  return siphash64_rounds (in, inlen, seed, 1, 3);
+}
+
+static inline uint64_t wyr8 (const uint8_t *p) { uint64_t v; memcpy (&v, p, 8); return v; }
+static inline uint64_t wyr4 (const uint8_t *p) { uint32_t v; memcpy (&v, p, 4); return v; }
+static inline uint64_t wyr3 (const uint8_t *p, size_t k) { return (((uint64_t) p[0]) << 16) | (((uint64_t) p[k >> 1]) << 8) | p[k - 1]; }
+
+uint64_t
+crpx_wyhash64_seed64 (const void *vkey, size_t len, uint64_t seed)
+{ // https://github.com/wangyi-fudan/wyhash (final v4, default secret, little endian)
+  static const uint64_t secret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+  const uint8_t *p = (const uint8_t *) vkey;
+  uint64_t a, b;
+
+  seed ^= crpx_wyhash64_mixer (seed ^ secret[0], secret[1]);
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (wyr4 (p) << 32) | wyr4 (p + ((len >> 3) << 2));
+      b = (wyr4 (p + len - 4) << 32) | wyr4 (p + len - 4 - ((len >> 3) << 2));
+    }
+    else if (len > 0) { a = wyr3 (p, len); b = 0; }
+    else a = b = 0;
+  }
+  else {
+    size_t i = len;
+    if (i > 48) { // three independent lanes over 48 bytes
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = crpx_wyhash64_mixer (wyr8 (p)      ^ secret[1], wyr8 (p +  8) ^ seed);
+        see1 = crpx_wyhash64_mixer (wyr8 (p + 16) ^ secret[2], wyr8 (p + 24) ^ see1);
+        see2 = crpx_wyhash64_mixer (wyr8 (p + 32) ^ secret[3], wyr8 (p + 40) ^ see2);
+        p += 48; i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = crpx_wyhash64_mixer (wyr8 (p) ^ secret[1], wyr8 (p + 8) ^ seed);
+      i -= 16; p += 16;
+    }
+    a = wyr8 (p + i - 16); b = wyr8 (p + i - 8); // may overlap with bytes already consumed
+  }
+  a ^= secret[1]; b ^= seed;
+  crpx_mul128 (&a, &b);
+  return crpx_wyhash64_mixer (a ^ secret[0] ^ len, b ^ secret[1]);
+}
@@ -22,13 +22,15 @@ extern "C" {
 
 #include "maths_and_bits.h"
 
+/*! \brief full 64x64 -> 128 bits product: a receives the low and b the high 64 bits */
+extern void crpx_mul128 (uint64_t *a, uint64_t *b);
 extern uint64_t crpx_mumhash64_mixer (uint64_t a, uint64_t b);
 extern uint64_t crpx_wyhash64_mixer (uint64_t a, uint64_t b);
 extern uint32_t crpx_hash_64_to_32 (uint64_t key);
 
 extern uint64_t crpx_hashint_staffordmix64 (uint64_t z); // same as hashint_splitmix64 but adds prime number as initial state
 extern uint64_t crpx_hashint_splitmix64 (uint64_t x); // same as rng_splitmix with state=0 and hashint_staffordmix without state
-extern uint64_t crpx_hashint_spitmix64_inverse (uint64_t x);
+extern uint64_t crpx_hashint_splitmix64_inverse (uint64_t x);
 extern uint64_t crpx_hashint_degski64 (uint64_t x);
 extern uint64_t crpx_hashint_degski64_inverse (uint64_t x);
 extern uint64_t crpx_hashint_fastmix64 (uint64_t x); /*!< \brief compression, _not_ for RNG */
@@ -56,6 +58,11 @@ extern uint16_t crpx_hashint_noxor_16bits (uint16_t x); // No multiplication; bi
 
 uint64_t crpx_hash_pearson_seed2048 (const void *vkey, size_t len, const void *vseed); // seed must have >= 256 bytes
 uint32_t crpx_hash_pseudocrc32_seed8192 (const void *vkey, size_t len, const void *vseed, uint32_t crc); // seed >= 1024 bytes (256 x 32bits)
+/*! \brief builds n_slices x 256 x 32bits tables (8192 or 16384 bytes for 8 or 16 slices) from the 1024 bytes seed of pseudocrc32; returns false if
+ *  seed table is not linear (like a CRC table), in which case slicing cannot reproduce crpx_hash_pseudocrc32_seed8192() */
+bool crpx_hash_pseudocrc32_expand_seed (const void *vseed, void *vexpanded, int n_slices);
+uint32_t crpx_hash_pseudocrc32_slicing8_seed65536 (const void *vkey, size_t len, const void *vexpanded, uint32_t crc); // expanded seed with 8 slices
+uint32_t crpx_hash_pseudocrc32_slicing16_seed131072 (const void *vkey, size_t len, const void *vexpanded, uint32_t crc); // expanded seed with 16 slices
 uint32_t crpx_hash_fletcher32 (const void *vkey, size_t len); /*!< \brief _not_for RNG */  // len==pair (o.w. last byte is lost); 
 uint32_t crpx_hash_jenkins (const void *vkey, size_t len); /*!< \brief good dieharder propeties */
 
@@ -76,6 +83,9 @@ uint64_t crpx_murmurhash3_128bits (const void *key, const size_t len, const uint
 uint32_t crpx_murmurhash3_32bits (const void *data, const size_t nbytes, const uint32_t seed);
 uint64_t crpx_siphash128_seed128 (const void *in, const size_t inlen, const void *seed, void *out); // return 64 bits is a mixer of the 128bits, for true 64 bits use siphash64
 uint64_t crpx_siphash64_seed128 (const void *in, const size_t inlen, const void *seed);
+uint64_t crpx_siphash13_seed128 (const void *in, const size_t inlen, const void *seed); // faster siphash-1-3, 64 bits
+/*! \brief wyhash final v4 by Wang Yi: fastest high-quality hash for short keys (e.g. strings) */
+uint64_t crpx_wyhash64_seed64 (const void *vkey, size_t len, uint64_t seed);
 
 #ifdef __cplusplus
 }
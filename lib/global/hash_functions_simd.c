@@ -0,0 +1,638 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more 
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hash_functions_simd.c 
+ *  \brief CRC32C based on crc32c.c by Mark Adler (zlib license, https://stackoverflow.com/a/17646775) and on the GF(2)
+ *  polynomial arithmetic of zlib's crc32_combine(). Internal functions work on the raw CRC register (no inversions).
+ *  Stripe hash based on the long-input loop of XXH3 by Yann Collet (BSD license, https://github.com/Cyan4973/xxHash).
+ *  AES hash in the style of aHash (https://github.com/tkaitchuck/aHash) and meowhash, with a software AES round. */
+
+#include "hash_functions_simd.h"
+#include "internal_random_constants.h" // not available to the user, only locally
+
+#define CRC32C_POLY 0x82f63b78U /* reflected Castagnoli polynomial */
+#define CRC32C_3WAY_MIN 1536    /* below this length the cost of combining three streams is larger than the gain */
+
+static const uint32_t crc32c_byte_table[256] = {
+  0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c, 0x26a1e7e8, 0xd4ca64eb,
+  0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b, 0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24,
+  0x105ec76f, 0xe235446c, 0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+  0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc, 0xbc267848, 0x4e4dfb4b,
+  0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a, 0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35,
+  0xaa64d611, 0x580f5512, 0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+  0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad, 0x1642ae59, 0xe4292d5a,
+  0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a, 0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595,
+  0x417b1dbc, 0xb3109ebf, 0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+  0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f, 0xed03a29b, 0x1f682198,
+  0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927, 0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38,
+  0xdbfc821c, 0x2997011f, 0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+  0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e, 0x4767748a, 0xb50cf789,
+  0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859, 0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46,
+  0x7198540d, 0x83f3d70e, 0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+  0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de, 0xdde0eb2a, 0x2f8b6829,
+  0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c, 0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93,
+  0x082f63b7, 0xfa44e0b4, 0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+  0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b, 0xb4091bff, 0x466298fc,
+  0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c, 0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033,
+  0xa24bb5a6, 0x502036a5, 0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+  0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975, 0x0e330a81, 0xfc588982,
+  0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d, 0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622,
+  0x38cc2a06, 0xcaa7a905, 0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+  0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8, 0xe52cc12c, 0x1747422f,
+  0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff, 0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0,
+  0xd3d3e1ab, 0x21b862a8, 0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+  0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78, 0x7fab5e8c, 0x8dc0dd8f,
+  0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee, 0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1,
+  0x69e9f0d5, 0x9b8273d6, 0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+  0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69, 0xd5cf889d, 0x27a40b9e,
+  0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
+};
+
+/* x^(2^k) modulo the CRC polynomial, for k = 0...31 */
+static const uint32_t crc32c_x2n_table[32] = {
+  0x40000000, 0x20000000, 0x08000000, 0x00800000, 0x00008000, 0x82f63b78, 0x6ea2d55c, 0x18b8ea18,
+  0x510ac59a, 0xb82be955, 0xb8fdb1e7, 0x88e56f72, 0x74c360a4, 0xe4172b16, 0x0d65762a, 0x35d73a62,
+  0x28461564, 0xbf455269, 0xe2ea32dc, 0xfe7740e6, 0xf946610b, 0x3c204f8f, 0x538586e3, 0x59726915,
+  0x734d5309, 0xbc1ac763, 0x7d0722cc, 0xd289cabe, 0xe94ca9bc, 0x05b74f3f, 0xa51e1f42, 0x40000000
+};
+
+static uint32_t
+crc32c_multmodp (uint32_t a, uint32_t b)
+{ // a(x) * b(x) modulo p(x), in reflected bit order
+  uint32_t m = 1U << 31, p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) break;
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+  }
+  return p;
+}
+
+static uint32_t
+crc32c_x2nmodp (size_t n, unsigned k)
+{ // x^(n * 2^k) modulo p(x)
+  uint32_t p = 1U << 31; // x^0 == 1
+  for (; n; n >>= 1, k++) if (n & 1) p = crc32c_multmodp (crc32c_x2n_table[k & 31], p);
+  return p;
+}
+
+uint32_t
+crpx_crc32c_combine (uint32_t crc1, uint32_t crc2, size_t len2)
+{
+  return crc32c_multmodp (crc32c_x2nmodp (len2, 3), crc1) ^ crc2;
+}
+
+static inline uint32_t
+crc32c_table_raw (const uint8_t *p, size_t len, uint32_t crc)
+{
+  while (len--) crc = crc32c_byte_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+uint32_t
+crpx_crc32c_table (const void *data, size_t len, uint32_t crc)
+{
+  return ~crc32c_table_raw ((const uint8_t *) data, len, ~crc);
+}
+
+static inline uint64_t
+crc32c_seed64_final (uint32_t a, uint32_t b, size_t len, uint64_t seed)
+{
+  return crpx_hashint_murmurmix64 ((((uint64_t) a << 32) | b) ^ (seed + len));
+}
+
+uint64_t
+crpx_crc32c_seed64_table (const void *data, size_t len, uint64_t seed)
+{ // the lanes take alternate 8-byte words; the remaining 8-byte word goes to lane a and the tail bytes to lane b
+  const uint8_t *p = (const uint8_t *) data;
+  uint32_t a = (uint32_t) seed, b = (uint32_t) (seed >> 32);
+  size_t n = len;
+  for (; n >= 16; n -= 16, p += 16) { a = crc32c_table_raw (p, 8, a); b = crc32c_table_raw (p + 8, 8, b); }
+  if (n >= 8) { a = crc32c_table_raw (p, 8, a); n -= 8; p += 8; }
+  b = crc32c_table_raw (p, n, b);
+  return crc32c_seed64_final (a, b, len, seed);
+}
+
+#ifdef __SSE4_2__
+static inline uint32_t
+crc32c_sse42_raw (const uint8_t *p, size_t len, uint32_t crc)
+{
+  uint64_t c = crc, w;
+  for (; len >= 8; len -= 8, p += 8) { memcpy (&w, p, 8); c = _mm_crc32_u64 (c, w); }
+  crc = (uint32_t) c;
+  for (; len; len--) crc = _mm_crc32_u8 (crc, *p++);
+  return crc;
+}
+
+uint32_t
+crpx_crc32c_sse42 (const void *data, size_t len, uint32_t crc)
+{ /* the crc32 instruction has a latency of 3 cycles but a throughput of 1 per cycle, thus three independent streams
+   * over consecutive blocks of L bytes keep it busy. The block CRCs are combined as crc = (crc0 * x^8L + crc1) * x^8L + crc2;
+   * L is a power of two s.t. x^8L comes straight from the table, and blocks are repeated over the remaining data */
+  const uint8_t *p = (const uint8_t *) data;
+  uint64_t c0, c1, c2, w0, w1, w2;
+  size_t i, block;
+  crc = ~crc;
+  while (len >= CRC32C_3WAY_MIN) {
+    block = 1UL << (63 - __builtin_clzl (CRPX_MIN (len / 3, 1UL << 24)));
+    c0 = crc; c1 = c2 = 0;
+    for (i = 0; i < block; i += 8) {
+      memcpy (&w0, p + i, 8); memcpy (&w1, p + block + i, 8); memcpy (&w2, p + 2 * block + i, 8);
+      c0 = _mm_crc32_u64 (c0, w0);
+      c1 = _mm_crc32_u64 (c1, w1);
+      c2 = _mm_crc32_u64 (c2, w2);
+    }
+    w0 = crc32c_x2n_table[__builtin_ctzl (block) + 3]; // x^(8 * block)
+    crc = crc32c_multmodp ((uint32_t) w0, (uint32_t) c0) ^ (uint32_t) c1;
+    crc = crc32c_multmodp ((uint32_t) w0, crc) ^ (uint32_t) c2;
+    p += 3 * block;
+    len -= 3 * block;
+  }
+  return ~crc32c_sse42_raw (p, len, crc);
+}
+
+uint64_t
+crpx_crc32c_seed64_sse42 (const void *data, size_t len, uint64_t seed)
+{
+  const uint8_t *p = (const uint8_t *) data;
+  uint64_t a = (uint32_t) seed, b = seed >> 32, w0, w1;
+  size_t n = len;
+  for (; n >= 16; n -= 16, p += 16) {
+    memcpy (&w0, p, 8); memcpy (&w1, p + 8, 8);
+    a = _mm_crc32_u64 (a, w0);
+    b = _mm_crc32_u64 (b, w1);
+  }
+  if (n >= 8) { memcpy (&w0, p, 8); a = _mm_crc32_u64 (a, w0); n -= 8; p += 8; }
+  return crc32c_seed64_final ((uint32_t) a, crc32c_sse42_raw (p, n, (uint32_t) b), len, seed);
+}
+#endif
+
+/* XXH3-style stripe hash: eight 64-bit accumulators receive each 64-byte stripe, xored with a sliding window over the
+ * secret; after each block of XXH3_STRIPES stripes they are scrambled. The kernels below update the same accumulators
+ * with scalar, SSE2 or AVX2 instructions. Short inputs are hashed with wyhash instead. */
+
+#define XXH3_SECRET_SIZE 192  /* bytes taken from crpx_list_of_128_random64[] */
+#define XXH3_STRIPE_LEN 64
+#define XXH3_STRIPES ((XXH3_SECRET_SIZE - XXH3_STRIPE_LEN) / 8)
+#define XXH3_BLOCK_LEN (XXH3_STRIPE_LEN * XXH3_STRIPES)
+#define XXH3_MIN_LONG 240    /* shorter inputs use wyhash */
+#define XXH3_PRIME32_1 0x9E3779B1U
+#define XXH3_PRIME32_2 0x85EBCA77U
+#define XXH3_PRIME32_3 0xC2B2AE3DU
+#define XXH3_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH3_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH3_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH3_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH3_PRIME64_5 0x27D4EB2F165667C5ULL
+
+typedef void (*xxh3_accumulate_func) (uint64_t *acc, const uint8_t *p, const uint8_t *secret);
+typedef void (*xxh3_scramble_func) (uint64_t *acc, const uint8_t *secret);
+
+static inline uint64_t xxh3_read64 (const uint8_t *p) { uint64_t v; memcpy (&v, p, 8); return v; }
+
+static inline void
+xxh3_accumulate_scalar (uint64_t *acc, const uint8_t *p, const uint8_t *secret)
+{
+  for (int i = 0; i < 8; i++) {
+    uint64_t data = xxh3_read64 (p + 8 * i), key = data ^ xxh3_read64 (secret + 8 * i);
+    acc[i ^ 1] += data;
+    acc[i] += (key & 0xffffffffULL) * (key >> 32);
+  }
+}
+
+static inline void
+xxh3_scramble_scalar (uint64_t *acc, const uint8_t *secret)
+{
+  for (int i = 0; i < 8; i++) {
+    acc[i] ^= acc[i] >> 47;
+    acc[i] ^= xxh3_read64 (secret + 8 * i);
+    acc[i] *= XXH3_PRIME32_1;
+  }
+}
+
+static inline __attribute__((always_inline)) void
+xxh3_hash_long (uint64_t *acc, const uint8_t *p, size_t len, const uint8_t *secret, xxh3_accumulate_func accumulate, xxh3_scramble_func scramble)
+{ // the function pointers are constants after inlining, thus each kernel gets its own copy of the loop
+  size_t n_blocks = (len - 1) / XXH3_BLOCK_LEN, n_stripes, b, s;
+  acc[0] = XXH3_PRIME32_3; acc[1] = XXH3_PRIME64_1; acc[2] = XXH3_PRIME64_2; acc[3] = XXH3_PRIME64_3;
+  acc[4] = XXH3_PRIME64_4; acc[5] = XXH3_PRIME32_2; acc[6] = XXH3_PRIME64_5; acc[7] = XXH3_PRIME32_1;
+  for (b = 0; b < n_blocks; b++, p += XXH3_BLOCK_LEN) {
+    for (s = 0; s < XXH3_STRIPES; s++) accumulate (acc, p + s * XXH3_STRIPE_LEN, secret + s * 8);
+    scramble (acc, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN);
+  }
+  len -= n_blocks * XXH3_BLOCK_LEN; // last block (incomplete) and then last stripe, which may overlap previous one
+  n_stripes = (len - 1) / XXH3_STRIPE_LEN;
+  for (s = 0; s < n_stripes; s++) accumulate (acc, p + s * XXH3_STRIPE_LEN, secret + s * 8);
+  accumulate (acc, p + len - XXH3_STRIPE_LEN, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - 7);
+}
+
+static uint64_t
+xxh3_merge (const uint64_t *acc, const uint8_t *secret, uint64_t h)
+{
+  for (int i = 0; i < 4; i++)
+    h += crpx_wyhash64_mixer (acc[2 * i] ^ xxh3_read64 (secret + 16 * i), acc[2 * i + 1] ^ xxh3_read64 (secret + 16 * i + 8));
+  h ^= h >> 37; h *= 0x165667919E3779F9ULL;
+  return h ^ (h >> 32);
+}
+
+static const uint8_t *
+xxh3_secret (uint64_t *custom, uint64_t seed)
+{ // seeded secret as in XXH3: seed added to even and subtracted from odd words
+  if (!seed) return (const uint8_t *) crpx_list_of_128_random64;
+  for (int i = 0; i < XXH3_SECRET_SIZE / 8; i += 2) {
+    custom[i]     = crpx_list_of_128_random64[i] + seed;
+    custom[i + 1] = crpx_list_of_128_random64[i + 1] - seed;
+  }
+  return (const uint8_t *) custom;
+}
+
+static uint64_t
+xxh3_finalise (const uint64_t *acc, const uint8_t *secret, size_t len, void *out)
+{
+  uint64_t h = xxh3_merge (acc, secret + 11, (uint64_t) len * XXH3_PRIME64_1);
+  if (out) {
+    ((uint64_t *) out)[0] = h;
+    ((uint64_t *) out)[1] = xxh3_merge (acc, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - 11, ~((uint64_t) len * XXH3_PRIME64_2));
+  }
+  return h;
+}
+
+static uint64_t
+xxh3_short (const void *data, size_t len, uint64_t seed, void *out)
+{
+  uint64_t h = crpx_wyhash64_seed64 (data, len, seed);
+  if (out) {
+    ((uint64_t *) out)[0] = h;
+    ((uint64_t *) out)[1] = crpx_wyhash64_seed64 (data, len, seed ^ XXH3_PRIME64_4);
+  }
+  return h;
+}
+
+uint64_t
+crpx_xxh3_seed64_scalar (const void *data, size_t len, uint64_t seed, void *out)
+{
+  uint64_t acc[8], custom[XXH3_SECRET_SIZE / 8];
+  if (len <= XXH3_MIN_LONG) return xxh3_short (data, len, seed, out);
+  const uint8_t *secret = xxh3_secret (custom, seed);
+  xxh3_hash_long (acc, (const uint8_t *) data, len, secret, xxh3_accumulate_scalar, xxh3_scramble_scalar);
+  return xxh3_finalise (acc, secret, len, out);
+}
+
+#ifdef __SSE4_2__
+static inline void
+xxh3_accumulate_sse2 (uint64_t *acc, const uint8_t *p, const uint8_t *secret)
+{ // _mm_mul_epu32() multiplies the low 32 bits of each 64-bit lane, the shuffle brings the high bits down
+  __m128i *a = (__m128i *) acc;
+  for (int i = 0; i < 4; i++) {
+    __m128i data = _mm_loadu_si128 ((const __m128i *) (p + 16 * i));
+    __m128i key  = _mm_xor_si128 (data, _mm_loadu_si128 ((const __m128i *) (secret + 16 * i)));
+    __m128i prod = _mm_mul_epu32 (key, _mm_shuffle_epi32 (key, _MM_SHUFFLE (0, 3, 0, 1)));
+    __m128i sum  = _mm_add_epi64 (_mm_loadu_si128 (a + i), _mm_shuffle_epi32 (data, _MM_SHUFFLE (1, 0, 3, 2)));
+    _mm_storeu_si128 (a + i, _mm_add_epi64 (prod, sum));
+  }
+}
+
+static inline void
+xxh3_scramble_sse2 (uint64_t *acc, const uint8_t *secret)
+{
+  __m128i *a = (__m128i *) acc, prime = _mm_set1_epi32 ((int) XXH3_PRIME32_1);
+  for (int i = 0; i < 4; i++) {
+    __m128i x = _mm_loadu_si128 (a + i);
+    x = _mm_xor_si128 (x, _mm_srli_epi64 (x, 47));
+    x = _mm_xor_si128 (x, _mm_loadu_si128 ((const __m128i *) (secret + 16 * i)));
+    __m128i lo = _mm_mul_epu32 (x, prime), hi = _mm_mul_epu32 (_mm_shuffle_epi32 (x, _MM_SHUFFLE (0, 3, 0, 1)), prime);
+    _mm_storeu_si128 (a + i, _mm_add_epi64 (lo, _mm_slli_epi64 (hi, 32)));
+  }
+}
+
+uint64_t
+crpx_xxh3_seed64_sse42 (const void *data, size_t len, uint64_t seed, void *out)
+{
+  uint64_t acc[8], custom[XXH3_SECRET_SIZE / 8];
+  if (len <= XXH3_MIN_LONG) return xxh3_short (data, len, seed, out);
+  const uint8_t *secret = xxh3_secret (custom, seed);
+  xxh3_hash_long (acc, (const uint8_t *) data, len, secret, xxh3_accumulate_sse2, xxh3_scramble_sse2);
+  return xxh3_finalise (acc, secret, len, out);
+}
+#endif
+
+#ifdef __AVX2__
+static inline void
+xxh3_accumulate_avx2 (uint64_t *acc, const uint8_t *p, const uint8_t *secret)
+{
+  __m256i *a = (__m256i *) acc;
+  for (int i = 0; i < 2; i++) {
+    __m256i data = _mm256_loadu_si256 ((const __m256i *) (p + 32 * i));
+    __m256i key  = _mm256_xor_si256 (data, _mm256_loadu_si256 ((const __m256i *) (secret + 32 * i)));
+    __m256i prod = _mm256_mul_epu32 (key, _mm256_shuffle_epi32 (key, _MM_SHUFFLE (0, 3, 0, 1)));
+    __m256i sum  = _mm256_add_epi64 (_mm256_loadu_si256 (a + i), _mm256_shuffle_epi32 (data, _MM_SHUFFLE (1, 0, 3, 2)));
+    _mm256_storeu_si256 (a + i, _mm256_add_epi64 (prod, sum));
+  }
+}
+
+static inline void
+xxh3_scramble_avx2 (uint64_t *acc, const uint8_t *secret)
+{
+  __m256i *a = (__m256i *) acc, prime = _mm256_set1_epi32 ((int) XXH3_PRIME32_1);
+  for (int i = 0; i < 2; i++) {
+    __m256i x = _mm256_loadu_si256 (a + i);
+    x = _mm256_xor_si256 (x, _mm256_srli_epi64 (x, 47));
+    x = _mm256_xor_si256 (x, _mm256_loadu_si256 ((const __m256i *) (secret + 32 * i)));
+    __m256i lo = _mm256_mul_epu32 (x, prime), hi = _mm256_mul_epu32 (_mm256_shuffle_epi32 (x, _MM_SHUFFLE (0, 3, 0, 1)), prime);
+    _mm256_storeu_si256 (a + i, _mm256_add_epi64 (lo, _mm256_slli_epi64 (hi, 32)));
+  }
+}
+
+uint64_t
+crpx_xxh3_seed64_avx2 (const void *data, size_t len, uint64_t seed, void *out)
+{
+  uint64_t acc[8], custom[XXH3_SECRET_SIZE / 8];
+  if (len <= XXH3_MIN_LONG) return xxh3_short (data, len, seed, out);
+  const uint8_t *secret = xxh3_secret (custom, seed);
+  xxh3_hash_long (acc, (const uint8_t *) data, len, secret, xxh3_accumulate_avx2, xxh3_scramble_avx2);
+  return xxh3_finalise (acc, secret, len, out);
+}
+#endif
+
+/* AES hash: the data is xored into 128-bit lanes, which are then mixed by one AES encryption round (SubBytes, ShiftRows,
+ * MixColumns and xor with round key, as the aesenc instruction). Two rounds spread each byte over the whole lane, thus
+ * keys up to 16 bytes need three rounds in total, and longer keys use four independent lanes over 64-byte blocks. The
+ * software round is slow, and is used only to give the same results on hosts without AES-NI */
+
+static const uint8_t aes_sbox[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static const uint64_t aes_lane_constant[3][2] = { // hexadecimal digits of pi, to derive lane keys from the seed
+  {0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL}, {0xa4093822299f31d0ULL, 0x082efa98ec4e6c89ULL},
+  {0x452821e638d01377ULL, 0xbe5466cf34e90c6cULL}};
+
+typedef struct { uint64_t w[2]; } aes_block_t; /* same memory layout as __m128i */
+
+static inline uint8_t aes_xtime (uint8_t x) { return (uint8_t) ((x << 1) ^ ((x >> 7) * 0x1b)); }
+
+static inline aes_block_t
+aes_xor (aes_block_t a, aes_block_t b)
+{
+  a.w[0] ^= b.w[0]; a.w[1] ^= b.w[1];
+  return a;
+}
+
+static inline aes_block_t
+aes_round_soft (aes_block_t state, aes_block_t key)
+{ // same as _mm_aesenc_si128(): byte i of the state is row i%4, column i/4
+  uint8_t s[16], t[16];
+  int r, c;
+  memcpy (s, state.w, 16);
+  for (c = 0; c < 4; c++) for (r = 0; r < 4; r++) t[r + 4 * c] = aes_sbox[s[r + 4 * ((c + r) & 3)]]; // ShiftRows and SubBytes
+  for (c = 0; c < 4; c++) { // MixColumns
+    uint8_t *a = t + 4 * c, all = a[0] ^ a[1] ^ a[2] ^ a[3], a0 = a[0];
+    s[4 * c + 0] = a[0] ^ all ^ aes_xtime (a[0] ^ a[1]);
+    s[4 * c + 1] = a[1] ^ all ^ aes_xtime (a[1] ^ a[2]);
+    s[4 * c + 2] = a[2] ^ all ^ aes_xtime (a[2] ^ a[3]);
+    s[4 * c + 3] = a[3] ^ all ^ aes_xtime (a[3] ^ a0);
+  }
+  memcpy (state.w, s, 16);
+  return aes_xor (state, key);
+}
+
+static inline aes_block_t
+aes_load_short (const uint8_t *p, size_t len)
+{ // keys of up to 16 bytes are read as two (possibly overlapping) words, avoiding a copy into a zeroed buffer
+  aes_block_t x = {{0, 0}};
+  uint32_t a, b;
+  if (len >= 8) { memcpy (x.w, p, 8); memcpy (x.w + 1, p + len - 8, 8); }
+  else if (len >= 4) { memcpy (&a, p, 4); memcpy (&b, p + len - 4, 4); x.w[0] = ((uint64_t) b << 32) | a; }
+  else if (len > 0) x.w[0] = (((uint64_t) p[0]) << 16) | (((uint64_t) p[len >> 1]) << 8) | p[len - 1];
+  return x;
+}
+
+static inline aes_block_t
+aes_load (const uint8_t *p)
+{
+  aes_block_t x;
+  memcpy (x.w, p, 16);
+  return x;
+}
+
+uint64_t
+crpx_aeshash_seed128_soft (const void *data, size_t len, const void *seed)
+{
+  const uint8_t *p = (const uint8_t *) data;
+  aes_block_t k[4], h, s[4], lenblock = {{(uint64_t) len, 0}};
+  int i;
+  memcpy (k[0].w, seed, 16);
+  for (i = 1; i < 4; i++) { k[i].w[0] = k[0].w[0] ^ aes_lane_constant[i-1][0]; k[i].w[1] = k[0].w[1] ^ aes_lane_constant[i-1][1]; }
+  h = aes_xor (k[0], lenblock);
+  if (len <= 16) h = aes_round_soft (aes_xor (h, aes_load_short (p, len)), k[1]);
+  else if (len <= 32) { // first and last 16 bytes, which may overlap
+    h = aes_round_soft (aes_xor (h, aes_load (p)), k[1]);
+    h = aes_round_soft (aes_xor (h, aes_load (p + len - 16)), k[2]);
+  }
+  else { // blocks of 64 bytes, and then last 64 (or last 33~64) bytes, which may overlap previous ones
+    size_t n = CRPX_MIN (len, 64);
+    const uint8_t *end = p + len - n;
+    for (i = 0; i < 4; i++) s[i] = aes_xor (k[i], lenblock);
+    for (; p < end; p += 64) for (i = 0; i < 4; i++) s[i] = aes_round_soft (aes_xor (s[i], aes_load (p + 16 * i)), k[i]);
+    s[0] = aes_round_soft (aes_xor (s[0], aes_load (end)), k[1]);
+    s[1] = aes_round_soft (aes_xor (s[1], aes_load (end + 16)), k[2]);
+    s[2] = aes_round_soft (aes_xor (s[2], aes_load (end + n - 32)), k[3]);
+    s[3] = aes_round_soft (aes_xor (s[3], aes_load (end + n - 16)), k[0]);
+    h = aes_round_soft (aes_round_soft (aes_round_soft (s[0], s[1]), s[2]), s[3]);
+  }
+  h = aes_round_soft (aes_round_soft (h, k[2]), k[3]);
+  return h.w[0] ^ h.w[1];
+}
+
+#ifdef __AES__
+uint64_t
+crpx_aeshash_seed128_aesni (const void *data, size_t len, const void *seed)
+{
+  const uint8_t *p = (const uint8_t *) data;
+  __m128i k[4], h, s[4], lenblock = _mm_set_epi64x (0, (int64_t) len);
+  int i;
+  k[0] = _mm_loadu_si128 ((const __m128i *) seed);
+  for (i = 1; i < 4; i++) k[i] = _mm_xor_si128 (k[0], _mm_loadu_si128 ((const __m128i *) aes_lane_constant[i-1]));
+  h = _mm_xor_si128 (k[0], lenblock);
+  if (len <= 16) {
+    aes_block_t x = aes_load_short (p, len);
+    h = _mm_aesenc_si128 (_mm_xor_si128 (h, _mm_set_epi64x ((int64_t) x.w[1], (int64_t) x.w[0])), k[1]);
+  }
+  else if (len <= 32) {
+    h = _mm_aesenc_si128 (_mm_xor_si128 (h, _mm_loadu_si128 ((const __m128i *) p)), k[1]);
+    h = _mm_aesenc_si128 (_mm_xor_si128 (h, _mm_loadu_si128 ((const __m128i *) (p + len - 16))), k[2]);
+  }
+  else {
+    size_t n = CRPX_MIN (len, 64);
+    const uint8_t *end = p + len - n;
+    for (i = 0; i < 4; i++) s[i] = _mm_xor_si128 (k[i], lenblock);
+    for (; p < end; p += 64) for (i = 0; i < 4; i++)
+      s[i] = _mm_aesenc_si128 (_mm_xor_si128 (s[i], _mm_loadu_si128 ((const __m128i *) (p + 16 * i))), k[i]);
+    s[0] = _mm_aesenc_si128 (_mm_xor_si128 (s[0], _mm_loadu_si128 ((const __m128i *) end)), k[1]);
+    s[1] = _mm_aesenc_si128 (_mm_xor_si128 (s[1], _mm_loadu_si128 ((const __m128i *) (end + 16))), k[2]);
+    s[2] = _mm_aesenc_si128 (_mm_xor_si128 (s[2], _mm_loadu_si128 ((const __m128i *) (end + n - 32))), k[3]);
+    s[3] = _mm_aesenc_si128 (_mm_xor_si128 (s[3], _mm_loadu_si128 ((const __m128i *) (end + n - 16))), k[0]);
+    h = _mm_aesenc_si128 (_mm_aesenc_si128 (_mm_aesenc_si128 (s[0], s[1]), s[2]), s[3]);
+  }
+  h = _mm_aesenc_si128 (_mm_aesenc_si128 (h, k[2]), k[3]);
+  return (uint64_t) _mm_cvtsi128_si64 (_mm_xor_si128 (h, _mm_unpackhi_epi64 (h, h)));
+}
+#endif
+
+/* SipHash over a batch of independent keys, one key per 64 bits lane of AVX2 registers. Lanes advance one message
+ * word at a time; a lane whose key is shorter than the longest in its group keeps its state (by a blend)
+ * after its last word. To waste less work, blocks of keys are sorted by number of words before being split into
+ * groups. Same output as the scalar versions */
+
+#define SIPHASH_BLOCK 256     /* keys sorted at once */
+#define SIPHASH_MAX_CLASS 32  /* keys with more words than this share the same class */
+
+static inline uint64_t siphash_read64 (const uint8_t *p) { uint64_t v; memcpy (&v, p, 8); return v; }
+
+static inline uint64_t
+siphash_lane_word (const uint8_t *p, size_t len, size_t j)
+{ // j-th message word, where the last word (j = len/8) has the length in the top byte and the tail bytes below it
+  uint64_t w = 0, r = len & 7;
+  if (j < len / 8) return siphash_read64 (p + 8 * j);
+  if (r && (len >= 8)) w = siphash_read64 (p + len - 8) >> (64 - 8 * r); // overlapping read ending at last byte
+  else if (r >= 4) { uint32_t a, b; memcpy (&a, p, 4); memcpy (&b, p + r - 4, 4); w = a | ((uint64_t) b << (8 * (r - 4))); }
+  else if (r) w = p[0] | ((uint64_t) p[r/2] << (8 * (r/2))) | ((uint64_t) p[r-1] << (8 * (r-1)));
+  return w | ((uint64_t) len << 56);
+}
+
+static inline size_t
+siphash_key_length (const void * const *data, const size_t *len, size_t i)
+{
+  return len ? len[i] : strlen ((const char *) data[i]);
+}
+
+static void
+siphash_sort_block (const void * const *data, const size_t *len, size_t n, size_t *l, uint16_t *order)
+{ // stable counting sort of up to SIPHASH_BLOCK keys by number of words; l[] receives the key lengths
+  size_t count[SIPHASH_MAX_CLASS + 2] = {0}, i;
+  for (i = 0; i < n; i++) {
+    l[i] = siphash_key_length (data, len, i);
+    count[CRPX_MIN (l[i] / 8, SIPHASH_MAX_CLASS) + 1]++;
+  }
+  for (i = 1; i < SIPHASH_MAX_CLASS + 2; i++) count[i] += count[i-1];
+  for (i = 0; i < n; i++) order[ count[CRPX_MIN (l[i] / 8, SIPHASH_MAX_CLASS)]++ ] = (uint16_t) i;
+}
+
+void
+crpx_siphash_batch_scalar (const void * const *data, const size_t *len, size_t n, const void *seed, bool siphash13, uint64_t *out)
+{
+  for (size_t i = 0; i < n; i++) {
+    if (siphash13) out[i] = crpx_siphash13_seed128 (data[i], siphash_key_length (data, len, i), seed);
+    else           out[i] = crpx_siphash64_seed128 (data[i], siphash_key_length (data, len, i), seed);
+  }
+}
+
+#ifdef __AVX2__
+#define SIP_ROTL_AVX2(x,b) _mm256_or_si256 (_mm256_slli_epi64 ((x), (b)), _mm256_srli_epi64 ((x), 64 - (b)))
+#define SIP_AVX2_KEYS 8 /* two sets of registers with four lanes each, interleaved to hide the latency of each round */
+
+static inline __attribute__((always_inline)) void
+siphash_round_avx2 (__m256i v[4])
+{ // rotations by 32 and 16 bits are shuffles
+  const __m256i rot16 = _mm256_set_epi8 (13, 12, 11, 10, 9, 8, 15, 14, 5, 4, 3, 2, 1, 0, 7, 6,
+                                         13, 12, 11, 10, 9, 8, 15, 14, 5, 4, 3, 2, 1, 0, 7, 6);
+  v[0] = _mm256_add_epi64 (v[0], v[1]); v[1] = _mm256_xor_si256 (SIP_ROTL_AVX2 (v[1], 13), v[0]); v[0] = _mm256_shuffle_epi32 (v[0], 0xb1);
+  v[2] = _mm256_add_epi64 (v[2], v[3]); v[3] = _mm256_xor_si256 (_mm256_shuffle_epi8 (v[3], rot16), v[2]);
+  v[0] = _mm256_add_epi64 (v[0], v[3]); v[3] = _mm256_xor_si256 (SIP_ROTL_AVX2 (v[3], 21), v[0]);
+  v[2] = _mm256_add_epi64 (v[2], v[1]); v[1] = _mm256_xor_si256 (SIP_ROTL_AVX2 (v[1], 17), v[2]); v[2] = _mm256_shuffle_epi32 (v[2], 0xb1);
+}
+
+static inline __attribute__((always_inline)) void
+siphash_group_avx2 (const uint8_t **p, const size_t *len, const uint64_t *key, const uint8_t c_rounds, const uint8_t d_rounds, uint64_t *out)
+{ // always inlined with constant rounds, s.t. loops over rounds are unrolled
+  size_t j, n_full = len[0], n_words = len[0];
+  __m256i v[2][4], old[4], m[2], active, k0 = _mm256_set1_epi64x ((int64_t) key[0]), k1 = _mm256_set1_epi64x ((int64_t) key[1]);
+  int64_t w[SIP_AVX2_KEYS], a[SIP_AVX2_KEYS];
+  uint8_t i, g;
+  for (i = 1; i < SIP_AVX2_KEYS; i++) { n_full = CRPX_MIN (n_full, len[i]); n_words = CRPX_MAX (n_words, len[i]); }
+  n_full /= 8; n_words = n_words / 8 + 1;
+  for (g = 0; g < 2; g++) {
+    v[g][0] = _mm256_xor_si256 (k0, _mm256_set1_epi64x (0x736f6d6570736575LL));
+    v[g][1] = _mm256_xor_si256 (k1, _mm256_set1_epi64x (0x646f72616e646f6dLL));
+    v[g][2] = _mm256_xor_si256 (k0, _mm256_set1_epi64x (0x6c7967656e657261LL));
+    v[g][3] = _mm256_xor_si256 (k1, _mm256_set1_epi64x (0x7465646279746573LL));
+  }
+  for (j = 0; j < n_full; j++) { // all lanes have full words
+    for (g = 0; g < 2; g++) {
+      m[g] = _mm256_set_epi64x ((int64_t) siphash_read64 (p[4*g+3] + 8 * j), (int64_t) siphash_read64 (p[4*g+2] + 8 * j),
+                                (int64_t) siphash_read64 (p[4*g+1] + 8 * j), (int64_t) siphash_read64 (p[4*g] + 8 * j));
+      v[g][3] = _mm256_xor_si256 (v[g][3], m[g]);
+    }
+    for (i = 0; i < c_rounds; i++) { siphash_round_avx2 (v[0]); siphash_round_avx2 (v[1]); }
+    for (g = 0; g < 2; g++) v[g][0] = _mm256_xor_si256 (v[g][0], m[g]);
+  }
+  for (; j < n_words; j++) { // lanes after their last word are not updated
+    for (i = 0; i < SIP_AVX2_KEYS; i++) {
+      a[i] = (j <= len[i] / 8) ? -1 : 0;
+      w[i] = a[i] ? (int64_t) siphash_lane_word (p[i], len[i], j) : 0;
+    }
+    for (g = 0; g < 2; g++) {
+      m[g] = _mm256_loadu_si256 ((const __m256i *) (w + 4 * g));
+      active = _mm256_loadu_si256 ((const __m256i *) (a + 4 * g));
+      for (i = 0; i < 4; i++) old[i] = v[g][i];
+      v[g][3] = _mm256_xor_si256 (v[g][3], m[g]);
+      for (i = 0; i < c_rounds; i++) siphash_round_avx2 (v[g]);
+      v[g][0] = _mm256_xor_si256 (v[g][0], m[g]);
+      for (i = 0; i < 4; i++) v[g][i] = _mm256_blendv_epi8 (old[i], v[g][i], active);
+    }
+  }
+  for (g = 0; g < 2; g++) v[g][2] = _mm256_xor_si256 (v[g][2], _mm256_set1_epi64x (0xff));
+  for (i = 0; i < d_rounds; i++) { siphash_round_avx2 (v[0]); siphash_round_avx2 (v[1]); }
+  for (g = 0; g < 2; g++)
+    _mm256_storeu_si256 ((__m256i *) (out + 4 * g), _mm256_xor_si256 (_mm256_xor_si256 (v[g][0], v[g][1]), _mm256_xor_si256 (v[g][2], v[g][3])));
+}
+
+void
+crpx_siphash_batch_avx2 (const void * const *data, const size_t *len, size_t n, const void *seed, bool siphash13, uint64_t *out)
+{
+  const uint8_t *p[SIP_AVX2_KEYS];
+  size_t first, i, k, m, l[SIPHASH_BLOCK], lg[SIP_AVX2_KEYS];
+  uint16_t order[SIPHASH_BLOCK];
+  uint64_t key[2], h[SIP_AVX2_KEYS];
+  memcpy (key, seed, 16);
+  for (first = 0; first < n; first += SIPHASH_BLOCK) {
+    m = CRPX_MIN (SIPHASH_BLOCK, n - first);
+    siphash_sort_block (data + first, len ? len + first : NULL, m, l, order);
+    for (i = 0; i + SIP_AVX2_KEYS <= m; i += SIP_AVX2_KEYS) {
+      for (k = 0; k < SIP_AVX2_KEYS; k++) { p[k] = (const uint8_t *) data[first + order[i+k]]; lg[k] = l[order[i+k]]; }
+      if (siphash13) siphash_group_avx2 (p, lg, key, 1, 3, h);
+      else           siphash_group_avx2 (p, lg, key, 2, 4, h);
+      for (k = 0; k < SIP_AVX2_KEYS; k++) out[first + order[i+k]] = h[k];
+    }
+    for (; i < m; i++) crpx_siphash_batch_scalar (data + first + order[i], l + order[i], 1, seed, siphash13, out + first + order[i]);
+  }
+}
+#endif
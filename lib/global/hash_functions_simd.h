@@ -0,0 +1,68 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more 
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hash_functions_simd.h 
+ *  \brief hash functions with hardware (SIMD) kernels and portable fallbacks giving identical results. Users should
+ *  call the dispatchers from hash_functions.h, which check cglob->sse etc. */
+
+#ifndef _global_hash_functions_simd_h_ 
+#define _global_hash_functions_simd_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "hash_functions_generators.h"
+
+/*! \brief CRC32C (Castagnoli) checksum; crc is the CRC of previous data (zero at start), for chaining */
+uint32_t crpx_crc32c_table (const void *data, size_t len, uint32_t crc);
+/*! \brief CRC of concatenation A+B, given crc1=CRC(A), crc2=CRC(B) and len2=length of B (e.g. for parallel chunks) */
+uint32_t crpx_crc32c_combine (uint32_t crc1, uint32_t crc2, size_t len2);
+/*! \brief fast (not cryptographic) 64 bits hash: two CRC32C lanes over alternate 8-byte words, followed by a mixer */
+uint64_t crpx_crc32c_seed64_table (const void *data, size_t len, uint64_t seed);
+#ifdef __SSE4_2__
+/*! \brief CRC32C with three interleaved _mm_crc32_u64() streams for long buffers (requires SSE4.2, same result as table) */
+uint32_t crpx_crc32c_sse42 (const void *data, size_t len, uint32_t crc);
+uint64_t crpx_crc32c_seed64_sse42 (const void *data, size_t len, uint64_t seed);
+#endif
+
+/*! \brief XXH3-style stripe hash for long buffers (e.g. whole chromosomes), with wyhash for inputs up to 240 bytes.
+ *  Returns 64 bits; if out is not NULL it receives 128 bits (whose first half is the returned value). Not compatible
+ *  with XXH3, since secret and short-input paths differ */
+uint64_t crpx_xxh3_seed64_scalar (const void *data, size_t len, uint64_t seed, void *out);
+#ifdef __SSE4_2__
+uint64_t crpx_xxh3_seed64_sse42 (const void *data, size_t len, uint64_t seed, void *out); /*!< \brief SSE2 kernel, same result */
+#endif
+#ifdef __AVX2__
+uint64_t crpx_xxh3_seed64_avx2 (const void *data, size_t len, uint64_t seed, void *out); /*!< \brief AVX2 kernel, same result */
+#endif
+
+/*! \brief keyed hash based on AES rounds (aHash style), for keys of up to a few KB; seed has 128 bits (e.g. from
+ *  crpx_generate_bytesized_random_seeds_from_cpu()). The software version is slow, but gives the same result */
+uint64_t crpx_aeshash_seed128_soft (const void *data, size_t len, const void *seed);
+#ifdef __AES__
+uint64_t crpx_aeshash_seed128_aesni (const void *data, size_t len, const void *seed); /*!< \brief AES-NI kernel, same result */
+#endif
+
+/*! \brief SipHash-2-4 (crpx_siphash64_seed128) or, if siphash13 is true, SipHash-1-3 (crpx_siphash13_seed128) of n
+ *  independent keys data[i] of len[i] bytes (len=NULL for null-terminated strings), with the same 128 bits seed */
+void crpx_siphash_batch_scalar (const void * const *data, const size_t *len, size_t n, const void *seed, bool siphash13, uint64_t *out);
+#ifdef __AVX2__
+/*! \brief eight keys at once in two sets of 4-lane registers, with keys sorted by length s.t. lanes of a set have
+ *  similar lengths (same result as the scalar version) */
+void crpx_siphash_batch_avx2 (const void * const *data, const size_t *len, size_t n, const void *seed, bool siphash13, uint64_t *out);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -66,6 +66,7 @@ extern "C" {
 #else
 //  #include <sys/times.h>  /* speed profiling in clock ticks (e.g. times() ) */ // unused at the moment
   #include <sys/syscall.h>/* system calls like syscall(SYS_getrandom, buf, buflen, 0) for random noise */
+  #include <sys/mman.h>   /* mmap() of index files (e.g. fuse filter) */
 #endif
 
 #ifdef _OPENMP
@@ -75,7 +76,7 @@ extern "C" {
   #define CRPX_THREAD_NUM 0
 #endif
 
-#if defined HAVE_SSE || defined HAVE_AVX /* these are defined in config.h, not __SSE2__ from gcc */
+#if defined HAVE_SSE || defined HAVE_AVX || defined HAVE_AES /* these are defined in config.h, not __SSE2__ from gcc */
 //#if defined __SSE4_2__ || defined __AVX2__    /* we compile with -msse4.2 or -mno-sse (i.e. whole range is included or excluded) */
 #include <immintrin.h>
 #endif
@@ -118,13 +119,15 @@ typedef struct {
   uint64_t nthreads:16, // bit-fields lead to type promotion when distinct sizes, so best to compare equal to equal  
            loglevel_stderr:4, loglevel_file:4, 
            error:2,      /*!< set by crpx_logger(): 0 - no error, 1 - error (may continue), 2 - fatal (must halt) */
-           sse:1, avx:1, /*!< checked at _runtime_ (if host CPU allows, irrespective of being build with support or not) */
+           sse:1, avx:1, aes:1, /*!< checked at _runtime_ (if host CPU allows, irrespective of being build with support or not) */
            rng_size:9;   /*!< each PRNG function relies on state sets of different lengths; largest is 313 (for mt19937) */
   uint64_t elapsed_time[2];
   int ref_counter; /*!< how many structs have a ptr to the global structure; freed only if ref_counter <=0 (should be == 0) */
   uint64_t *rng_seed_vector;
   uint64_t (*rng_get)(void*);
   char rng_name[32];
+  uint64_t (*hash_get)(const void*, size_t, uint64_t); /*!< byte hash chosen with crpx_set_hash_function() */
+  char hash_name[32];
   FILE *logfile;
 } crpx_global_struct, *crpx_global_t;
 
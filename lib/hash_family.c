@@ -0,0 +1,161 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hash_family.c
+ *  \brief multiply-shift hash families. AVX2 has no 64 bits multiplication, thus the 32 bits kernel builds the low
+ *  half of each product from three 32 x 32 bits products (_mm256_mul_epu32). */
+
+#include "hash_family.h"
+
+crpx_hash_family_t
+new_crpx_hash_family (crpx_global_t cglob, uint16_t k)
+{
+  size_t k4 = ((size_t) k + 3) & ~3UL, i;
+  if (!k) {
+    crpx_logger_error (cglob, "new_crpx_hash_family: number of functions must be positive");
+    return NULL;
+  }
+  crpx_hash_family_t hf = (crpx_hash_family_t) crpx_malloc (cglob, sizeof (crpx_hash_family_struct));
+  if (!hf) return NULL;
+  hf->a0 = (uint64_t *) crpx_malloc (cglob, 4 * k4 * sizeof (uint64_t));
+  if (!hf->a0) { free (hf); return NULL; }
+  hf->a1 = hf->a0 + k4;
+  hf->b0 = hf->a1 + k4;
+  hf->b1 = hf->b0 + k4;
+  for (i = 0; i < 4 * k4; i++) hf->a0[i] = crpx_random_64bits (cglob);
+  hf->k = k;
+  hf->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, hf->cglob); // thread-safe increase of ref_counter
+  return hf;
+}
+
+void
+del_crpx_hash_family (crpx_hash_family_t hf)
+{
+  if (!hf) return;
+  if (hf->a0) crpx_free (hf->cglob, hf->a0);
+  crpx_global_finalise (hf->cglob); // it just decreases cglob->ref_counter
+  free (hf);
+}
+
+static inline void
+hash_family_32bits_scalar (crpx_hash_family_t hf, uint64_t key, uint32_t *out)
+{
+  uint64_t x_hi = key >> 32, x_lo = key & 0xffffffffULL;
+  for (uint16_t i = 0; i < hf->k; i++) out[i] = (uint32_t) (((hf->a0[i] + x_hi) * (hf->a1[i] + x_lo) + hf->b1[i]) >> 32);
+}
+
+#ifdef __AVX2__
+static inline __m256i
+hash_family_mullo64_avx2 (__m256i u, __m256i v)
+{ // low 64 bits of u x v = lo(u) lo(v) + (hi(u) lo(v) + lo(u) hi(v)) << 32
+  __m256i cross = _mm256_add_epi64 (_mm256_mul_epu32 (_mm256_srli_epi64 (u, 32), v), _mm256_mul_epu32 (u, _mm256_srli_epi64 (v, 32)));
+  return _mm256_add_epi64 (_mm256_mul_epu32 (u, v), _mm256_slli_epi64 (cross, 32));
+}
+
+static inline void
+hash_family_32bits_avx2 (crpx_hash_family_t hf, uint64_t key, uint32_t *out)
+{ // four functions at a time; the high 32 bits of each lane are gathered into 128 bits by a permutation
+  const __m256i x_hi = _mm256_set1_epi64x ((int64_t) (key >> 32)), x_lo = _mm256_set1_epi64x ((int64_t) (key & 0xffffffffULL));
+  const __m256i gather_hi = _mm256_setr_epi32 (1, 3, 5, 7, 0, 0, 0, 0);
+  uint32_t tail[4];
+  for (uint16_t i = 0; i < hf->k; i += 4) {
+    __m256i u = _mm256_add_epi64 (_mm256_loadu_si256 ((const __m256i *) (hf->a0 + i)), x_hi);
+    __m256i v = _mm256_add_epi64 (_mm256_loadu_si256 ((const __m256i *) (hf->a1 + i)), x_lo);
+    __m256i h = _mm256_add_epi64 (hash_family_mullo64_avx2 (u, v), _mm256_loadu_si256 ((const __m256i *) (hf->b1 + i)));
+    __m128i r = _mm256_castsi256_si128 (_mm256_permutevar8x32_epi32 (h, gather_hi));
+    if (i + 4 <= hf->k) _mm_storeu_si128 ((__m128i *) (out + i), r);
+    else { _mm_storeu_si128 ((__m128i *) tail, r); memcpy (out + i, tail, (hf->k - i) * sizeof (uint32_t)); }
+  }
+}
+#endif
+
+void
+crpx_hash_family_32bits (crpx_hash_family_t hf, uint64_t key, uint32_t *out)
+{
+#ifdef __AVX2__
+  if (hf->cglob->avx) { hash_family_32bits_avx2 (hf, key, out); return; }
+#endif
+  hash_family_32bits_scalar (hf, key, out);
+}
+
+void
+crpx_hash_family_64bits (crpx_hash_family_t hf, uint64_t key, uint64_t *out)
+{ // (A x + B) >> 64 = hi(a0 x + b0) + lo(a1 x) + b1 (mod 2^64), with carry of a0 x + b0
+  for (uint16_t i = 0; i < hf->k; i++) {
+    __uint128_t t = (__uint128_t) hf->a0[i] * key + hf->b0[i];
+    out[i] = (uint64_t) (t >> 64) + hf->a1[i] * key + hf->b1[i];
+  }
+}
+
+void
+crpx_hash_family_32bits_array (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint32_t *out)
+{
+  size_t j;
+#pragma omp parallel for schedule(static) if (n > 4096)
+  for (j = 0; j < n; j++) crpx_hash_family_32bits (hf, key[j], out + j * hf->k);
+}
+
+void
+crpx_hash_family_64bits_array (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint64_t *out)
+{
+  size_t j;
+#pragma omp parallel for schedule(static) if (n > 4096)
+  for (j = 0; j < n; j++) crpx_hash_family_64bits (hf, key[j], out + j * hf->k);
+}
+
+static inline void
+hash_family_minhash_scalar (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint32_t *signature)
+{ // hashes are compared as they are computed, without a buffer of k values
+  uint64_t x_hi, x_lo;
+  uint32_t h;
+  for (uint16_t i = 0; i < hf->k; i++) signature[i] = UINT32_MAX;
+  for (size_t j = 0; j < n; j++) {
+    x_hi = key[j] >> 32; x_lo = key[j] & 0xffffffffULL;
+    for (uint16_t i = 0; i < hf->k; i++) {
+      h = (uint32_t) (((hf->a0[i] + x_hi) * (hf->a1[i] + x_lo) + hf->b1[i]) >> 32);
+      if (h < signature[i]) signature[i] = h;
+    }
+  }
+}
+
+#ifdef __AVX2__
+static inline void
+hash_family_minhash_avx2 (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint32_t *signature)
+{ // four functions at a time over all keys, with their minima kept in a register
+  const __m256i gather_hi = _mm256_setr_epi32 (1, 3, 5, 7, 0, 0, 0, 0);
+  uint32_t tail[4];
+  for (uint16_t i = 0; i < hf->k; i += 4) {
+    const __m256i a0 = _mm256_loadu_si256 ((const __m256i *) (hf->a0 + i)), a1 = _mm256_loadu_si256 ((const __m256i *) (hf->a1 + i));
+    const __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (hf->b1 + i));
+    __m128i m = _mm_set1_epi32 (-1);
+    for (size_t j = 0; j < n; j++) {
+      __m256i u = _mm256_add_epi64 (a0, _mm256_set1_epi64x ((int64_t) (key[j] >> 32)));
+      __m256i v = _mm256_add_epi64 (a1, _mm256_set1_epi64x ((int64_t) (key[j] & 0xffffffffULL)));
+      __m256i h = _mm256_add_epi64 (hash_family_mullo64_avx2 (u, v), b1);
+      m = _mm_min_epu32 (m, _mm256_castsi256_si128 (_mm256_permutevar8x32_epi32 (h, gather_hi)));
+    }
+    if (i + 4 <= hf->k) _mm_storeu_si128 ((__m128i *) (signature + i), m);
+    else { _mm_storeu_si128 ((__m128i *) tail, m); memcpy (signature + i, tail, (hf->k - i) * sizeof (uint32_t)); }
+  }
+}
+#endif
+
+void
+crpx_hash_family_minhash (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint32_t *signature)
+{ // no per-call buffer of k hashes, since k can reach 65535 and this is called from worker threads
+#ifdef __AVX2__
+  if (hf->cglob->avx) { hash_family_minhash_avx2 (hf, key, n, signature); return; }
+#endif
+  hash_family_minhash_scalar (hf, key, n, signature);
+}
@@ -0,0 +1,50 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hash_family.h
+ *  \brief family of k independent hash functions of 64 bits keys (e.g. for MinHash, count-min rows or Bloom probes),
+ *  computed together for each key. Outputs of 32 bits use Thorup's pair-multiply-shift, h(x) = ((a0 + x_hi)(a1 + x_lo)
+ *  + b) >> 32 mod 2^64, and outputs of 64 bits use Dietzfelbinger's multiply-add-shift with 128 bits constants,
+ *  h(x) = (A x + B) >> 64 mod 2^128; both are strongly universal (2-independent). Byte keys should be hashed to 64 bits
+ *  first (e.g. with crpx_hash()). Constants come from the library RNG. */
+
+#ifndef _curupixa_hash_family_h_
+#define _curupixa_hash_family_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint64_t *a0, *a1, *b0, *b1; /*!< \brief constants of each function (a0, a1, b1 for 32 bits; A=a1:a0 and B=b1:b0 for 64 bits) */
+  uint16_t k;                  /*!< \brief number of functions (arrays are padded to a multiple of 4) */
+  crpx_global_t cglob;
+} crpx_hash_family_struct, *crpx_hash_family_t;
+
+crpx_hash_family_t new_crpx_hash_family (crpx_global_t cglob, uint16_t k);
+void del_crpx_hash_family (crpx_hash_family_t hf);
+/*! \brief out[i] = h_i(key) for i = 0...k-1, with AVX2 kernel if available */
+void crpx_hash_family_32bits (crpx_hash_family_t hf, uint64_t key, uint32_t *out);
+void crpx_hash_family_64bits (crpx_hash_family_t hf, uint64_t key, uint64_t *out);
+/*! \brief out[j * k + i] = h_i(key[j]) for n keys, in parallel */
+void crpx_hash_family_32bits_array (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint32_t *out);
+void crpx_hash_family_64bits_array (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint64_t *out);
+/*! \brief MinHash signature of the set of n keys: signature[i] is the minimum of h_i over all keys (32 bits functions).
+ *  The fraction of equal values between two signatures estimates the Jaccard similarity of the sets */
+void crpx_hash_family_minhash (crpx_hash_family_t hf, const uint64_t *key, size_t n, uint32_t *signature);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,328 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hashtable.c
+ *  \brief Swiss table, following the design of abseil's flat_hash_map (https://abseil.io/about/design/swisstables,
+ *  Apache-2.0 license): the hash is split into h1 (probe start) and h2 (7 bits tag stored in the control byte). */
+
+#include "hashtable.h"
+
+#define HT_EMPTY   ((int8_t) -128) /* 0b10000000 */
+#define HT_DELETED ((int8_t) -2)   /* 0b11111110 ; full slots are 0b0xxxxxxx (i.e. h2 tag) */
+#define HT_MAX_GROUP 32           /* size of cloned control bytes, s.t. any group can be read without wrapping around */
+#define HT_MIN_CAPACITY 32
+#define HT_BATCH 16
+#define HT_LSB 0x0101010101010101ULL
+#define HT_MSB 0x8080808080808080ULL
+
+static bool ht_resize (crpx_hashtable_t ht, uint64_t new_capacity);
+
+static inline uint64_t ht_h1 (uint64_t hash) { return hash >> 7; }
+static inline int8_t ht_h2 (uint64_t hash) { return (int8_t)(hash & 0x7f); }
+static inline uint64_t ht_max_load (uint64_t capacity) { return capacity - capacity / 8; }
+
+/* group matches are bitmasks where each slot is one bit (SSE and AVX2) or the top bit of one byte (SWAR) */
+static inline uint64_t
+ht_slot_in_group (crpx_hashtable_t ht, uint64_t match)
+{
+  return (uint64_t)(__builtin_ctzll (match) >> ((ht->group_width == 8) * 3));
+}
+
+static inline uint64_t
+ht_match_tag (crpx_hashtable_t ht, uint64_t pos, int8_t tag)
+{
+  const int8_t *g = ht->ctrl + pos;
+  uint64_t w;
+  switch (ht->group_width) {
+#ifdef __AVX2__
+    case 32: return (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *) g), _mm256_set1_epi8 (tag)));
+#endif
+#ifdef __SSE4_2__
+    case 16: return (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) g), _mm_set1_epi8 (tag)));
+#endif
+    default: // may have false positives, which are discarded when comparing the keys
+      memcpy (&w, g, sizeof (uint64_t));
+      w ^= HT_LSB * (uint8_t) tag;
+      return (w - HT_LSB) & ~w & HT_MSB;
+  }
+}
+
+static inline uint64_t
+ht_match_empty (crpx_hashtable_t ht, uint64_t pos)
+{
+  const int8_t *g = ht->ctrl + pos;
+  uint64_t w;
+  switch (ht->group_width) {
+#ifdef __AVX2__
+    case 32: return (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *) g), _mm256_set1_epi8 (HT_EMPTY)));
+#endif
+#ifdef __SSE4_2__
+    case 16: return (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) g), _mm_set1_epi8 (HT_EMPTY)));
+#endif
+    default: // empty and deleted have top bit set, but only deleted has bit 1 set
+      memcpy (&w, g, sizeof (uint64_t));
+      return w & ~(w << 6) & HT_MSB;
+  }
+}
+
+static inline uint64_t
+ht_match_empty_or_deleted (crpx_hashtable_t ht, uint64_t pos)
+{
+  const int8_t *g = ht->ctrl + pos;
+  uint64_t w;
+  switch (ht->group_width) {
+#ifdef __AVX2__
+    case 32: return (uint32_t) _mm256_movemask_epi8 (_mm256_cmpgt_epi8 (_mm256_set1_epi8 (-1), _mm256_loadu_si256 ((const __m256i *) g)));
+#endif
+#ifdef __SSE4_2__
+    case 16: return (uint16_t) _mm_movemask_epi8 (_mm_cmpgt_epi8 (_mm_set1_epi8 (-1), _mm_loadu_si128 ((const __m128i *) g)));
+#endif
+    default:
+      memcpy (&w, g, sizeof (uint64_t));
+      return w & HT_MSB;
+  }
+}
+
+static inline void
+ht_set_ctrl (crpx_hashtable_t ht, uint64_t i, int8_t c)
+{
+  ht->ctrl[i] = c;
+  if (i < HT_MAX_GROUP) ht->ctrl[ht->capacity + i] = c; // cloned bytes
+}
+
+/* probe sequence is triangular over groups, which visits all groups when capacity is a power of two */
+static inline uint64_t
+ht_find (crpx_hashtable_t ht, uint64_t key, uint64_t hash)
+{
+  uint64_t mask = ht->capacity - 1, pos = ht_h1 (hash) & mask, stride = 0, m, i;
+  int8_t tag = ht_h2 (hash);
+  for (;;) {
+    for (m = ht_match_tag (ht, pos, tag); m; m &= m - 1) {
+      i = (pos + ht_slot_in_group (ht, m)) & mask;
+      if (ht->slot[i].key == key) return i;
+    }
+    if (ht_match_empty (ht, pos)) return UINT64_MAX; // table always has empty slots, thus search ends
+    stride += ht->group_width;
+    pos = (pos + stride) & mask;
+  }
+}
+
+static inline uint64_t
+ht_find_free (crpx_hashtable_t ht, uint64_t hash)
+{
+  uint64_t mask = ht->capacity - 1, pos = ht_h1 (hash) & mask, stride = 0, m;
+  for (;;) {
+    if ((m = ht_match_empty_or_deleted (ht, pos))) return (pos + ht_slot_in_group (ht, m)) & mask;
+    stride += ht->group_width;
+    pos = (pos + stride) & mask;
+  }
+}
+
+/* assumes key is not in table; returns slot (with value not initialised) or UINT64_MAX if rehash fails */
+static inline uint64_t
+ht_insert_new (crpx_hashtable_t ht, uint64_t key, uint64_t hash)
+{
+  uint64_t i = ht_find_free (ht, hash);
+  if ((ht->ctrl[i] == HT_EMPTY) && !ht->growth_left) { // if too many deleted slots, rehash in place
+    if (!ht_resize (ht, (ht->size + 1 > ht_max_load (ht->capacity) / 2) ? 2 * ht->capacity : ht->capacity)) return UINT64_MAX;
+    i = ht_find_free (ht, hash);
+  }
+  if (ht->ctrl[i] == HT_EMPTY) ht->growth_left--;
+  ht_set_ctrl (ht, i, ht_h2 (hash));
+  ht->slot[i].key = key;
+  ht->size++;
+  return i;
+}
+
+static bool
+ht_resize (crpx_hashtable_t ht, uint64_t new_capacity)
+{
+  crpx_hashtable_slot_struct *old_slot = ht->slot;
+  int8_t *old_ctrl = ht->ctrl;
+  uint64_t i, j, old_capacity = ht->capacity;
+
+  ht->ctrl = (int8_t *) crpx_malloc (ht->cglob, new_capacity + HT_MAX_GROUP);
+  ht->slot = (crpx_hashtable_slot_struct *) crpx_malloc (ht->cglob, new_capacity * sizeof (crpx_hashtable_slot_struct));
+  if (!ht->ctrl || !ht->slot) {
+    crpx_logger_error (ht->cglob, "hashtable: could not allocate table with %lu slots", new_capacity);
+    if (ht->ctrl) crpx_free (ht->cglob, ht->ctrl);
+    if (ht->slot) crpx_free (ht->cglob, ht->slot);
+    ht->ctrl = old_ctrl;
+    ht->slot = old_slot;
+    return false;
+  }
+  memset (ht->ctrl, HT_EMPTY, new_capacity + HT_MAX_GROUP);
+  ht->capacity = new_capacity;
+  ht->growth_left = ht_max_load (new_capacity) - ht->size;
+  if (old_ctrl) for (i = 0; i < old_capacity; i++) if (old_ctrl[i] >= 0) {
+    uint64_t hash = ht->hash (old_slot[i].key);
+    j = ht_find_free (ht, hash);
+    ht_set_ctrl (ht, j, ht_h2 (hash));
+    ht->slot[j] = old_slot[i];
+  }
+  if (old_ctrl) crpx_free (ht->cglob, old_ctrl);
+  if (old_slot) crpx_free (ht->cglob, old_slot);
+  return true;
+}
+
+crpx_hashtable_t
+new_crpx_hashtable (crpx_global_t cglob, uint64_t initial_size, uint64_t (*hash) (uint64_t))
+{
+  uint64_t capacity = HT_MIN_CAPACITY;
+  while (ht_max_load (capacity) < initial_size) capacity <<= 1;
+  crpx_hashtable_t ht = (crpx_hashtable_t) crpx_malloc (cglob, sizeof (crpx_hashtable_struct));
+  if (!ht) return NULL;
+  ht->slot = NULL;
+  ht->ctrl = NULL;
+  ht->capacity = ht->size = 0;
+  ht->hash = hash ? hash : crpx_hashint_murmurmix64;
+  ht->cglob = cglob;
+  ht->group_width = 8;
+#ifdef __SSE4_2__
+  if (cglob->sse) ht->group_width = 16;
+#endif
+#ifdef __AVX2__
+  if (cglob->avx) ht->group_width = 32;
+#endif
+  if (!ht_resize (ht, capacity)) { free (ht); return NULL; }
+  crpx_link_add_global_pointer (cglob, ht->cglob); // thread-safe increase of ref_counter
+  return ht;
+}
+
+void
+del_crpx_hashtable (crpx_hashtable_t ht)
+{
+  if (!ht) return;
+  if (ht->ctrl) crpx_free (ht->cglob, ht->ctrl);
+  if (ht->slot) crpx_free (ht->cglob, ht->slot);
+  crpx_global_finalise (ht->cglob); // it just decreases cglob->ref_counter
+  free (ht);
+}
+
+void
+crpx_hashtable_clear (crpx_hashtable_t ht)
+{
+  memset (ht->ctrl, HT_EMPTY, ht->capacity + HT_MAX_GROUP);
+  ht->size = 0;
+  ht->growth_left = ht_max_load (ht->capacity);
+}
+
+bool
+crpx_hashtable_reserve (crpx_hashtable_t ht, uint64_t n_keys)
+{
+  uint64_t capacity = ht->capacity;
+  if (n_keys <= ht->size + ht->growth_left) return true;
+  while (ht_max_load (capacity) < n_keys) capacity <<= 1;
+  return ht_resize (ht, capacity);
+}
+
+bool
+crpx_hashtable_insert (crpx_hashtable_t ht, uint64_t key, uint64_t value)
+{
+  uint64_t hash = ht->hash (key), i = ht_find (ht, key, hash);
+  bool is_new = (i == UINT64_MAX);
+  if (is_new && ((i = ht_insert_new (ht, key, hash)) == UINT64_MAX)) return false;
+  ht->slot[i].value = value;
+  return is_new;
+}
+
+uint64_t *
+crpx_hashtable_get_or_insert (crpx_hashtable_t ht, uint64_t key)
+{
+  uint64_t hash = ht->hash (key), i = ht_find (ht, key, hash);
+  if (i == UINT64_MAX) {
+    if ((i = ht_insert_new (ht, key, hash)) == UINT64_MAX) return NULL;
+    ht->slot[i].value = 0;
+  }
+  return &(ht->slot[i].value);
+}
+
+bool
+crpx_hashtable_lookup (crpx_hashtable_t ht, uint64_t key, uint64_t *value)
+{
+  uint64_t i = ht_find (ht, key, ht->hash (key));
+  if (i == UINT64_MAX) return false;
+  if (value) *value = ht->slot[i].value;
+  return true;
+}
+
+bool
+crpx_hashtable_erase (crpx_hashtable_t ht, uint64_t key)
+{
+  uint64_t i = ht_find (ht, key, ht->hash (key));
+  if (i == UINT64_MAX) return false;
+  ht_set_ctrl (ht, i, HT_DELETED); // slot can be reused by insertion, but does not stop a search
+  ht->size--;
+  return true;
+}
+
+bool
+crpx_hashtable_next (crpx_hashtable_t ht, uint64_t *iter, uint64_t *key, uint64_t *value)
+{
+  for (uint64_t i = *iter; i < ht->capacity; i++) if (ht->ctrl[i] >= 0) {
+    if (key)   *key   = ht->slot[i].key;
+    if (value) *value = ht->slot[i].value;
+    *iter = i + 1;
+    return true;
+  }
+  *iter = ht->capacity;
+  return false;
+}
+
+bool
+crpx_hashtable_insert_array (crpx_hashtable_t ht, const uint64_t *keys, const uint64_t *values, size_t n)
+{
+  uint64_t hash[HT_BATCH], pos;
+  size_t i, j, m, s;
+  for (i = 0; i < n; i += HT_BATCH) {
+    m = CRPX_MIN (HT_BATCH, n - i);
+    for (j = 0; j < m; j++) { // hashes are kept, since table may be resized within batch
+      hash[j] = ht->hash (keys[i+j]);
+      pos = ht_h1 (hash[j]) & (ht->capacity - 1);
+      __builtin_prefetch (ht->ctrl + pos, 0, 3);
+      __builtin_prefetch (ht->slot + pos, 1, 3);
+    }
+    for (j = 0; j < m; j++) {
+      if ((s = ht_find (ht, keys[i+j], hash[j])) == UINT64_MAX) {
+        if ((s = ht_insert_new (ht, keys[i+j], hash[j])) == UINT64_MAX) return false;
+        ht->slot[s].value = 0;
+      }
+      if (values) ht->slot[s].value = values[i+j];
+      else ht->slot[s].value++;
+    }
+  }
+  return true;
+}
+
+size_t
+crpx_hashtable_lookup_array (crpx_hashtable_t ht, const uint64_t *keys, size_t n, uint64_t *values, bool *found)
+{
+  uint64_t hash[HT_BATCH], pos;
+  size_t i, j, m, s, n_found = 0;
+  for (i = 0; i < n; i += HT_BATCH) {
+    m = CRPX_MIN (HT_BATCH, n - i);
+    for (j = 0; j < m; j++) { // all groups are requested before the first one is probed
+      hash[j] = ht->hash (keys[i+j]);
+      pos = ht_h1 (hash[j]) & (ht->capacity - 1);
+      __builtin_prefetch (ht->ctrl + pos, 0, 3);
+      __builtin_prefetch (ht->slot + pos, 0, 3);
+    }
+    for (j = 0; j < m; j++) {
+      s = ht_find (ht, keys[i+j], hash[j]);
+      if (values) values[i+j] = (s == UINT64_MAX) ? 0 : ht->slot[s].value;
+      if (found) found[i+j] = (s != UINT64_MAX);
+      n_found += (s != UINT64_MAX);
+    }
+  }
+  return n_found;
+}
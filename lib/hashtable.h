@@ -0,0 +1,68 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hashtable.h
+ *  \brief open addressing hash table from uint64_t keys to uint64_t values (e.g. k-mer counts or split frequencies),
+ *  in the style of Swiss tables: one control byte per slot with a 7 bits tag, probed in groups of 32 (AVX2),
+ *  16 (SSE) or 8 (SWAR) slots at once. The maximum load factor is 7/8. Not thread-safe. */
+
+#ifndef _curupixa_hashtable_h_
+#define _curupixa_hashtable_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint64_t key, value;
+} crpx_hashtable_slot_struct;
+
+typedef struct {
+  crpx_hashtable_slot_struct *slot; /*!< \brief keys and values are stored together, to share the cache line */
+  int8_t *ctrl;       /*!< \brief control bytes: empty, deleted, or 7 bits tag; first group is cloned after the last slot */
+  uint64_t capacity, /*!< \brief number of slots, power of two */
+           size,     /*!< \brief number of stored keys */
+           growth_left; /*!< \brief number of empty slots that can still be used before a rehash */
+  uint64_t (*hash) (uint64_t); /*!< \brief mixer applied to keys, e.g. crpx_hashint_murmurmix64() */
+  uint8_t group_width;
+  crpx_global_t cglob;
+} crpx_hashtable_struct, *crpx_hashtable_t;
+
+/*! \brief new table with room for at least initial_size keys; hash may be any mixer from hash_functions_generators.h
+ *  (if NULL, crpx_hashint_murmurmix64 is used) */
+crpx_hashtable_t new_crpx_hashtable (crpx_global_t cglob, uint64_t initial_size, uint64_t (*hash) (uint64_t));
+void del_crpx_hashtable (crpx_hashtable_t ht);
+void crpx_hashtable_clear (crpx_hashtable_t ht);
+/*! \brief makes sure that n_keys can be stored without rehashing */
+bool crpx_hashtable_reserve (crpx_hashtable_t ht, uint64_t n_keys);
+/*! \brief inserts or replaces value; returns true if key is new */
+bool crpx_hashtable_insert (crpx_hashtable_t ht, uint64_t key, uint64_t value);
+/*! \brief pointer to value of key, inserting it with value zero if absent (NULL in case of allocation error).
+ *  Pointer is invalidated by the next insertion */
+uint64_t * crpx_hashtable_get_or_insert (crpx_hashtable_t ht, uint64_t key);
+bool crpx_hashtable_lookup (crpx_hashtable_t ht, uint64_t key, uint64_t *value);
+bool crpx_hashtable_erase (crpx_hashtable_t ht, uint64_t key);
+/*! \brief iterates over keys: start with *iter = 0 and call while it returns true */
+bool crpx_hashtable_next (crpx_hashtable_t ht, uint64_t *iter, uint64_t *key, uint64_t *value);
+
+/*! \brief bulk insertion (with software prefetching); if values is NULL, value of each key is increased by one (counting) */
+bool crpx_hashtable_insert_array (crpx_hashtable_t ht, const uint64_t *keys, const uint64_t *values, size_t n);
+/*! \brief bulk lookup (with software prefetching); values of absent keys are zero, and found (if not NULL) tells
+ *  which keys are present. Returns number of keys found */
+size_t crpx_hashtable_lookup_array (crpx_hashtable_t ht, const uint64_t *keys, size_t n, uint64_t *values, bool *found);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,325 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hyperloglog.c
+ *  \brief HyperLogLog++ with sparse mode. Originally inspired by libhll by Ivan Vitjuk (ISC license), with the sparse
+ *  representation from Heule, Nunkesser and Hall (2013) and the improved estimator from Otmar Ertl (2017). */
+
+#include "hyperloglog.h"
+
+/* empirical thresholds from HLL++ below which linear counting is preferred, for p = 4...18 */
+static const double hll_linear_counting_threshold[] = {10, 20, 40, 80, 220, 400, 900, 1800, 3100, 6500, 11500, 20000, 50000, 120000, 350000};
+
+static bool hll_alloc_sparse (crpx_hyperloglog_t hll);
+static void hll_flush_buffer (crpx_hyperloglog_t hll);
+static void hll_add_sparse_entry (crpx_hyperloglog_t hll, uint32_t entry);
+static void hll_dense_add_sparse_entry (uint8_t *reg, uint8_t p, uint32_t entry);
+static void hll_register_max_merge (crpx_global_t cglob, uint8_t *dst, const uint8_t *src, size_t m);
+static double hll_harmonic_sum (crpx_global_t cglob, const uint8_t *reg, size_t m, size_t *n_zeros);
+static double hll_sigma (double x);
+static double hll_tau (double x);
+static int compare_uint32_increasing (const void *a, const void *b);
+
+crpx_hyperloglog_t
+new_crpx_hyperloglog (crpx_global_t cglob, uint8_t precision)
+{
+  if ((precision < CRPX_HLL_MIN_PRECISION) || (precision > CRPX_HLL_MAX_PRECISION)) {
+    crpx_logger_error (cglob, "new_crpx_hyperloglog: precision %u out of range [%d, %d]", precision, CRPX_HLL_MIN_PRECISION, CRPX_HLL_MAX_PRECISION);
+    return NULL;
+  }
+  crpx_hyperloglog_t hll = (crpx_hyperloglog_t) crpx_malloc (cglob, sizeof (crpx_hyperloglog_struct));
+  if (!hll) return NULL;
+  hll->reg = NULL;
+  hll->sparse = hll->buffer = NULL;
+  hll->cglob = cglob; // linked (ref_counter increased) only at the end, since del_() would decrease it
+  hll->p = precision;
+  hll->m = 1U << precision;
+  hll->max_sparse = hll->m >> 2; // sparse list (uint32_t) is not allowed to use more memory than the dense registers
+  hll->max_buffer = CRPX_MAX (hll->max_sparse >> 2, 4);
+  if (!hll_alloc_sparse (hll)) { hll->cglob = NULL; del_crpx_hyperloglog (hll); return NULL; }
+  crpx_link_add_global_pointer (cglob, hll->cglob); // thread-safe increase of ref_counter
+  return hll;
+}
+
+void
+del_crpx_hyperloglog (crpx_hyperloglog_t hll)
+{
+  if (!hll) return;
+  if (hll->reg)    crpx_free (hll->cglob, hll->reg);
+  if (hll->sparse) crpx_free (hll->cglob, hll->sparse);
+  if (hll->buffer) crpx_free (hll->cglob, hll->buffer);
+  crpx_global_finalise (hll->cglob); // it just decreases cglob->ref_counter
+  free (hll);
+}
+
+static bool
+hll_alloc_sparse (crpx_hyperloglog_t hll)
+{ // sparse[] has room for the buffer s.t. both can be merged in place
+  hll->sparse = (uint32_t *) crpx_malloc (hll->cglob, (hll->max_sparse + hll->max_buffer) * sizeof (uint32_t));
+  hll->buffer = (uint32_t *) crpx_malloc (hll->cglob, hll->max_buffer * sizeof (uint32_t));
+  hll->n_sparse = hll->n_buffer = 0;
+  hll->is_sparse = true;
+  return (hll->sparse && hll->buffer);
+}
+
+void
+crpx_hyperloglog_reset (crpx_hyperloglog_t hll)
+{
+  if (hll->is_sparse) { hll->n_sparse = hll->n_buffer = 0; return; }
+  crpx_free (hll->cglob, hll->reg);
+  hll->reg = NULL;
+  if (hll_alloc_sparse (hll)) return;
+  crpx_logger_warning (hll->cglob, "crpx_hyperloglog_reset: could not allocate sparse list, will use dense registers");
+  if (hll->sparse) { crpx_free (hll->cglob, hll->sparse); hll->sparse = NULL; }
+  if (hll->buffer) { crpx_free (hll->cglob, hll->buffer); hll->buffer = NULL; }
+  hll->reg = (uint8_t *) crpx_calloc (hll->cglob, hll->m, sizeof (uint8_t));
+  hll->is_sparse = false;
+}
+
+inline void
+crpx_hyperloglog_add_hash (crpx_hyperloglog_t hll, uint64_t hash)
+{ // rank (rho) is the position of the leftmost 1 after the index bits; the sentinel bit caps it at 64 - p + 1
+  if (!hll->is_sparse) {
+    uint32_t idx = hash >> (64 - hll->p);
+    uint8_t rho = __builtin_clzll ((hash << hll->p) | (1ULL << (hll->p - 1))) + 1;
+    if (hll->reg[idx] < rho) hll->reg[idx] = rho;
+    return;
+  }
+  uint32_t idx = hash >> (64 - CRPX_HLL_SPARSE_PRECISION);
+  uint32_t rho = __builtin_clzll ((hash << CRPX_HLL_SPARSE_PRECISION) | (1ULL << (CRPX_HLL_SPARSE_PRECISION - 1))) + 1; // at most 40, fits in 6 bits
+  hll->buffer[hll->n_buffer++] = (idx << 6) | rho;
+  if (hll->n_buffer == hll->max_buffer) hll_flush_buffer (hll);
+}
+
+void
+crpx_hyperloglog_add_uint64 (crpx_hyperloglog_t hll, uint64_t x)
+{
+  crpx_hyperloglog_add_hash (hll, crpx_hashint_nasam64 (x));
+}
+
+void
+crpx_hyperloglog_add_hash_array (crpx_hyperloglog_t hll, const uint64_t *hash, size_t n)
+{
+  size_t i;
+  if (n < (1UL << 16)) { // not worth creating one HLL per thread
+    for (i = 0; i < n; i++) crpx_hyperloglog_add_hash (hll, hash[i]);
+    return;
+  }
+#pragma omp parallel shared(hll, hash, n) private(i)
+  {
+    crpx_hyperloglog_t local = new_crpx_hyperloglog (hll->cglob, hll->p);
+    if (local) crpx_hyperloglog_densify (local); // large arrays would densify it anyway, so we avoid sorting sparse lists
+    #pragma omp for schedule(static)
+    for (i = 0; i < n; i++) {
+      if (local) crpx_hyperloglog_add_hash (local, hash[i]);
+      else {
+        #pragma omp critical (crpx_hyperloglog_merge)
+        crpx_hyperloglog_add_hash (hll, hash[i]);
+      }
+    }
+    if (local) {
+      #pragma omp critical (crpx_hyperloglog_merge)
+      crpx_hyperloglog_merge (hll, local);
+      del_crpx_hyperloglog (local);
+    }
+  } // omp parallel
+}
+
+static void
+hll_flush_buffer (crpx_hyperloglog_t hll)
+{
+  size_t i, j, k, n;
+  uint32_t *s = hll->sparse, *b = hll->buffer;
+  if (!hll->n_buffer) return;
+  qsort (b, hll->n_buffer, sizeof (uint32_t), compare_uint32_increasing);
+  /* merge backwards, in place, since sparse[] has room for the buffer */
+  i = hll->n_sparse; j = hll->n_buffer; n = k = hll->n_sparse + hll->n_buffer;
+  while (j > 0) {
+    if ((i > 0) && (s[i-1] > b[j-1])) s[--k] = s[--i];
+    else                              s[--k] = b[--j];
+  }
+  /* entries are sorted by index then by rank: we keep only the last of each index (i.e. the max rank) */
+  for (i = 0, k = 0; i < n; i++) if ((i + 1 == n) || ((s[i] >> 6) != (s[i+1] >> 6))) s[k++] = s[i];
+  hll->n_sparse = k;
+  hll->n_buffer = 0;
+  if (hll->n_sparse > hll->max_sparse) crpx_hyperloglog_densify (hll);
+}
+
+static void
+hll_add_sparse_entry (crpx_hyperloglog_t hll, uint32_t entry)
+{
+  if (!hll->is_sparse) { hll_dense_add_sparse_entry (hll->reg, hll->p, entry); return; }
+  hll->buffer[hll->n_buffer++] = entry;
+  if (hll->n_buffer == hll->max_buffer) hll_flush_buffer (hll);
+}
+
+static void
+hll_dense_add_sparse_entry (uint8_t *reg, uint8_t p, uint32_t entry)
+{ // the (25-p) extra index bits of a sparse entry are the first bits used by the rank in dense mode
+  uint32_t idx25 = entry >> 6, diff = CRPX_HLL_SPARSE_PRECISION - p;
+  uint32_t idx = idx25 >> diff, extra = idx25 & ((1U << diff) - 1);
+  uint8_t rho = extra ? (uint8_t)(__builtin_clz (extra) - (32 - diff) + 1) : (uint8_t)(diff + (entry & 63));
+  if (reg[idx] < rho) reg[idx] = rho;
+}
+
+bool
+crpx_hyperloglog_densify (crpx_hyperloglog_t hll)
+{
+  size_t i;
+  if (!hll->is_sparse) return true;
+  hll->reg = (uint8_t *) crpx_calloc (hll->cglob, hll->m, sizeof (uint8_t));
+  if (!hll->reg) return false;
+  for (i = 0; i < hll->n_sparse; i++) hll_dense_add_sparse_entry (hll->reg, hll->p, hll->sparse[i]);
+  for (i = 0; i < hll->n_buffer; i++) hll_dense_add_sparse_entry (hll->reg, hll->p, hll->buffer[i]);
+  crpx_free (hll->cglob, hll->sparse);
+  crpx_free (hll->cglob, hll->buffer);
+  hll->sparse = hll->buffer = NULL;
+  hll->n_sparse = hll->n_buffer = 0;
+  hll->is_sparse = false;
+  return true;
+}
+
+bool
+crpx_hyperloglog_merge (crpx_hyperloglog_t dst, crpx_hyperloglog_t src)
+{
+  size_t i;
+  if (dst->p != src->p) {
+    crpx_logger_error (dst->cglob, "crpx_hyperloglog_merge: cannot merge HLLs of distinct precisions (%u and %u)", dst->p, src->p);
+    return false;
+  }
+  if (src->is_sparse) { // entries are copied s.t. src is not modified
+    for (i = 0; i < src->n_sparse; i++) hll_add_sparse_entry (dst, src->sparse[i]);
+    for (i = 0; i < src->n_buffer; i++) hll_add_sparse_entry (dst, src->buffer[i]);
+    return true;
+  }
+  if (!crpx_hyperloglog_densify (dst)) return false;
+  hll_register_max_merge (dst->cglob, dst->reg, src->reg, dst->m);
+  return true;
+}
+
+static void
+hll_register_max_merge (__attribute__((unused)) crpx_global_t cglob, uint8_t *dst, const uint8_t *src, size_t m)
+{
+  size_t i = 0;
+#ifdef __AVX2__
+  if (cglob->avx) for (; i + 32 <= m; i += 32) {
+    __m256i a = _mm256_loadu_si256 ((const __m256i*)(dst + i)), b = _mm256_loadu_si256 ((const __m256i*)(src + i));
+    _mm256_storeu_si256 ((__m256i*)(dst + i), _mm256_max_epu8 (a, b));
+  }
+#endif
+#ifdef __SSE4_2__
+  if (cglob->sse) for (; i + 16 <= m; i += 16) {
+    __m128i a = _mm_loadu_si128 ((const __m128i*)(dst + i)), b = _mm_loadu_si128 ((const __m128i*)(src + i));
+    _mm_storeu_si128 ((__m128i*)(dst + i), _mm_max_epu8 (a, b));
+  }
+#endif
+  for (; i < m; i++) if (dst[i] < src[i]) dst[i] = src[i];
+}
+
+static double
+hll_harmonic_sum (__attribute__((unused)) crpx_global_t cglob, const uint8_t *reg, size_t m, size_t *n_zeros)
+{ // sum of 2^{-reg[i]} and number of empty registers
+  size_t i = 0, zeros = 0;
+  double sum = 0.;
+#ifdef __AVX2__
+  if (cglob->avx) {
+    int32_t w;
+    double partial[4];
+    const __m256i exponent_bias = _mm256_set1_epi64x (1023), zero = _mm256_setzero_si256 ();
+    __m256d acc[4] = {_mm256_setzero_pd (), _mm256_setzero_pd (), _mm256_setzero_pd (), _mm256_setzero_pd ()};
+    for (; i + 32 <= m; i += 32) {
+      __m256i r = _mm256_loadu_si256 ((const __m256i*)(reg + i));
+      zeros += __builtin_popcount ((uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (r, zero)));
+      for (int j = 0; j < 8; j++) { // 2^{-r} is the double with zero mantissa and exponent (1023 - r)
+        memcpy (&w, reg + i + 4 * j, sizeof (int32_t));
+        __m256i r4 = _mm256_cvtepu8_epi64 (_mm_cvtsi32_si128 (w));
+        acc[j & 3] = _mm256_add_pd (acc[j & 3], _mm256_castsi256_pd (_mm256_slli_epi64 (_mm256_sub_epi64 (exponent_bias, r4), 52)));
+      }
+    }
+    _mm256_storeu_pd (partial, _mm256_add_pd (_mm256_add_pd (acc[0], acc[1]), _mm256_add_pd (acc[2], acc[3])));
+    sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+  }
+#endif
+  for (; i < m; i++) {
+    zeros += (reg[i] == 0);
+    sum += 1. / (double)(1ULL << reg[i]); // reg[i] <= 61 since p >= 4
+  }
+  *n_zeros = zeros;
+  return sum;
+}
+
+double
+crpx_hyperloglog_estimate (crpx_hyperloglog_t hll)
+{
+  if (hll->is_sparse) { // linear counting over the 2^25 sparse cells
+    const double m_sparse = (double)(1UL << CRPX_HLL_SPARSE_PRECISION);
+    hll_flush_buffer (hll);
+    if (hll->is_sparse) return m_sparse * log (m_sparse / (m_sparse - (double) hll->n_sparse));
+  }
+  uint32_t i, q = 64 - hll->p, C[66] = {0}; // C[k] = number of registers with value k
+  double m = (double) hll->m, z;
+  for (i = 0; i < hll->m; i++) C[hll->reg[i]]++;
+  z = m * hll_tau (1. - (double) C[q+1] / m);
+  for (i = q; i > 0; i--) z = 0.5 * (z + (double) C[i]);
+  z += m * hll_sigma ((double) C[0] / m);
+  return m * m / (2. * log (2.) * z); // zero if all registers are empty, since sigma(1) = inf
+}
+
+double
+crpx_hyperloglog_estimate_harmonic (crpx_hyperloglog_t hll)
+{
+  size_t zeros = 0;
+  double m = (double) hll->m, alpha, estimate, lc;
+  if (hll->is_sparse) return crpx_hyperloglog_estimate (hll);
+  switch (hll->m) {
+    case 16: alpha = 0.673; break;
+    case 32: alpha = 0.697; break;
+    case 64: alpha = 0.709; break;
+    default: alpha = 0.7213 / (1. + 1.079 / m); break;
+  }
+  estimate = alpha * m * m / hll_harmonic_sum (hll->cglob, hll->reg, hll->m, &zeros);
+  if (zeros) {
+    lc = m * log (m / (double) zeros);
+    if (lc <= hll_linear_counting_threshold[hll->p - CRPX_HLL_MIN_PRECISION]) return lc;
+  }
+  return estimate;
+}
+
+static double
+hll_sigma (double x)
+{ // Ertl (2017) algorithm 6
+  double y = 1., z = x, z_prev;
+  if (x == 1.) return INFINITY;
+  do {
+    x *= x; z_prev = z; z += x * y; y += y;
+  } while (z_prev != z);
+  return z;
+}
+
+static double
+hll_tau (double x)
+{ // Ertl (2017) algorithm 6
+  double y = 1., z = 1. - x, z_prev;
+  if ((x == 0.) || (x == 1.)) return 0.;
+  do {
+    x = sqrt (x); z_prev = z; y *= 0.5; z -= (1. - x) * (1. - x) * y;
+  } while (z_prev != z);
+  return z / 3.;
+}
+
+static int
+compare_uint32_increasing (const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
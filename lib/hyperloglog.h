@@ -0,0 +1,64 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file hyperloglog.h
+ *  \brief HyperLogLog++ cardinality estimator, with sparse representation for small sets and SIMD register merge.
+ *  The sparse mode follows Heule et al. (HLL++, 2013) with a 25 bits index; the default estimator is the improved
+ *  (bias-free) estimator from Ertl (arXiv:1702.01284), which replaces the empirical bias tables of HLL++. */
+
+#ifndef _curupixa_hyperloglog_h_
+#define _curupixa_hyperloglog_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+#define CRPX_HLL_MIN_PRECISION 4
+#define CRPX_HLL_MAX_PRECISION 18
+#define CRPX_HLL_SPARSE_PRECISION 25 /*!< \brief index length (in bits) of sparse entries */
+
+typedef struct {
+  uint8_t *reg;      /*!< \brief dense registers (m = 2^p bytes), NULL while in sparse mode */
+  uint32_t *sparse,  /*!< \brief sorted list of (25 bits index, 6 bits rank) entries, with unique indices */
+           *buffer;  /*!< \brief unsorted entries waiting to be merged into sparse[] */
+  size_t n_sparse, n_buffer, max_sparse, max_buffer;
+  uint32_t m;        /*!< \brief number of registers (2^p) */
+  uint8_t p;         /*!< \brief precision, from 4 to 18 (standard error is 1.04/sqrt(m)) */
+  bool is_sparse;
+  crpx_global_t cglob;
+} crpx_hyperloglog_struct, *crpx_hyperloglog_t;
+
+/*! \brief new HLL with precision p (between 4 and 18), starting in sparse mode. Returns NULL in case of error */
+crpx_hyperloglog_t new_crpx_hyperloglog (crpx_global_t cglob, uint8_t precision);
+void del_crpx_hyperloglog (crpx_hyperloglog_t hll);
+void crpx_hyperloglog_reset (crpx_hyperloglog_t hll);
+/*! \brief add a 64 bits hash value: the first p bits are the register index, thus it must be a good quality hash */
+void crpx_hyperloglog_add_hash (crpx_hyperloglog_t hll, uint64_t hash);
+/*! \brief add an integer (e.g. 2-bit encoded k-mer), which is mixed before being added */
+void crpx_hyperloglog_add_uint64 (crpx_hyperloglog_t hll, uint64_t x);
+/*! \brief add n hash values in parallel: each thread fills its own HLL, which are merged at the end */
+void crpx_hyperloglog_add_hash_array (crpx_hyperloglog_t hll, const uint64_t *hash, size_t n);
+/*! \brief dst = union(dst, src); both must have same precision. Uses AVX2 or SSE2 max() over dense registers */
+bool crpx_hyperloglog_merge (crpx_hyperloglog_t dst, crpx_hyperloglog_t src);
+/*! \brief convert from sparse to dense representation (called automatically when the sparse list is too large) */
+bool crpx_hyperloglog_densify (crpx_hyperloglog_t hll);
+/*! \brief default (bias-corrected) estimate: linear counting over 2^25 cells while sparse, Ertl's improved estimator when dense */
+double crpx_hyperloglog_estimate (crpx_hyperloglog_t hll);
+/*! \brief classic harmonic-mean estimate with HLL++ thresholds for linear counting (AVX2 kernel for the sum) */
+double crpx_hyperloglog_estimate_harmonic (crpx_hyperloglog_t hll);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
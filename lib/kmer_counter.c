@@ -0,0 +1,245 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file kmer_counter.c
+ *  \brief disk-based k-mer counting: buffered partitioning to temporary files, and radix sort of each partition.
+ *  Buffers of pass one are released during pass two, s.t. both passes can use the whole memory budget. */
+
+#include "kmer_counter.h"
+
+#define KC_DEFAULT_PARTITIONS 256
+#define KC_MIN_BUFFER 64
+#define KC_MAX_BUFFER (1U << 20)
+#define KC_CHUNK 4096UL        /* number of k-mers encoded at once from a sequence */
+#define KC_BYTES_PER_KMER 20   /* memory in pass two: k-mer + radix sort buffer + counter */
+
+static bool kc_spill (crpx_kmer_counter_t kc, uint16_t p, const uint64_t *buf, size_t n);
+static void kc_radix_sort (uint64_t *a, uint64_t *tmp, size_t n, uint8_t n_bytes);
+
+static inline uint16_t
+kc_partition (crpx_kmer_counter_t kc, uint64_t kmer)
+{
+  return (uint16_t)(((__uint128_t) crpx_hashint_murmurmix64 (kmer) * (__uint128_t) kc->n_partitions) >> 64);
+}
+
+crpx_kmer_counter_t
+new_crpx_kmer_counter (crpx_global_t cglob, uint8_t k, uint16_t n_partitions, size_t memory_budget, const char *tmp_dir)
+{
+  uint64_t i, n_buffers;
+  char *filename;
+  if ((k < 1) || (k > CRPX_KMER_MAX_K)) {
+    crpx_logger_error (cglob, "new_crpx_kmer_counter: k must be between 1 and %d, not %u", CRPX_KMER_MAX_K, k);
+    return NULL;
+  }
+  if (!tmp_dir) tmp_dir = getenv ("TMPDIR");
+  if (!tmp_dir) tmp_dir = "/tmp";
+  crpx_kmer_counter_t kc = (crpx_kmer_counter_t) crpx_malloc (cglob, sizeof (crpx_kmer_counter_struct));
+  if (!kc) return NULL;
+  kc->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, kc->cglob); // thread-safe increase of ref_counter
+  kc->k = k;
+  kc->n_partitions = n_partitions ? n_partitions : KC_DEFAULT_PARTITIONS;
+  kc->n_threads = CRPX_MAX (1, cglob->nthreads);
+  kc->memory_budget = memory_budget;
+  n_buffers = (uint64_t) kc->n_threads * kc->n_partitions;
+  i = memory_budget / (2 * sizeof (uint64_t) * n_buffers); // half of budget for buffers in pass one
+  kc->buffer_capacity = (uint32_t) CRPX_MIN (KC_MAX_BUFFER, CRPX_MAX (KC_MIN_BUFFER, i));
+  if (i < KC_MIN_BUFFER) crpx_logger_warning (cglob, "new_crpx_kmer_counter: memory budget too small, using %lu bytes for buffers",
+                                              KC_MIN_BUFFER * sizeof (uint64_t) * n_buffers);
+
+  kc->file = (FILE **) crpx_calloc (cglob, kc->n_partitions, sizeof (FILE *));
+  kc->n_kmers = (uint64_t *) crpx_calloc (cglob, kc->n_partitions, sizeof (uint64_t));
+  kc->buffer_size = (uint32_t *) crpx_calloc (cglob, n_buffers, sizeof (uint32_t));
+  kc->buffer = (uint64_t *) crpx_malloc (cglob, n_buffers * kc->buffer_capacity * sizeof (uint64_t));
+  filename = (char *) crpx_malloc (cglob, strlen (tmp_dir) + 32);
+  if (!kc->file || !kc->n_kmers || !kc->buffer_size || !kc->buffer || !filename) {
+    if (filename) crpx_free (cglob, filename);
+    del_crpx_kmer_counter (kc);
+    return NULL;
+  }
+  for (i = 0; i < kc->n_partitions; i++) { // files are unlinked right away, and thus removed when closed
+    sprintf (filename, "%s/crpx_kmers_XXXXXX", tmp_dir);
+    int fd = mkstemp (filename);
+    if ((fd < 0) || !(kc->file[i] = fdopen (fd, "w+b"))) {
+      crpx_logger_error (cglob, "new_crpx_kmer_counter: could not create temporary file %s: %s", filename, strerror (errno));
+      if (fd >= 0) { close (fd); unlink (filename); }
+      crpx_free (cglob, filename);
+      del_crpx_kmer_counter (kc);
+      return NULL;
+    }
+    unlink (filename);
+  }
+  crpx_free (cglob, filename);
+  crpx_logger_verbose (cglob, "k-mer counter with %u partitions in %s, and buffers of %u k-mers", kc->n_partitions, tmp_dir, kc->buffer_capacity);
+  return kc;
+}
+
+void
+del_crpx_kmer_counter (crpx_kmer_counter_t kc)
+{
+  if (!kc) return;
+  crpx_global_t cglob = kc->cglob;
+  if (kc->file) {
+    for (uint16_t i = 0; i < kc->n_partitions; i++) if (kc->file[i]) fclose (kc->file[i]);
+    crpx_free (cglob, kc->file);
+  }
+  if (kc->n_kmers)     crpx_free (cglob, kc->n_kmers);
+  if (kc->buffer_size) crpx_free (cglob, kc->buffer_size);
+  if (kc->buffer)      crpx_free (cglob, kc->buffer);
+  crpx_global_finalise (kc->cglob); // it just decreases cglob->ref_counter
+  free (kc);
+}
+
+static bool
+kc_spill (crpx_kmer_counter_t kc, uint16_t p, const uint64_t *buf, size_t n)
+{
+  bool success;
+#pragma omp critical (crpx_kmer_counter_spill)
+  {
+    success = (fwrite (buf, sizeof (uint64_t), n, kc->file[p]) == n);
+    kc->n_kmers[p] += n;
+  }
+  if (!success) crpx_logger_error (kc->cglob, "kmer_counter: could not write to temporary file (disk full?)");
+  return success;
+}
+
+bool
+crpx_kmer_counter_add_sequence (crpx_kmer_counter_t kc, const char *seq, size_t len)
+{
+  uint64_t kmers[KC_CHUNK], *buf;
+  size_t i, j, n, start, tid = CRPX_THREAD_NUM;
+  uint16_t p;
+  if (!kc->buffer) {
+    crpx_logger_error (kc->cglob, "kmer_counter: buffers not available (memory allocation failed after last count)");
+    return false;
+  }
+  if (tid >= kc->n_threads) {
+    crpx_logger_error (kc->cglob, "kmer_counter: thread %lu not expected (counter created for %u threads)", tid, kc->n_threads);
+    return false;
+  }
+  for (start = 0; start + kc->k <= len; start += KC_CHUNK) { // chunks overlap by k-1 nucleotides
+    n = crpx_kmer_encode_sequence (seq + start, CRPX_MIN (len - start, KC_CHUNK + kc->k - 1), kc->k, true, kmers);
+    for (i = 0; i < n; i++) {
+      p = kc_partition (kc, kmers[i]);
+      j = tid * kc->n_partitions + p;
+      buf = kc->buffer + j * kc->buffer_capacity;
+      buf[kc->buffer_size[j]++] = kmers[i];
+      if (kc->buffer_size[j] == kc->buffer_capacity) {
+        if (!kc_spill (kc, p, buf, kc->buffer_size[j])) return false;
+        kc->buffer_size[j] = 0;
+      }
+    }
+  }
+  return true;
+}
+
+bool
+crpx_kmer_counter_add_sequences (crpx_kmer_counter_t kc, char **seq, const size_t *len, size_t n)
+{
+  size_t i;
+  bool success = true;
+#pragma omp parallel for schedule(dynamic) reduction(&&:success)
+  for (i = 0; i < n; i++) success = crpx_kmer_counter_add_sequence (kc, seq[i], len ? len[i] : strlen (seq[i])) && success;
+  return success;
+}
+
+static void
+kc_radix_sort (uint64_t *a, uint64_t *tmp, size_t n, uint8_t n_bytes)
+{ // LSD radix sort over the bytes used by k-mers; skips bytes where all k-mers are equal
+  size_t count[256], i, sum, x;
+  uint64_t *src = a, *dst = tmp, *swap;
+  if (n < 2) return;
+  for (uint8_t b = 0; b < n_bytes; b++) {
+    int shift = 8 * b;
+    memset (count, 0, sizeof (count));
+    for (i = 0; i < n; i++) count[(src[i] >> shift) & 0xff]++;
+    if (count[(src[0] >> shift) & 0xff] == n) continue;
+    for (sum = i = 0; i < 256; i++) { x = count[i]; count[i] = sum; sum += x; }
+    for (i = 0; i < n; i++) dst[ count[(src[i] >> shift) & 0xff]++ ] = src[i];
+    swap = src; src = dst; dst = swap;
+  }
+  if (src != a) memcpy (a, src, n * sizeof (uint64_t));
+}
+
+bool
+crpx_kmer_counter_count (crpx_kmer_counter_t kc, uint32_t min_count, crpx_kmer_count_func func, void *data)
+{
+  crpx_global_t cglob = kc->cglob;
+  uint64_t i, max_n = 0, total = 0, n_distinct = 0;
+  int n_workers;
+  bool success = true;
+
+  if (!kc->buffer) return false;
+  for (i = 0; i < (uint64_t) kc->n_threads * kc->n_partitions; i++) if (kc->buffer_size[i]) { // flush buffers
+    success = kc_spill (kc, (uint16_t)(i % kc->n_partitions), kc->buffer + i * kc->buffer_capacity, kc->buffer_size[i]) && success;
+    kc->buffer_size[i] = 0;
+  }
+  crpx_free (cglob, kc->buffer); // pass two has the whole memory budget; buffers are allocated again at the end
+  kc->buffer = NULL;
+  for (i = 0; i < kc->n_partitions; i++) { max_n = CRPX_MAX (max_n, kc->n_kmers[i]); total += kc->n_kmers[i]; }
+  if (max_n * KC_BYTES_PER_KMER > kc->memory_budget) {
+    crpx_logger_error (cglob, "kmer_counter: largest partition needs %lu bytes, above memory budget of %lu bytes; please increase "
+                       "number of partitions", max_n * KC_BYTES_PER_KMER, kc->memory_budget);
+    success = false;
+  }
+  if (!success) goto kmer_counter_count_end;
+  n_workers = (int) CRPX_MAX (1, CRPX_MIN ((uint64_t) kc->n_threads, kc->memory_budget / CRPX_MAX (1, max_n * KC_BYTES_PER_KMER)));
+  crpx_logger_verbose (cglob, "k-mer counter: %lu k-mers in %u partitions (largest with %lu), sorted by %d threads",
+                       total, kc->n_partitions, max_n, n_workers);
+
+#pragma omp parallel num_threads(n_workers) reduction(&&:success) reduction(+:n_distinct)
+  {
+    uint64_t *kmer = (uint64_t *) crpx_malloc (cglob, CRPX_MAX (1, max_n) * sizeof (uint64_t));
+    uint64_t *tmp  = (uint64_t *) crpx_malloc (cglob, CRPX_MAX (1, max_n) * sizeof (uint64_t));
+    uint32_t *count = (uint32_t *) crpx_malloc (cglob, CRPX_MAX (1, max_n) * sizeof (uint32_t));
+    uint64_t p, j, n, m;
+    if (!kmer || !tmp || !count) success = false;
+
+#pragma omp for schedule(dynamic)
+    for (p = 0; p < kc->n_partitions; p++) if (success && kc->n_kmers[p]) {
+      n = kc->n_kmers[p];
+      rewind (kc->file[p]);
+      if (fread (kmer, sizeof (uint64_t), n, kc->file[p]) != n) {
+        crpx_logger_error (cglob, "kmer_counter: could not read temporary file of partition %lu", p);
+        success = false;
+        continue;
+      }
+      kc_radix_sort (kmer, tmp, n, (uint8_t)((2 * kc->k + 7) / 8));
+      for (m = 0, j = 0; j < n;) { // run-length encoding, in place
+        uint64_t x = kmer[j];
+        uint32_t c = 0;
+        for (; (j < n) && (kmer[j] == x); j++) if (c < UINT32_MAX) c++;
+        if (c >= min_count) { kmer[m] = x; count[m++] = c; }
+      }
+      n_distinct += m;
+      if (m && func) {
+#pragma omp critical (crpx_kmer_counter_output)
+        func (kmer, count, m, data);
+      }
+    }
+    if (kmer)  crpx_free (cglob, kmer);
+    if (tmp)   crpx_free (cglob, tmp);
+    if (count) crpx_free (cglob, count);
+  } // omp parallel
+
+  for (i = 0; i < kc->n_partitions; i++) { // empty files, s.t. counter can be reused
+    rewind (kc->file[i]);
+    if (ftruncate (fileno (kc->file[i]), 0) != 0) success = false;
+    kc->n_kmers[i] = 0;
+  }
+  crpx_logger_verbose (cglob, "k-mer counter: %lu distinct k-mers with count at least %u", n_distinct, min_count);
+
+kmer_counter_count_end:
+  kc->buffer = (uint64_t *) crpx_malloc (cglob, (uint64_t) kc->n_threads * kc->n_partitions * kc->buffer_capacity * sizeof (uint64_t));
+  return success && kc->buffer;
+}
@@ -0,0 +1,56 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file kmer_counter.h
+ *  \brief two-pass, disk-based counter of canonical k-mers (in the style of KMC, Deorowicz et al. 2015) for sets
+ *  larger than memory. Pass one hashes each canonical k-mer into one of n_partitions, through per-thread buffers which
+ *  are spilled to (unlinked) temporary files. Pass two loads each partition, sorts it by radix sort and counts
+ *  repeated k-mers, with as many partitions in parallel as the memory budget allows. */
+
+#ifndef _curupixa_kmer_counter_h_
+#define _curupixa_kmer_counter_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "kmer_encoding.h"
+
+/*! \brief receives the sorted k-mers of one partition with their counts (called by one thread at a time) */
+typedef void (*crpx_kmer_count_func) (const uint64_t *kmer, const uint32_t *count, size_t n, void *data);
+
+typedef struct {
+  FILE **file;           /*!< \brief one temporary file per partition */
+  uint64_t *n_kmers;     /*!< \brief number of k-mers (with repetitions) in each partition */
+  uint64_t *buffer;      /*!< \brief n_threads x n_partitions buffers of buffer_capacity k-mers each */
+  uint32_t *buffer_size, buffer_capacity;
+  size_t memory_budget;  /*!< \brief maximum memory (in bytes) used by buffers in pass one or by pass two (buffers are freed during pass two) */
+  uint16_t n_partitions, n_threads;
+  uint8_t k;
+  crpx_global_t cglob;
+} crpx_kmer_counter_struct, *crpx_kmer_counter_t;
+
+/*! \brief new counter for k-mers of size k (up to 32); n_partitions=0 uses 256; tmp_dir=NULL uses $TMPDIR or /tmp */
+crpx_kmer_counter_t new_crpx_kmer_counter (crpx_global_t cglob, uint8_t k, uint16_t n_partitions, size_t memory_budget, const char *tmp_dir);
+void del_crpx_kmer_counter (crpx_kmer_counter_t kc);
+/*! \brief pass one: adds canonical k-mers from sequence; thread-safe (each OpenMP thread has its own buffers) */
+bool crpx_kmer_counter_add_sequence (crpx_kmer_counter_t kc, const char *seq, size_t len);
+/*! \brief pass one over n sequences in parallel (len may be NULL for null-terminated sequences) */
+bool crpx_kmer_counter_add_sequences (crpx_kmer_counter_t kc, char **seq, const size_t *len, size_t n);
+/*! \brief pass two: k-mers with count >= min_count are sent to func, one partition at a time. Must be called outside
+ *  parallel regions; afterwards the counter is empty and can be reused. Returns false in case of error */
+bool crpx_kmer_counter_count (crpx_kmer_counter_t kc, uint32_t min_count, crpx_kmer_count_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,127 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file kmer_encoding.c
+ *  \brief 2 bits encoding of nucleotide k-mers, shared by k-mer counters, sketches, and indices. */
+
+#include "kmer_encoding.h"
+
+const uint8_t crpx_dna_2bit_code[256] = { // A/a=0, C/c=1, G/g=2, T/t/U/u=3, others=4
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+inline uint64_t
+crpx_kmer_mask (uint8_t k)
+{
+  return (k >= 32) ? UINT64_MAX : (1ULL << (2 * k)) - 1;
+}
+
+inline uint64_t
+crpx_kmer_reverse_complement (uint64_t kmer, uint8_t k)
+{ // complement is (3 - x) = (x ^ 3); then reverse order of 2 bits groups
+  uint64_t x = ~kmer;
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+  return __builtin_bswap64 (x) >> (64 - 2 * k);
+}
+
+inline uint64_t
+crpx_kmer_canonical (uint64_t kmer, uint8_t k)
+{
+  uint64_t rc = crpx_kmer_reverse_complement (kmer, k);
+  return (rc < kmer) ? rc : kmer;
+}
+
+/* shifts of crpx_hashint_splitmix64() (30, 27, 31 for 64 bits), scaled to the 2k bits of the k-mer; multipliers are
+ * odd and thus invertible modulo 2^2k (their inverses modulo 2^64 are also inverses modulo 2^2k) */
+#define KMER_HASH_SHIFT(w,s) (((w) * (s) >= 128) ? ((w) * (s)) >> 6 : 1)
+
+static inline uint64_t
+kmer_xorshift_inverse (uint64_t x, uint8_t shift, uint8_t bits)
+{ // y = x ^ (x >> shift) is undone by x = y ^ (y >> shift) ^ (y >> 2 shift) ^ ..., computed with doubling shifts
+  for (uint8_t s = shift; s < bits; s *= 2) x ^= x >> s;
+  return x;
+}
+
+inline uint64_t
+crpx_kmer_invertible_hash (uint64_t kmer, uint8_t k)
+{
+  uint8_t w = 2 * k;
+  uint64_t mask = crpx_kmer_mask (k);
+  kmer ^= kmer >> KMER_HASH_SHIFT(w, 30); kmer = (kmer * 0xbf58476d1ce4e5b9ULL) & mask;
+  kmer ^= kmer >> KMER_HASH_SHIFT(w, 27); kmer = (kmer * 0x94d049bb133111ebULL) & mask;
+  return kmer ^ (kmer >> KMER_HASH_SHIFT(w, 31));
+}
+
+inline uint64_t
+crpx_kmer_invertible_hash_inverse (uint64_t hash, uint8_t k)
+{ // constants are the inverses used by crpx_hashint_splitmix64_inverse()
+  uint8_t w = 2 * k;
+  uint64_t mask = crpx_kmer_mask (k);
+  hash = kmer_xorshift_inverse (hash, KMER_HASH_SHIFT(w, 31), w); hash = (hash * 0x319642b2d24d8ec3ULL) & mask;
+  hash = kmer_xorshift_inverse (hash, KMER_HASH_SHIFT(w, 27), w); hash = (hash * 0x96de1b173f119089ULL) & mask;
+  return kmer_xorshift_inverse (hash, KMER_HASH_SHIFT(w, 30), w);
+}
+
+void
+crpx_kmer_invertible_hash_array (const uint64_t *in, size_t n, uint8_t k, uint64_t *out)
+{
+  int64_t i;
+#pragma omp parallel for schedule(static) if (n > 65536)
+  for (i = 0; i < (int64_t) n; i++) out[i] = crpx_kmer_invertible_hash (in[i], k);
+}
+
+void
+crpx_kmer_invertible_hash_inverse_array (const uint64_t *in, size_t n, uint8_t k, uint64_t *out)
+{
+  int64_t i;
+#pragma omp parallel for schedule(static) if (n > 65536)
+  for (i = 0; i < (int64_t) n; i++) out[i] = crpx_kmer_invertible_hash_inverse (in[i], k);
+}
+
+size_t
+crpx_kmer_encode_sequence (const char *seq, size_t len, uint8_t k, bool canonical, uint64_t *kmers)
+{ // forward and reverse strands are updated at each position, instead of calling crpx_kmer_reverse_complement()
+  uint64_t fw = 0, rv = 0, mask = crpx_kmer_mask (k);
+  uint8_t c, shift = 2 * (k - 1);
+  size_t i, n = 0, valid = 0;
+  for (i = 0; i < len; i++) {
+    if ((c = crpx_dna_2bit_code[(uint8_t) seq[i]]) == CRPX_KMER_INVALID) { valid = 0; continue; }
+    fw = ((fw << 2) | c) & mask;
+    rv = (rv >> 2) | ((uint64_t)(3 - c) << shift);
+    if (++valid >= k) kmers[n++] = (canonical && (rv < fw)) ? rv : fw;
+  }
+  return n;
+}
+
+void
+crpx_kmer_to_string (uint64_t kmer, uint8_t k, char *str)
+{
+  for (int i = k - 1; i >= 0; i--, kmer >>= 2) str[i] = "ACGT"[kmer & 3];
+  str[k] = '\0';
+}
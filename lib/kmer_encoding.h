@@ -0,0 +1,55 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file kmer_encoding.h
+ *  \brief 2 bits encoding of DNA k-mers (A=0, C=1, G=2, T=3) into uint64_t, for k up to 32. The first nucleotide is
+ *  in the most significant bits, s.t. the numeric order of k-mers is the lexicographic order. */
+
+#ifndef _curupixa_kmer_encoding_h_
+#define _curupixa_kmer_encoding_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+#define CRPX_KMER_MAX_K 32
+#define CRPX_KMER_INVALID 4 /*!< \brief code of non-ACGT characters in crpx_dna_2bit_code[] */
+
+/*! \brief 2 bits code of each char (upper or lower case, U is same as T), and CRPX_KMER_INVALID for other chars */
+extern const uint8_t crpx_dna_2bit_code[256];
+
+/*! \brief bits used by a k-mer (lower 2k bits set) */
+extern uint64_t crpx_kmer_mask (uint8_t k);
+extern uint64_t crpx_kmer_reverse_complement (uint64_t kmer, uint8_t k);
+/*! \brief minimum between k-mer and its reverse complement */
+extern uint64_t crpx_kmer_canonical (uint64_t kmer, uint8_t k);
+/*! \brief stores all k-mers (canonical or forward) from seq into kmers[] (which must have room for len - k + 1 elements),
+ *  skipping k-mers with non-ACGT characters. Returns number of k-mers */
+size_t crpx_kmer_encode_sequence (const char *seq, size_t len, uint8_t k, bool canonical, uint64_t *kmers);
+/*! \brief bijection over the 2k bits of a k-mer (splitmix64 xorshift-multiply rounds, with shifts scaled to 2k bits and
+ *  products modulo 2^2k), s.t. the high bits of the result can be used as a bucket and the low bits stored in its
+ *  place. For k=32 it is crpx_hashint_splitmix64() */
+extern uint64_t crpx_kmer_invertible_hash (uint64_t kmer, uint8_t k);
+/*! \brief inverse of crpx_kmer_invertible_hash(), for k=32 it is crpx_hashint_splitmix64_inverse() */
+extern uint64_t crpx_kmer_invertible_hash_inverse (uint64_t hash, uint8_t k);
+/*! \brief bulk versions (in parallel for large n); out may be the same as in */
+void crpx_kmer_invertible_hash_array (const uint64_t *in, size_t n, uint8_t k, uint64_t *out);
+void crpx_kmer_invertible_hash_inverse_array (const uint64_t *in, size_t n, uint8_t k, uint64_t *out);
+/*! \brief writes k-mer as a null-terminated string (str must have room for k + 1 chars) */
+void crpx_kmer_to_string (uint64_t kmer, uint8_t k, char *str);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
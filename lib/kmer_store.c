@@ -0,0 +1,183 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file kmer_store.c
+ *  \brief static quotiented k-mer set; lookups scan a single bucket of bit-packed remainders. */
+
+#include "kmer_store.h"
+
+#define KS_KMERS_PER_BUCKET 16
+#define KS_MAX_BUCKET_BITS 32 /* 2^32 + 1 offsets (32GB) is already more than any sensible store */
+
+static int compare_uint64_increasing (const void *a, const void *b);
+
+static inline uint64_t
+ks_bucket (crpx_kmer_store_t ks, uint64_t hash)
+{
+  return (ks->remainder_bits < 64) ? hash >> ks->remainder_bits : 0;
+}
+
+static inline uint64_t
+ks_get_remainder (crpx_kmer_store_t ks, uint64_t i)
+{ // remainders may span two words; array has one extra word, s.t. reading beyond the last is safe
+  uint8_t r = ks->remainder_bits;
+  uint64_t bit = i * r, off = bit & 63, x;
+  if (!r) return 0;
+  x = ks->remainder[bit >> 6] >> off;
+  if (off + r > 64) x |= ks->remainder[(bit >> 6) + 1] << (64 - off);
+  return (r < 64) ? x & ((1ULL << r) - 1) : x;
+}
+
+static inline void
+ks_set_remainder (crpx_kmer_store_t ks, uint64_t i, uint64_t x)
+{ // array must be zeroed before, since bits are only set
+  uint8_t r = ks->remainder_bits;
+  uint64_t bit = i * r, off = bit & 63;
+  if (!r) return;
+  ks->remainder[bit >> 6] |= x << off;
+  if (off + r > 64) ks->remainder[(bit >> 6) + 1] |= x >> (64 - off);
+}
+
+crpx_kmer_store_t
+new_crpx_kmer_store (crpx_global_t cglob, uint8_t k, const uint64_t *kmers, size_t n, uint8_t bucket_bits)
+{
+  uint64_t i, j, b, n_buckets, *hash = NULL, *sorted = NULL, *start = NULL, mask;
+  if ((k < 1) || (k > CRPX_KMER_MAX_K)) {
+    crpx_logger_error (cglob, "new_crpx_kmer_store: k must be between 1 and %d, not %u", CRPX_KMER_MAX_K, k);
+    return NULL;
+  }
+  if ((bucket_bits > 2 * k) || (bucket_bits > KS_MAX_BUCKET_BITS)) {
+    crpx_logger_error (cglob, "new_crpx_kmer_store: bucket_bits=%u must not exceed the %u bits of k-mers nor %d", bucket_bits, 2 * k, KS_MAX_BUCKET_BITS);
+    return NULL;
+  }
+  if (!bucket_bits) for (bucket_bits = 1; (bucket_bits < CRPX_MIN (2 * k, KS_MAX_BUCKET_BITS)) && (((uint64_t) KS_KMERS_PER_BUCKET << bucket_bits) < n); bucket_bits++);
+  crpx_kmer_store_t ks = (crpx_kmer_store_t) crpx_malloc (cglob, sizeof (crpx_kmer_store_struct));
+  if (!ks) return NULL;
+  ks->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, ks->cglob); // thread-safe increase of ref_counter
+  ks->k = k;
+  ks->bucket_bits = bucket_bits;
+  ks->remainder_bits = 2 * k - bucket_bits;
+  ks->n_kmers = 0;
+  ks->remainder = NULL;
+  n_buckets = 1ULL << bucket_bits;
+  ks->offset = (uint64_t *) crpx_calloc (cglob, n_buckets + 1, sizeof (uint64_t));
+  start  = (uint64_t *) crpx_malloc (cglob, (n_buckets + 1) * sizeof (uint64_t));
+  hash   = (uint64_t *) crpx_malloc (cglob, (n + 1) * sizeof (uint64_t));
+  sorted = (uint64_t *) crpx_malloc (cglob, (n + 1) * sizeof (uint64_t));
+  if (!ks->offset || !start || !hash || !sorted) goto new_kmer_store_error;
+
+  mask = crpx_kmer_mask (k);
+  for (i = 0; i < n; i++) hash[i] = kmers[i] & mask;
+  crpx_kmer_invertible_hash_array (hash, n, k, hash);
+  for (i = 0; i < n; i++) ks->offset[ks_bucket (ks, hash[i]) + 1]++; // counting sort by bucket
+  for (b = 0; b < n_buckets; b++) ks->offset[b+1] += ks->offset[b];
+  memcpy (start, ks->offset, (n_buckets + 1) * sizeof (uint64_t));
+  for (i = 0; i < n; i++) sorted[ start[ks_bucket (ks, hash[i])]++ ] = hash[i];
+
+  for (j = b = 0; b < n_buckets; b++) { // sort each bucket and remove duplicates; offsets only decrease
+    uint64_t first = ks->offset[b], last = ks->offset[b+1];
+    if (last - first > 1) qsort (sorted + first, last - first, sizeof (uint64_t), compare_uint64_increasing);
+    ks->offset[b] = j;
+    for (i = first; i < last; i++) if ((i == first) || (sorted[i] != sorted[i-1])) sorted[j++] = sorted[i];
+  }
+  ks->offset[n_buckets] = ks->n_kmers = j;
+  crpx_free (cglob, hash); hash = NULL;
+  crpx_free (cglob, start); start = NULL;
+
+  ks->remainder = (uint64_t *) crpx_calloc (cglob, (ks->n_kmers * ks->remainder_bits) / 64 + 2, sizeof (uint64_t));
+  if (!ks->remainder) goto new_kmer_store_error;
+  mask = (ks->remainder_bits < 64) ? (1ULL << ks->remainder_bits) - 1 : UINT64_MAX;
+  for (i = 0; i < ks->n_kmers; i++) ks_set_remainder (ks, i, sorted[i] & mask);
+  crpx_free (cglob, sorted);
+  crpx_logger_verbose (cglob, "k-mer store with %lu k-mers in %lu buckets, using %.2lf bits per k-mer", ks->n_kmers, n_buckets,
+                       ks->n_kmers ? 8. * (double) crpx_kmer_store_size_in_bytes (ks) / (double) ks->n_kmers : 0.);
+  return ks;
+
+new_kmer_store_error:
+  if (hash)   crpx_free (cglob, hash);
+  if (sorted) crpx_free (cglob, sorted);
+  if (start)  crpx_free (cglob, start);
+  del_crpx_kmer_store (ks);
+  return NULL;
+}
+
+void
+del_crpx_kmer_store (crpx_kmer_store_t ks)
+{
+  if (!ks) return;
+  if (ks->remainder) crpx_free (ks->cglob, ks->remainder);
+  if (ks->offset)    crpx_free (ks->cglob, ks->offset);
+  crpx_global_finalise (ks->cglob); // it just decreases cglob->ref_counter
+  free (ks);
+}
+
+uint64_t
+crpx_kmer_store_rank (crpx_kmer_store_t ks, uint64_t kmer)
+{
+  uint64_t hash = crpx_kmer_invertible_hash (kmer & crpx_kmer_mask (ks->k), ks->k), b = ks_bucket (ks, hash), i, x;
+  uint64_t r = (ks->remainder_bits < 64) ? hash & ((1ULL << ks->remainder_bits) - 1) : hash;
+  for (i = ks->offset[b]; i < ks->offset[b+1]; i++) {
+    if ((x = ks_get_remainder (ks, i)) >= r) return (x == r) ? i : CRPX_KMER_STORE_NOT_FOUND;
+  }
+  return CRPX_KMER_STORE_NOT_FOUND;
+}
+
+void
+crpx_kmer_store_rank_array (crpx_kmer_store_t ks, const uint64_t *kmers, size_t n, uint64_t *rank)
+{
+  int64_t i;
+#pragma omp parallel for schedule(static) if (n > 4096)
+  for (i = 0; i < (int64_t) n; i++) rank[i] = crpx_kmer_store_rank (ks, kmers[i]);
+}
+
+uint64_t
+crpx_kmer_store_kmer (crpx_kmer_store_t ks, uint64_t rank)
+{ // binary search for the last bucket starting at or before rank (empty buckets share their offset with the next)
+  uint64_t lo = 0, hi = 1ULL << ks->bucket_bits, mid, hash;
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+    if (ks->offset[mid] <= rank) lo = mid;
+    else hi = mid;
+  }
+  hash = ks_get_remainder (ks, rank);
+  if (ks->remainder_bits < 64) hash |= lo << ks->remainder_bits;
+  return crpx_kmer_invertible_hash_inverse (hash, ks->k);
+}
+
+void
+crpx_kmer_store_decode (crpx_kmer_store_t ks, uint64_t *kmers)
+{ // buckets are visited in order, and then all k-mers are inverted at once
+  uint64_t b, i, n_buckets = 1ULL << ks->bucket_bits;
+  for (b = 0; b < n_buckets; b++) for (i = ks->offset[b]; i < ks->offset[b+1]; i++) {
+    kmers[i] = ks_get_remainder (ks, i);
+    if (ks->remainder_bits < 64) kmers[i] |= b << ks->remainder_bits;
+  }
+  crpx_kmer_invertible_hash_inverse_array (kmers, ks->n_kmers, ks->k, kmers);
+}
+
+size_t
+crpx_kmer_store_size_in_bytes (crpx_kmer_store_t ks)
+{
+  return sizeof (crpx_kmer_store_struct) + ((1ULL << ks->bucket_bits) + 1) * sizeof (uint64_t) +
+         ((ks->n_kmers * ks->remainder_bits) / 64 + 2) * sizeof (uint64_t);
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  if (*(const uint64_t *) a > *(const uint64_t *) b) return 1;
+  if (*(const uint64_t *) a < *(const uint64_t *) b) return -1;
+  return 0;
+}
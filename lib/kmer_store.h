@@ -0,0 +1,56 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file kmer_store.h
+ *  \brief static set of k-mers which stores only part of each k-mer (quotienting, as in Pandey et al. 2017). K-mers are
+ *  mapped by the bijection crpx_kmer_invertible_hash(), whose high bucket_bits select a bucket and whose low bits are
+ *  the only ones stored, bit-packed and sorted within buckets. The k-mer is recovered by inverting the hash, and each
+ *  k-mer has a rank (its position in the store), which can index arrays of values. */
+
+#ifndef _curupixa_kmer_store_h_
+#define _curupixa_kmer_store_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "kmer_encoding.h"
+
+#define CRPX_KMER_STORE_NOT_FOUND UINT64_MAX
+
+typedef struct {
+  uint64_t *remainder;   /*!< \brief bit-packed low remainder_bits of hashed k-mers, increasing within each bucket */
+  uint64_t *offset;      /*!< \brief 2^bucket_bits + 1 ranks: bucket b has ranks offset[b] ... offset[b+1]-1 */
+  uint64_t n_kmers;
+  uint8_t k, bucket_bits, remainder_bits; /*!< \brief bucket_bits + remainder_bits = 2k */
+  crpx_global_t cglob;
+} crpx_kmer_store_struct, *crpx_kmer_store_t;
+
+/*! \brief new store with the distinct k-mers among the n in kmers[] (k up to 32). bucket_bits=0 chooses around 16
+ *  k-mers per bucket, s.t. each k-mer uses 2k - log2(n) + 8 bits; at most 32 bucket bits. Returns NULL in case of error */
+crpx_kmer_store_t new_crpx_kmer_store (crpx_global_t cglob, uint8_t k, const uint64_t *kmers, size_t n, uint8_t bucket_bits);
+void del_crpx_kmer_store (crpx_kmer_store_t ks);
+/*! \brief rank of kmer (from 0 to n_kmers-1), or CRPX_KMER_STORE_NOT_FOUND if absent */
+uint64_t crpx_kmer_store_rank (crpx_kmer_store_t ks, uint64_t kmer);
+/*! \brief ranks of n k-mers, in parallel for large n */
+void crpx_kmer_store_rank_array (crpx_kmer_store_t ks, const uint64_t *kmers, size_t n, uint64_t *rank);
+/*! \brief k-mer of given rank (must be smaller than n_kmers) */
+uint64_t crpx_kmer_store_kmer (crpx_kmer_store_t ks, uint64_t rank);
+/*! \brief all n_kmers k-mers, in order of rank */
+void crpx_kmer_store_decode (crpx_kmer_store_t ks, uint64_t *kmers);
+size_t crpx_kmer_store_size_in_bytes (crpx_kmer_store_t ks);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,293 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file lsh_index.c
+ *  \brief banded LSH index: one bucket table per band, where the high bits of the band hash select the bucket and its
+ *  low 32 bits are kept as a fingerprint, to skip most items that only share the bucket by chance. */
+
+#include "lsh_index.h"
+
+#define LSH_ITEMS_PER_BUCKET 2
+
+typedef struct {
+  uint32_t *x;
+  size_t n, n_alloc;
+} lsh_candidates_struct;
+
+typedef struct {
+  crpx_lsh_pair_t pair;
+  size_t n, n_alloc;
+} lsh_pairs_struct;
+
+static int compare_uint32_increasing (const void *a, const void *b);
+static int compare_lsh_pair_increasing (const void *a, const void *b);
+
+uint16_t
+crpx_lsh_rows_for_threshold (uint16_t n_hashes, double threshold)
+{
+  uint16_t rows, best = 1;
+  double t, best_diff = HUGE_VAL;
+  for (rows = 1; rows <= n_hashes; rows++) {
+    t = pow (1. / (double) (n_hashes / rows), 1. / (double) rows);
+    if (fabs (t - threshold) < best_diff) { best_diff = fabs (t - threshold); best = rows; }
+  }
+  return best;
+}
+
+double
+crpx_lsh_collision_probability (double jaccard, uint16_t n_bands, uint16_t rows)
+{
+  return 1. - pow (1. - pow (jaccard, (double) rows), (double) n_bands);
+}
+
+static inline uint64_t
+lsh_band_hash (crpx_lsh_index_t lsh, const uint32_t *signature, uint16_t band)
+{
+  return crpx_wyhash64_seed64 (signature + (size_t) band * lsh->rows, lsh->rows * sizeof (uint32_t), lsh->seed + band);
+}
+
+static inline uint32_t
+lsh_bucket (crpx_lsh_index_t lsh, uint64_t hash)
+{
+  return (uint32_t) (hash >> (64 - lsh->bucket_bits));
+}
+
+crpx_lsh_index_t
+new_crpx_lsh_index (crpx_global_t cglob, const uint32_t *signature, uint32_t n_items, uint16_t n_hashes, uint16_t rows, uint64_t seed)
+{
+  uint64_t *hash = NULL, n_buckets;
+  int64_t i, band;
+  if (!n_items || !n_hashes) { crpx_logger_error (cglob, "new_crpx_lsh_index: number of items and of hashes must be positive"); return NULL; }
+  if (!rows || (rows > n_hashes)) { crpx_logger_error (cglob, "new_crpx_lsh_index: rows per band (%u) must be between 1 and %u", rows, n_hashes); return NULL; }
+  crpx_lsh_index_t lsh = (crpx_lsh_index_t) crpx_malloc (cglob, sizeof (crpx_lsh_index_struct));
+  if (!lsh) return NULL;
+  lsh->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, lsh->cglob); // thread-safe increase of ref_counter
+  lsh->n_items = n_items;
+  lsh->n_hashes = n_hashes;
+  lsh->rows = rows;
+  lsh->n_bands = n_hashes / rows;
+  lsh->seed = crpx_hashint_splitmix64 (seed);
+  for (lsh->bucket_bits = 1; (lsh->bucket_bits < 31) && (((uint64_t) LSH_ITEMS_PER_BUCKET << lsh->bucket_bits) < n_items); lsh->bucket_bits++);
+  n_buckets = 1ULL << lsh->bucket_bits;
+  lsh->signature = (uint32_t *) crpx_malloc (cglob, (size_t) n_items * n_hashes * sizeof (uint32_t));
+  lsh->entry = (uint64_t *) crpx_malloc (cglob, (size_t) n_items * lsh->n_bands * sizeof (uint64_t));
+  lsh->offset = (uint32_t *) crpx_calloc (cglob, (n_buckets + 1) * lsh->n_bands, sizeof (uint32_t));
+  hash = (uint64_t *) crpx_malloc (cglob, (size_t) n_items * lsh->n_bands * sizeof (uint64_t));
+  if (!lsh->signature || !lsh->entry || !lsh->offset || !hash) {
+    if (hash) crpx_free (cglob, hash);
+    del_crpx_lsh_index (lsh);
+    return NULL;
+  }
+  memcpy (lsh->signature, signature, (size_t) n_items * n_hashes * sizeof (uint32_t));
+
+#pragma omp parallel for schedule(static) if (n_items > 1024)
+  for (i = 0; i < (int64_t) n_items; i++) for (uint16_t j = 0; j < lsh->n_bands; j++)
+    hash[(size_t) j * n_items + i] = lsh_band_hash (lsh, signature + (size_t) i * n_hashes, j);
+
+#pragma omp parallel for private(i) schedule(dynamic, 1)
+  for (band = 0; band < (int64_t) lsh->n_bands; band++) { // counting sort by bucket; items in increasing order within buckets
+    uint64_t *h = hash + (size_t) band * n_items, *e = lsh->entry + (size_t) band * n_items, b;
+    uint32_t *off = lsh->offset + band * (n_buckets + 1);
+    for (i = 0; i < (int64_t) n_items; i++) off[lsh_bucket (lsh, h[i]) + 1]++;
+    for (b = 0; b < n_buckets; b++) off[b+1] += off[b];
+    for (i = 0; i < (int64_t) n_items; i++) e[ off[lsh_bucket (lsh, h[i])]++ ] = (h[i] << 32) | (uint64_t) i;
+    for (b = n_buckets; b > 0; b--) off[b] = off[b-1]; // each off[b] was moved to the start of bucket b+1
+    off[0] = 0;
+  }
+  crpx_free (cglob, hash);
+  crpx_logger_verbose (cglob, "LSH index of %u items with %u bands of %u rows in %lu bytes (%.1lf bytes per item)", n_items,
+                       lsh->n_bands, rows, crpx_lsh_index_size_in_bytes (lsh), (double) crpx_lsh_index_size_in_bytes (lsh) / (double) n_items);
+  return lsh;
+}
+
+void
+del_crpx_lsh_index (crpx_lsh_index_t lsh)
+{
+  if (!lsh) return;
+  if (lsh->signature) crpx_free (lsh->cglob, lsh->signature);
+  if (lsh->entry) crpx_free (lsh->cglob, lsh->entry);
+  if (lsh->offset) crpx_free (lsh->cglob, lsh->offset);
+  crpx_global_finalise (lsh->cglob); // it just decreases cglob->ref_counter
+  free (lsh);
+}
+
+size_t
+crpx_lsh_index_size_in_bytes (crpx_lsh_index_t lsh)
+{
+  return sizeof (crpx_lsh_index_struct) + (size_t) lsh->n_items * lsh->n_hashes * sizeof (uint32_t) +
+         (size_t) lsh->n_items * lsh->n_bands * sizeof (uint64_t) + ((1ULL << lsh->bucket_bits) + 1) * lsh->n_bands * sizeof (uint32_t);
+}
+
+double
+crpx_lsh_index_similarity (crpx_lsh_index_t lsh, const uint32_t *sig_a, const uint32_t *sig_b)
+{
+  uint32_t i = 0, matches = 0;
+#ifdef __AVX2__
+  if (lsh->cglob->avx) for (; i + 8 <= lsh->n_hashes; i += 8) {
+    __m256i eq = _mm256_cmpeq_epi32 (_mm256_loadu_si256 ((const __m256i *) (sig_a + i)), _mm256_loadu_si256 ((const __m256i *) (sig_b + i)));
+    matches += (uint32_t) __builtin_popcount (_mm256_movemask_ps (_mm256_castsi256_ps (eq)));
+  }
+#endif
+  for (; i < lsh->n_hashes; i++) matches += (sig_a[i] == sig_b[i]);
+  return (double) matches / (double) lsh->n_hashes;
+}
+
+static bool
+lsh_find_candidates (crpx_lsh_index_t lsh, const uint32_t *signature, lsh_candidates_struct *cand)
+{ // distinct items sharing a bucket and fingerprint with signature in any band, in increasing order
+  uint64_t n_buckets = 1ULL << lsh->bucket_bits, h;
+  uint32_t *off, b, j;
+  size_t i, n;
+  cand->n = 0;
+  for (uint16_t band = 0; band < lsh->n_bands; band++) {
+    h = lsh_band_hash (lsh, signature, band);
+    b = lsh_bucket (lsh, h);
+    off = lsh->offset + band * (n_buckets + 1);
+    if (cand->n + (off[b+1] - off[b]) > cand->n_alloc) { // on failure old buffer is kept, and freed by the caller
+      size_t n_alloc = 2 * (cand->n + (off[b+1] - off[b]));
+      uint32_t *x = (uint32_t *) crpx_realloc (lsh->cglob, cand->x, n_alloc * sizeof (uint32_t));
+      if (!x) return false;
+      cand->x = x;
+      cand->n_alloc = n_alloc;
+    }
+    for (j = off[b]; j < off[b+1]; j++) if ((uint32_t) (lsh->entry[(size_t) band * lsh->n_items + j] >> 32) == (uint32_t) h)
+      cand->x[cand->n++] = (uint32_t) lsh->entry[(size_t) band * lsh->n_items + j];
+  }
+  if (cand->n > 1) qsort (cand->x, cand->n, sizeof (uint32_t), compare_uint32_increasing);
+  for (n = i = 0; i < cand->n; i++) if ((i == 0) || (cand->x[i] != cand->x[i-1])) cand->x[n++] = cand->x[i];
+  cand->n = n;
+  return true;
+}
+
+static bool
+lsh_query_to_pairs (crpx_lsh_index_t lsh, const uint32_t *signature, uint32_t query, bool self, double threshold,
+                    lsh_candidates_struct *cand, lsh_pairs_struct *pairs)
+{ // appends similar items to pairs; if self, query is an indexed item and only larger items are kept
+  double jaccard;
+  size_t i;
+  if (!lsh_find_candidates (lsh, signature, cand)) return false;
+  for (i = 0; i < cand->n; i++) {
+    if (self && (cand->x[i] <= query)) continue;
+    jaccard = crpx_lsh_index_similarity (lsh, signature, lsh->signature + (size_t) cand->x[i] * lsh->n_hashes);
+    if (jaccard < threshold) continue;
+    if (pairs->n == pairs->n_alloc) {
+      size_t n_alloc = 2 * pairs->n_alloc + 16;
+      crpx_lsh_pair_t pair = (crpx_lsh_pair_t) crpx_realloc (lsh->cglob, pairs->pair, n_alloc * sizeof (crpx_lsh_pair_struct));
+      if (!pair) return false;
+      pairs->pair = pair;
+      pairs->n_alloc = n_alloc;
+    }
+    pairs->pair[pairs->n].query = query;
+    pairs->pair[pairs->n].item = cand->x[i];
+    pairs->pair[pairs->n++].jaccard = (float) jaccard;
+  }
+  return true;
+}
+
+size_t
+crpx_lsh_index_query (crpx_lsh_index_t lsh, const uint32_t *signature, double threshold, uint32_t *item, float *jaccard, size_t max_items)
+{
+  lsh_candidates_struct cand = {NULL, 0, 0};
+  lsh_pairs_struct pairs = {NULL, 0, 0};
+  size_t i, n = SIZE_MAX;
+  if (!lsh_query_to_pairs (lsh, signature, 0, false, threshold, &cand, &pairs)) {
+    crpx_logger_error (lsh->cglob, "crpx_lsh_index_query: could not allocate memory for candidates");
+    goto lsh_index_query_end;
+  }
+  for (i = 0; (i < pairs.n) && (i < max_items); i++) {
+    if (item) item[i] = pairs.pair[i].item;
+    if (jaccard) jaccard[i] = pairs.pair[i].jaccard;
+  }
+  n = pairs.n;
+
+lsh_index_query_end:
+  if (cand.x) crpx_free (lsh->cglob, cand.x);
+  if (pairs.pair) crpx_free (lsh->cglob, pairs.pair);
+  return n;
+}
+
+static crpx_lsh_pair_t
+lsh_search (crpx_lsh_index_t lsh, const uint32_t *query, uint32_t n_queries, bool self, double threshold, size_t *n_pairs)
+{ // each thread collects its own pairs, which are sorted at the end s.t. the result does not depend on the number of threads
+  lsh_pairs_struct result = {NULL, 0, 0};
+  bool success = true;
+  int64_t i;
+
+#pragma omp parallel shared(lsh, query, n_queries, self, threshold, result, success) private(i)
+  {
+    lsh_candidates_struct cand = {NULL, 0, 0};
+    lsh_pairs_struct local = {NULL, 0, 0};
+    bool local_success = true;
+    #pragma omp for schedule(dynamic, 64)
+    for (i = 0; i < (int64_t) n_queries; i++) if (local_success)
+      local_success = lsh_query_to_pairs (lsh, query + (size_t) i * lsh->n_hashes, (uint32_t) i, self, threshold, &cand, &local);
+    #pragma omp critical (crpx_lsh_index_search)
+    {
+      if (!local_success) success = false;
+      if (success && local.n) {
+        crpx_lsh_pair_t pair = (crpx_lsh_pair_t) crpx_realloc (lsh->cglob, result.pair, (result.n + local.n) * sizeof (crpx_lsh_pair_struct));
+        if (pair) {
+          result.pair = pair;
+          memcpy (result.pair + result.n, local.pair, local.n * sizeof (crpx_lsh_pair_struct));
+          result.n += local.n;
+        }
+        else success = false;
+      }
+    }
+    if (cand.x) crpx_free (lsh->cglob, cand.x);
+    if (local.pair) crpx_free (lsh->cglob, local.pair);
+  } // omp parallel
+
+  if (!success) {
+    crpx_logger_error (lsh->cglob, "crpx_lsh_index_search: could not allocate memory for candidate pairs");
+    if (result.pair) crpx_free (lsh->cglob, result.pair);
+    *n_pairs = 0;
+    return NULL;
+  }
+  if (result.n > 1) qsort (result.pair, result.n, sizeof (crpx_lsh_pair_struct), compare_lsh_pair_increasing);
+  *n_pairs = result.n;
+  return result.pair;
+}
+
+crpx_lsh_pair_t
+crpx_lsh_index_search (crpx_lsh_index_t lsh, const uint32_t *query, uint32_t n_queries, double threshold, size_t *n_pairs)
+{
+  return lsh_search (lsh, query, n_queries, false, threshold, n_pairs);
+}
+
+crpx_lsh_pair_t
+crpx_lsh_index_all_pairs (crpx_lsh_index_t lsh, double threshold, size_t *n_pairs)
+{
+  return lsh_search (lsh, lsh->signature, lsh->n_items, true, threshold, n_pairs);
+}
+
+static int
+compare_uint32_increasing (const void *a, const void *b)
+{
+  if (*(const uint32_t *) a > *(const uint32_t *) b) return 1;
+  if (*(const uint32_t *) a < *(const uint32_t *) b) return -1;
+  return 0;
+}
+
+static int
+compare_lsh_pair_increasing (const void *a, const void *b)
+{
+  const crpx_lsh_pair_struct *x = (const crpx_lsh_pair_struct *) a, *y = (const crpx_lsh_pair_struct *) b;
+  if (x->query > y->query) return 1;
+  if (x->query < y->query) return -1;
+  if (x->item > y->item) return 1;
+  if (x->item < y->item) return -1;
+  return 0;
+}
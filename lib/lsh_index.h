@@ -0,0 +1,73 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file lsh_index.h
+ *  \brief locality-sensitive hashing (LSH) index of MinHash signatures, for near-duplicate search among many sequences
+ *  or sketches without all-vs-all comparisons (Indyk and Motwani 1998; Broder 1997). The first n_bands x rows values of
+ *  each signature are split into bands of rows values; each band is hashed into a bucket table, and two items are
+ *  candidates if they share the bucket of at least one band, which happens with probability 1 - (1 - J^rows)^n_bands
+ *  for Jaccard similarity J. Candidates are then filtered by their similarity estimated from all signature values.
+ *  Signatures can come e.g. from crpx_hash_family_minhash(). The index is static, built once from all signatures. */
+
+#ifndef _curupixa_lsh_index_h_
+#define _curupixa_lsh_index_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint32_t *signature;   /*!< \brief n_items x n_hashes minhash values, to estimate the similarity of candidates */
+  uint64_t *entry;       /*!< \brief n_bands x n_items entries (band hash fingerprint << 32 | item), by bucket and item */
+  uint32_t *offset;      /*!< \brief n_bands x (2^bucket_bits + 1): bucket b of a band has entries offset[b]...offset[b+1]-1 */
+  uint32_t n_items;
+  uint16_t n_hashes, n_bands, rows; /*!< \brief hashes beyond n_bands x rows are only used to estimate similarity */
+  uint8_t bucket_bits;
+  uint64_t seed;
+  crpx_global_t cglob;
+} crpx_lsh_index_struct, *crpx_lsh_index_t;
+
+typedef struct {
+  uint32_t query, item;  /*!< \brief index of query (or of first item, for all pairs) and of similar item */
+  float jaccard;         /*!< \brief estimated Jaccard similarity (fraction of equal signature values) */
+} crpx_lsh_pair_struct, *crpx_lsh_pair_t;
+
+/*! \brief number of rows per band s.t. the LSH threshold (1/n_bands)^(1/rows), where the probability of becoming a
+ *  candidate rises most steeply, is closest to the Jaccard threshold */
+uint16_t crpx_lsh_rows_for_threshold (uint16_t n_hashes, double threshold);
+/*! \brief probability that two items with given Jaccard similarity share at least one band */
+double crpx_lsh_collision_probability (double jaccard, uint16_t n_bands, uint16_t rows);
+
+/*! \brief new index of n_items signatures with n_hashes values each (signature[i * n_hashes + j]), which are copied.
+ *  Bands are hashed in parallel. Returns NULL in case of error */
+crpx_lsh_index_t new_crpx_lsh_index (crpx_global_t cglob, const uint32_t *signature, uint32_t n_items, uint16_t n_hashes, uint16_t rows, uint64_t seed);
+void del_crpx_lsh_index (crpx_lsh_index_t lsh);
+/*! \brief estimated Jaccard similarity between two signatures with n_hashes values each (fraction of equal values) */
+double crpx_lsh_index_similarity (crpx_lsh_index_t lsh, const uint32_t *sig_a, const uint32_t *sig_b);
+/*! \brief items similar to one signature (at least threshold), in increasing order; at most max_items are stored in
+ *  item[] and jaccard[] (which can be NULL), but the total number found is returned (SIZE_MAX if memory failed) */
+size_t crpx_lsh_index_query (crpx_lsh_index_t lsh, const uint32_t *signature, double threshold, uint32_t *item, float *jaccard, size_t max_items);
+/*! \brief pairs (query, item) with similarity at least threshold for n_queries signatures, in parallel. Returns an
+ *  array of n_pairs pairs ordered by query and item, which must be freed with free() */
+crpx_lsh_pair_t crpx_lsh_index_search (crpx_lsh_index_t lsh, const uint32_t *query, uint32_t n_queries, double threshold, size_t *n_pairs);
+/*! \brief all pairs of indexed items with similarity at least threshold (query < item), in parallel. Returns an array
+ *  of n_pairs pairs which must be freed with free() */
+crpx_lsh_pair_t crpx_lsh_index_all_pairs (crpx_lsh_index_t lsh, double threshold, size_t *n_pairs);
+size_t crpx_lsh_index_size_in_bytes (crpx_lsh_index_t lsh);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
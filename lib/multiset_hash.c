@@ -0,0 +1,142 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file multiset_hash.c
+ *  \brief commutative multiset hash: additions and subtractions of 128 bits values, with carry between words. */
+
+#include "multiset_hash.h"
+
+#define MULTISET_PARALLEL_MIN 65536 /* arrays smaller than this are added by a single thread */
+
+static inline void
+multiset_add128 (uint64_t *sum, uint64_t lo, uint64_t hi)
+{
+  sum[0] += lo;
+  sum[1] += hi + (sum[0] < lo); // carry
+}
+
+static inline void
+multiset_sub128 (uint64_t *sum, uint64_t lo, uint64_t hi)
+{
+  uint64_t borrow = (sum[0] < lo);
+  sum[0] -= lo;
+  sum[1] -= hi + borrow;
+}
+
+void
+crpx_multiset_hash_init (crpx_multiset_hash_t mh, uint64_t seed)
+{
+  mh->sum[0] = mh->sum[1] = 0;
+  mh->seed[0] = crpx_hashint_splitmix64 (seed);
+  mh->seed[1] = crpx_hashint_splitmix64 (mh->seed[0]);
+  mh->n_elements = 0;
+}
+
+inline void
+crpx_multiset_hash_add_uint64 (crpx_multiset_hash_t mh, uint64_t x)
+{ // two distinct bijective mixers, s.t. distinct elements never have the same 128 bits value
+  multiset_add128 (mh->sum, crpx_hashint_nasam64 (x ^ mh->seed[0]), crpx_hashint_moremur64 (x ^ mh->seed[1]));
+  mh->n_elements++;
+}
+
+inline void
+crpx_multiset_hash_remove_uint64 (crpx_multiset_hash_t mh, uint64_t x)
+{
+  multiset_sub128 (mh->sum, crpx_hashint_nasam64 (x ^ mh->seed[0]), crpx_hashint_moremur64 (x ^ mh->seed[1]));
+  mh->n_elements--;
+}
+
+void
+crpx_multiset_hash_add_uint64_array (crpx_multiset_hash_t mh, const uint64_t *x, size_t n)
+{ // partial sums of each thread are added at the end; since addition is commutative, result is the same as serial
+  int64_t i;
+  if (n < MULTISET_PARALLEL_MIN) {
+    for (i = 0; i < (int64_t) n; i++) crpx_multiset_hash_add_uint64 (mh, x[i]);
+    return;
+  }
+#pragma omp parallel shared(mh, x, n) private(i)
+  {
+    crpx_multiset_hash_struct local = *mh;
+    local.sum[0] = local.sum[1] = 0;
+    local.n_elements = 0;
+    #pragma omp for schedule(static)
+    for (i = 0; i < (int64_t) n; i++) crpx_multiset_hash_add_uint64 (&local, x[i]);
+    #pragma omp critical (crpx_multiset_hash_combine)
+    crpx_multiset_hash_combine (mh, &local);
+  } // omp parallel
+}
+
+void
+crpx_multiset_hash_init_from_uint64_array (crpx_multiset_hash_t mh, uint64_t seed, const uint64_t *x, size_t n)
+{
+  crpx_multiset_hash_init (mh, seed);
+  crpx_multiset_hash_add_uint64_array (mh, x, n);
+}
+
+void
+crpx_multiset_hash_add_bytes (crpx_multiset_hash_t mh, const void *key, size_t len)
+{
+  uint64_t h[2];
+  crpx_murmurhash3_128bits (key, len, (uint32_t) mh->seed[0], h);
+  multiset_add128 (mh->sum, h[0] ^ mh->seed[0], h[1] ^ mh->seed[1]);
+  mh->n_elements++;
+}
+
+void
+crpx_multiset_hash_remove_bytes (crpx_multiset_hash_t mh, const void *key, size_t len)
+{
+  uint64_t h[2];
+  crpx_murmurhash3_128bits (key, len, (uint32_t) mh->seed[0], h);
+  multiset_sub128 (mh->sum, h[0] ^ mh->seed[0], h[1] ^ mh->seed[1]);
+  mh->n_elements--;
+}
+
+bool
+crpx_multiset_hash_combine (crpx_multiset_hash_t dst, const crpx_multiset_hash_t src)
+{
+  if ((dst->seed[0] != src->seed[0]) || (dst->seed[1] != src->seed[1])) return false;
+  multiset_add128 (dst->sum, src->sum[0], src->sum[1]);
+  dst->n_elements += src->n_elements;
+  return true;
+}
+
+bool
+crpx_multiset_hash_subtract (crpx_multiset_hash_t dst, const crpx_multiset_hash_t src)
+{
+  if ((dst->seed[0] != src->seed[0]) || (dst->seed[1] != src->seed[1])) return false;
+  multiset_sub128 (dst->sum, src->sum[0], src->sum[1]);
+  dst->n_elements -= src->n_elements;
+  return true;
+}
+
+inline bool
+crpx_multiset_hash_equal (const crpx_multiset_hash_t a, const crpx_multiset_hash_t b)
+{
+  return (a->sum[0] == b->sum[0]) && (a->sum[1] == b->sum[1]) && (a->n_elements == b->n_elements) &&
+         (a->seed[0] == b->seed[0]) && (a->seed[1] == b->seed[1]);
+}
+
+uint64_t
+crpx_multiset_hash_64bits (const crpx_multiset_hash_t mh)
+{ // sums are not uniform for small multisets (e.g. empty set is zero), thus they are mixed with the size
+  return crpx_wyhash64_mixer (mh->sum[0] ^ mh->seed[1], mh->sum[1] ^ crpx_hashint_splitmix64 ((uint64_t) mh->n_elements));
+}
+
+void
+crpx_multiset_hash_128bits (const crpx_multiset_hash_t mh, uint64_t *out)
+{ // each output word is a bijection of one sum word, given the other word and the size
+  uint64_t n = crpx_hashint_splitmix64 ((uint64_t) mh->n_elements ^ mh->seed[0]);
+  out[0] = crpx_hashint_moremur64 (mh->sum[0] ^ n);
+  out[1] = crpx_hashint_nasam64 (mh->sum[1] ^ out[0]);
+}
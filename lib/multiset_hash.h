@@ -0,0 +1,60 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file multiset_hash.h
+ *  \brief order-independent (commutative) hash of sets and multisets, e.g. of taxa, splits or site patterns, which is
+ *  updated in O(1) when elements are added or removed. Each element is mapped to 128 bits by strong 64 bits mixers
+ *  (or by MurmurHash3 for byte strings), and the multiset hash is their sum modulo 2^128 (the AdHash of Bellare and
+ *  Micciancio 1997, which is not collision-resistant against adversaries but has collision probability about 2^-128
+ *  for unrelated multisets). Hashes are plain structures, which can be stored in arrays or copied. */
+
+#ifndef _curupixa_multiset_hash_h_
+#define _curupixa_multiset_hash_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint64_t sum[2];       /*!< \brief sum of mixed elements modulo 2^128 (low and high words) */
+  uint64_t seed[2];      /*!< \brief seeds of both mixers; multisets can only be compared or combined if same seed */
+  int64_t n_elements;    /*!< \brief number of elements, with repetitions (sets must not add an element twice) */
+} crpx_multiset_hash_struct, *crpx_multiset_hash_t;
+
+/*! \brief empty multiset; same seed must be used by all multisets that will be compared */
+void crpx_multiset_hash_init (crpx_multiset_hash_t mh, uint64_t seed);
+/*! \brief multiset from n integers (in parallel for large n; result does not depend on the number of threads) */
+void crpx_multiset_hash_init_from_uint64_array (crpx_multiset_hash_t mh, uint64_t seed, const uint64_t *x, size_t n);
+extern void crpx_multiset_hash_add_uint64 (crpx_multiset_hash_t mh, uint64_t x);
+/*! \brief removes one copy of x, which should have been added before */
+extern void crpx_multiset_hash_remove_uint64 (crpx_multiset_hash_t mh, uint64_t x);
+void crpx_multiset_hash_add_uint64_array (crpx_multiset_hash_t mh, const uint64_t *x, size_t n);
+void crpx_multiset_hash_add_bytes (crpx_multiset_hash_t mh, const void *key, size_t len);
+void crpx_multiset_hash_remove_bytes (crpx_multiset_hash_t mh, const void *key, size_t len);
+/*! \brief dst = dst + src (multiset union with repetitions); returns false if seeds differ */
+bool crpx_multiset_hash_combine (crpx_multiset_hash_t dst, const crpx_multiset_hash_t src);
+/*! \brief dst = dst - src, where src should be a sub-multiset of dst; returns false if seeds differ */
+bool crpx_multiset_hash_subtract (crpx_multiset_hash_t dst, const crpx_multiset_hash_t src);
+/*! \brief true if both multisets have the same hash (and seed) */
+extern bool crpx_multiset_hash_equal (const crpx_multiset_hash_t a, const crpx_multiset_hash_t b);
+/*! \brief 64 bits digest of the multiset */
+uint64_t crpx_multiset_hash_64bits (const crpx_multiset_hash_t mh);
+/*! \brief 128 bits digest of the multiset, stored in out[2] */
+void crpx_multiset_hash_128bits (const crpx_multiset_hash_t mh, uint64_t *out);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,331 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file perfect_hash.c
+ *  \brief BBHash minimal perfect hash. Level hashes are crpx_hashint_moremur64() of the key xor a level seed, reduced
+ *  to the level size by Lemire's multiply-shift. Keys left for the next level are compacted in fixed chunks, s.t.
+ *  their order does not depend on the number of threads. */
+
+#include "perfect_hash.h"
+
+#define PH_CHUNK (1UL << 16)   /* keys per chunk when compacting keys left for next level */
+#define PH_BATCH 32
+#define PH_HEADER_SIZE 512     /* in bytes: 6 values followed by level_start[] */
+#define PH_MAGIC 0x3148504d58505243ULL /* "CRPXMPH1" in little endian */
+
+static bool perfect_hash_build (crpx_perfect_hash_t ph, const uint64_t *keys, size_t n, double gamma);
+static int compare_uint64_increasing (const void *a, const void *b);
+
+static size_t
+perfect_hash_unique (uint64_t *x, size_t n)
+{ // sorts x and removes repetitions, returning the number of distinct keys
+  size_t i, j;
+  if (n < 2) return n;
+  qsort (x, n, sizeof (uint64_t), compare_uint64_increasing);
+  for (i = j = 1; i < n; i++) if (x[i] != x[j - 1]) x[j++] = x[i];
+  return j;
+}
+
+static inline uint64_t
+perfect_hash_position (crpx_perfect_hash_t ph, uint64_t key, uint8_t level)
+{ // bit position (from start of bits[]) of key at level
+  uint64_t h = crpx_hashint_moremur64 (key ^ crpx_hashint_splitmix64 (ph->seed + level));
+  uint64_t n_bits = (ph->level_start[level + 1] - ph->level_start[level]) << 6;
+  return (ph->level_start[level] << 6) + (uint64_t) (((__uint128_t) h * n_bits) >> 64);
+}
+
+static inline uint64_t
+perfect_hash_rank (crpx_perfect_hash_t ph, uint64_t pos)
+{ // set bits before pos; all words read are in the same 64 bytes block
+  uint64_t w = pos >> 6, r = ph->rank[w >> 3], i;
+  for (i = w & ~7ULL; i < w; i++) r += __builtin_popcountll (ph->bits[i]);
+  return r + __builtin_popcountll (ph->bits[w] & ((1ULL << (pos & 63)) - 1));
+}
+
+crpx_perfect_hash_t
+new_crpx_perfect_hash (crpx_global_t cglob, const uint64_t *keys, size_t n, double gamma, uint64_t seed)
+{
+  if (gamma == 0.) gamma = 2.;
+  if ((gamma < 1.) || (gamma > 100.)) {
+    crpx_logger_error (cglob, "new_crpx_perfect_hash: gamma must be between 1 and 100, not %g", gamma);
+    return NULL;
+  }
+  crpx_perfect_hash_t ph = (crpx_perfect_hash_t) crpx_malloc (cglob, sizeof (crpx_perfect_hash_struct));
+  if (!ph) return NULL;
+  ph->bits = ph->rank = ph->fallback = NULL;
+  ph->mmap_ptr = NULL;
+  ph->mmap_size = 0;
+  ph->seed = seed;
+  ph->n_keys = ph->n_fallback = 0;
+  ph->n_levels = 0;
+  memset (ph->level_start, 0, sizeof (ph->level_start));
+  ph->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, ph->cglob); // thread-safe increase of ref_counter
+  if (!perfect_hash_build (ph, keys, n, gamma)) {
+    crpx_logger_error (cglob, "new_crpx_perfect_hash: could not build minimal perfect hash for %lu keys", n);
+    del_crpx_perfect_hash (ph);
+    return NULL;
+  }
+  crpx_logger_verbose (cglob, "Minimal perfect hash with %lu distinct keys in %lu bytes (%u levels, %lu keys in fallback)",
+                       ph->n_keys, crpx_perfect_hash_size_in_bytes (ph), ph->n_levels, ph->n_fallback);
+  return ph;
+}
+
+void
+del_crpx_perfect_hash (crpx_perfect_hash_t ph)
+{
+  if (!ph) return;
+  if (ph->mmap_ptr) {
+#ifndef CRPX_OS_WINDOWS
+    munmap (ph->mmap_ptr, ph->mmap_size);
+#endif
+  }
+  else {
+    if (ph->bits) crpx_free (ph->cglob, ph->bits);
+    if (ph->rank) crpx_free (ph->cglob, ph->rank);
+    if (ph->fallback) crpx_free (ph->cglob, ph->fallback);
+  }
+  crpx_global_finalise (ph->cglob); // it just decreases cglob->ref_counter
+  free (ph);
+}
+
+size_t
+crpx_perfect_hash_size_in_bytes (crpx_perfect_hash_t ph)
+{
+  uint64_t n_words = ph->level_start[ph->n_levels];
+  return (n_words + (n_words >> 3) + 1 + ph->n_fallback) * sizeof (uint64_t);
+}
+
+static bool
+perfect_hash_build (crpx_perfect_hash_t ph, const uint64_t *keys, size_t n, double gamma)
+{ /* taken[] has the bits hit at least once, and collision[] those hit more than once; the level keeps taken & ~collision */
+  crpx_global_t cglob = ph->cglob;
+  uint64_t *left = NULL, *next = NULL, *taken = NULL, *collision = NULL, *tmp, n_words, i, c, n_chunks, total_words = 0;
+  size_t *chunk_count = NULL, n_left = n, placed;
+  const uint64_t *current = keys;
+  bool success = false, unique = false;
+  uint8_t level;
+
+  for (level = 0; (level < CRPX_PERFECT_HASH_MAX_LEVELS) && (n_left > 0); level++) {
+    n_words = ((uint64_t) (gamma * (double) n_left) + 63) >> 6;
+    ph->level_start[level + 1] = total_words + n_words;
+    ph->n_levels = level + 1;
+    tmp = (uint64_t *) crpx_realloc (cglob, ph->bits, (total_words + n_words) * sizeof (uint64_t));
+    if (!tmp) goto perfect_hash_build_cleanup;
+    ph->bits = tmp;
+    taken = (uint64_t *) crpx_calloc (cglob, n_words, sizeof (uint64_t));
+    collision = (uint64_t *) crpx_calloc (cglob, n_words, sizeof (uint64_t));
+    if (!taken || !collision) goto perfect_hash_build_cleanup;
+
+#pragma omp parallel for schedule(static) private(i)
+    for (i = 0; i < n_left; i++) {
+      uint64_t pos = perfect_hash_position (ph, current[i], level) - (total_words << 6), mask = 1ULL << (pos & 63), old;
+      #pragma omp atomic capture
+      { old = taken[pos >> 6]; taken[pos >> 6] |= mask; }
+      if (old & mask) {
+        #pragma omp atomic
+        collision[pos >> 6] |= mask;
+      }
+    }
+    for (i = 0; i < n_words; i++) ph->bits[total_words + i] = taken[i] & ~collision[i];
+
+    /* keys in collision positions go to next level: count per chunk, then copy in chunk order */
+    n_chunks = (n_left + PH_CHUNK - 1) / PH_CHUNK;
+    chunk_count = (size_t *) crpx_calloc (cglob, n_chunks + 1, sizeof (size_t));
+    if (!chunk_count) goto perfect_hash_build_cleanup;
+#pragma omp parallel for schedule(dynamic) private(c, i)
+    for (c = 0; c < n_chunks; c++) for (i = c * PH_CHUNK; i < CRPX_MIN ((c + 1) * PH_CHUNK, n_left); i++) {
+      uint64_t pos = perfect_hash_position (ph, current[i], level) - (total_words << 6);
+      chunk_count[c + 1] += ((collision[pos >> 6] >> (pos & 63)) & 1);
+    }
+    for (c = 0; c < n_chunks; c++) chunk_count[c + 1] += chunk_count[c];
+    next = (chunk_count[n_chunks] > 0) ? (uint64_t *) crpx_malloc (cglob, chunk_count[n_chunks] * sizeof (uint64_t)) : NULL;
+    if (chunk_count[n_chunks] && !next) goto perfect_hash_build_cleanup;
+#pragma omp parallel for schedule(dynamic) private(c, i)
+    for (c = 0; c < n_chunks; c++) {
+      size_t j = chunk_count[c];
+      for (i = c * PH_CHUNK; i < CRPX_MIN ((c + 1) * PH_CHUNK, n_left); i++) {
+        uint64_t pos = perfect_hash_position (ph, current[i], level) - (total_words << 6);
+        if ((collision[pos >> 6] >> (pos & 63)) & 1) next[j++] = current[i];
+      }
+    }
+    placed = n_left - chunk_count[n_chunks];
+    n_left = chunk_count[n_chunks];
+    crpx_free (cglob, chunk_count); chunk_count = NULL;
+    crpx_free (cglob, taken); taken = NULL;
+    crpx_free (cglob, collision); collision = NULL;
+    if (left) crpx_free (cglob, left);
+    current = left = next; next = NULL;
+    if (!placed) { // level without keys is discarded; if only duplicates collided, it is rebuilt with distinct keys
+      ph->level_start[level + 1] = total_words;
+      ph->n_levels = level;
+      if (unique) break;
+      n_left = perfect_hash_unique (left, n_left);
+      unique = true;
+      level--; // unsigned wrap-around is undone by the loop increment
+      continue;
+    }
+    total_words += n_words;
+    if (!unique && (n_left <= n / 8)) { // duplicates always collide, thus are removed once few keys are left
+      n_left = perfect_hash_unique (left, n_left);
+      unique = true;
+    }
+  }
+
+  /* remaining keys are stored sorted, without repetition */
+  if (n_left) {
+    ph->n_fallback = perfect_hash_unique (left, n_left);
+    ph->fallback = left; left = NULL;
+  }
+  if (!ph->bits) ph->bits = (uint64_t *) crpx_calloc (cglob, 1, sizeof (uint64_t)); // empty set
+  ph->rank = (uint64_t *) crpx_malloc (cglob, ((total_words >> 3) + 1) * sizeof (uint64_t));
+  if (!ph->bits || !ph->rank) goto perfect_hash_build_cleanup;
+  ph->rank[0] = 0;
+  for (i = 0; i < (total_words >> 3); i++) {
+    ph->rank[i + 1] = ph->rank[i];
+    for (c = 0; c < 8; c++) ph->rank[i + 1] += __builtin_popcountll (ph->bits[8 * i + c]);
+  }
+  ph->n_keys = (total_words ? perfect_hash_rank (ph, (total_words << 6) - 1) + (ph->bits[total_words - 1] >> 63) : 0) + ph->n_fallback;
+  success = true;
+
+perfect_hash_build_cleanup:
+  if (left) crpx_free (cglob, left);
+  if (next) crpx_free (cglob, next);
+  if (taken) crpx_free (cglob, taken);
+  if (collision) crpx_free (cglob, collision);
+  if (chunk_count) crpx_free (cglob, chunk_count);
+  return success;
+}
+
+uint64_t
+crpx_perfect_hash_lookup (crpx_perfect_hash_t ph, uint64_t key)
+{
+  uint64_t pos, lo = 0, hi = ph->n_fallback, mid;
+  for (uint8_t level = 0; level < ph->n_levels; level++) {
+    pos = perfect_hash_position (ph, key, level);
+    if ((ph->bits[pos >> 6] >> (pos & 63)) & 1) return perfect_hash_rank (ph, pos);
+  }
+  while (lo < hi) { // binary search in fallback keys
+    mid = (lo + hi) >> 1;
+    if (ph->fallback[mid] < key) lo = mid + 1;
+    else hi = mid;
+  }
+  if ((lo < ph->n_fallback) && (ph->fallback[lo] == key)) return ph->n_keys - ph->n_fallback + lo;
+  return UINT64_MAX;
+}
+
+void
+crpx_perfect_hash_lookup_array (crpx_perfect_hash_t ph, const uint64_t *keys, size_t n, uint64_t *index)
+{
+  size_t i;
+#pragma omp parallel for schedule(static) if (n > PH_BATCH * 1024)
+  for (i = 0; i < n; i += PH_BATCH) {
+    size_t j, m = CRPX_MIN (PH_BATCH, n - i);
+    for (j = 0; j < m; j++) { // first level word and its rank are requested before the first one is read
+      uint64_t pos = perfect_hash_position (ph, keys[i+j], 0);
+      __builtin_prefetch (ph->bits + (pos >> 6), 0, 1);
+      __builtin_prefetch (ph->rank + (pos >> 9), 0, 1);
+    }
+    for (j = 0; j < m; j++) index[i+j] = crpx_perfect_hash_lookup (ph, keys[i+j]);
+  }
+}
+
+/* file = 512 bytes header (64 x uint64_t in native byte order) followed by bits, rank and fallback arrays */
+bool
+crpx_perfect_hash_save (crpx_perfect_hash_t ph, const char *filename)
+{
+  uint64_t header[PH_HEADER_SIZE / sizeof (uint64_t)] = {PH_MAGIC, ph->seed, ph->n_keys, ph->n_fallback, ph->n_levels, 0};
+  uint64_t n_words = ph->level_start[ph->n_levels];
+  memcpy (header + 6, ph->level_start, sizeof (ph->level_start));
+  FILE *fp = fopen (filename, "wb");
+  if (!fp) {
+    crpx_logger_error (ph->cglob, "crpx_perfect_hash_save: could not open file %s: %s", filename, strerror (errno));
+    return false;
+  }
+  bool ok = (fwrite (header, PH_HEADER_SIZE, 1, fp) == 1) && (fwrite (ph->bits, sizeof (uint64_t), n_words, fp) == n_words) &&
+            (fwrite (ph->rank, sizeof (uint64_t), (n_words >> 3) + 1, fp) == (n_words >> 3) + 1) &&
+            (!ph->n_fallback || (fwrite (ph->fallback, sizeof (uint64_t), ph->n_fallback, fp) == ph->n_fallback)); // fallback is NULL if empty
+  ok = (fclose (fp) == 0) && ok;
+  if (!ok) crpx_logger_error (ph->cglob, "crpx_perfect_hash_save: could not write to file %s", filename);
+  return ok;
+}
+
+static bool
+perfect_hash_valid_header (const uint64_t *header, uint64_t file_size)
+{ /* level_start[] must start at zero and increase (levels are never empty), s.t. lookups stay inside the bit array,
+   * and sizes are compared with the file size before being added, to avoid overflow */
+  const uint64_t *level_start = header + 6;
+  uint64_t n_words, max_words = (file_size - PH_HEADER_SIZE) / sizeof (uint64_t);
+  if ((header[0] != PH_MAGIC) || (header[4] > CRPX_PERFECT_HASH_MAX_LEVELS) || (header[3] > header[2]) || level_start[0]) return false;
+  for (uint8_t level = 0; level < header[4]; level++) if (level_start[level + 1] <= level_start[level]) return false;
+  n_words = level_start[header[4]];
+  if ((n_words > max_words) || (header[3] > max_words)) return false;
+  return (max_words * sizeof (uint64_t) == file_size - PH_HEADER_SIZE) && (max_words == n_words + (n_words >> 3) + 1 + header[3]);
+}
+
+crpx_perfect_hash_t
+new_crpx_perfect_hash_from_file (crpx_global_t cglob, const char *filename)
+{
+#ifdef CRPX_OS_WINDOWS
+  crpx_logger_error (cglob, "new_crpx_perfect_hash_from_file: memory mapped files not supported on this system (file %s)", filename);
+  return NULL;
+#else
+  struct stat st;
+  const uint64_t *header;
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0) {
+    crpx_logger_error (cglob, "new_crpx_perfect_hash_from_file: could not open file %s: %s", filename, strerror (errno));
+    return NULL;
+  }
+  if ((fstat (fd, &st) < 0) || (st.st_size < PH_HEADER_SIZE)) {
+    crpx_logger_error (cglob, "new_crpx_perfect_hash_from_file: file %s is too small or could not be read", filename);
+    close (fd);
+    return NULL;
+  }
+  void *ptr = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd); // mapping remains valid after closing file
+  if (ptr == MAP_FAILED) {
+    crpx_logger_error (cglob, "new_crpx_perfect_hash_from_file: could not map file %s: %s", filename, strerror (errno));
+    return NULL;
+  }
+  header = (const uint64_t *) ptr;
+  if (!perfect_hash_valid_header (header, (uint64_t) st.st_size)) {
+    crpx_logger_error (cglob, "new_crpx_perfect_hash_from_file: file %s is not a valid minimal perfect hash", filename);
+    munmap (ptr, (size_t) st.st_size);
+    return NULL;
+  }
+  crpx_perfect_hash_t ph = (crpx_perfect_hash_t) crpx_malloc (cglob, sizeof (crpx_perfect_hash_struct));
+  if (!ph) { munmap (ptr, (size_t) st.st_size); return NULL; }
+  ph->mmap_ptr = ptr;
+  ph->mmap_size = (size_t) st.st_size;
+  ph->seed = header[1];
+  ph->n_keys = header[2];
+  ph->n_fallback = header[3];
+  ph->n_levels = (uint8_t) header[4];
+  memcpy (ph->level_start, header + 6, sizeof (ph->level_start));
+  ph->bits = (uint64_t *) ((char *) ptr + PH_HEADER_SIZE); // read-only memory
+  ph->rank = ph->bits + ph->level_start[ph->n_levels];
+  ph->fallback = ph->rank + (ph->level_start[ph->n_levels] >> 3) + 1;
+  ph->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, ph->cglob); // thread-safe increase of ref_counter
+  return ph;
+#endif
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  if (*(const uint64_t *) a > *(const uint64_t *) b) return 1;
+  if (*(const uint64_t *) a < *(const uint64_t *) b) return -1;
+  return 0;
+}
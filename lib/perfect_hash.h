@@ -0,0 +1,58 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file perfect_hash.h
+ *  \brief static minimal perfect hash function (BBHash, Limasset et al. 2017) mapping n distinct 64 bits keys (e.g.
+ *  k-mers) to 0...n-1. Level l has a bit array of about gamma x (keys left) bits; keys whose hash falls alone in a
+ *  position set its bit, and the others move to the next level. The index of a key is the rank of its bit over all
+ *  levels. With gamma=1 it uses about 3.1 bits per key, and gamma=2 about 3.7 bits per key but has faster lookups. */
+
+#ifndef _curupixa_perfect_hash_h_
+#define _curupixa_perfect_hash_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+#define CRPX_PERFECT_HASH_MAX_LEVELS 32
+
+typedef struct {
+  uint64_t *bits;      /*!< \brief bit arrays of all levels, one after the other */
+  uint64_t *rank;      /*!< \brief number of set bits before each block of 8 words (512 bits) */
+  uint64_t *fallback;  /*!< \brief sorted keys not placed in any level, with indices after the placed ones */
+  uint64_t level_start[CRPX_PERFECT_HASH_MAX_LEVELS + 1]; /*!< \brief first word of each level (in bits[]) */
+  uint64_t seed, n_keys, n_fallback;
+  uint8_t n_levels;
+  void *mmap_ptr;      /*!< \brief if loaded from file, arrays point to this memory mapped region */
+  size_t mmap_size;
+  crpx_global_t cglob;
+} crpx_perfect_hash_struct, *crpx_perfect_hash_t;
+
+/*! \brief build function from n keys (duplicates are allowed, and map to the same index) with gamma >= 1 (0 means
+ *  2); each level is built in parallel, and the result does not depend on the number of threads */
+crpx_perfect_hash_t new_crpx_perfect_hash (crpx_global_t cglob, const uint64_t *keys, size_t n, double gamma, uint64_t seed);
+/*! \brief memory-maps a file created by crpx_perfect_hash_save(); returns NULL if file is invalid */
+crpx_perfect_hash_t new_crpx_perfect_hash_from_file (crpx_global_t cglob, const char *filename);
+void del_crpx_perfect_hash (crpx_perfect_hash_t ph);
+/*! \brief index in 0...n_keys-1 of a key from the original set; other keys get an arbitrary index or UINT64_MAX */
+uint64_t crpx_perfect_hash_lookup (crpx_perfect_hash_t ph, uint64_t key);
+/*! \brief batched lookup with software prefetching of first level, in parallel */
+void crpx_perfect_hash_lookup_array (crpx_perfect_hash_t ph, const uint64_t *keys, size_t n, uint64_t *index);
+bool crpx_perfect_hash_save (crpx_perfect_hash_t ph, const char *filename);
+size_t crpx_perfect_hash_size_in_bytes (crpx_perfect_hash_t ph);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,197 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file protein_kmer.c
+ *  \brief rolling reduced-alphabet protein k-mers; the m lowest hashes of a sequence are kept in a max-heap. */
+
+#include "protein_kmer.h"
+
+#define PK_PARALLEL_MIN 16 /* batches with fewer sequences than this are processed by a single thread */
+
+crpx_protein_kmer_t
+new_crpx_protein_kmer (crpx_global_t cglob, const char *groups, uint8_t k, uint64_t seed)
+{
+  uint64_t power = 1;
+  uint8_t size = 0, c;
+  bool overflow = false;
+  const char *s;
+  if (!groups) groups = CRPX_PROTEIN_ALPHABET_13;
+  crpx_protein_kmer_t pk = (crpx_protein_kmer_t) crpx_malloc (cglob, sizeof (crpx_protein_kmer_struct));
+  if (!pk) return NULL;
+  memset (pk->code, CRPX_PROTEIN_INVALID, sizeof (pk->code));
+  for (s = groups; *s; s++) { // each comma starts a new group
+    if (*s == ',') { size++; continue; }
+    c = (uint8_t) toupper ((unsigned char) *s);
+    if ((pk->code[c] != CRPX_PROTEIN_INVALID) || (size >= CRPX_PROTEIN_INVALID - 1)) {
+      crpx_logger_error (cglob, "new_crpx_protein_kmer: letter '%c' repeated or too many groups in \"%s\"", *s, groups);
+      free (pk); return NULL;
+    }
+    pk->code[c] = pk->code[tolower (c)] = size;
+  }
+  if ((s > groups) && (s[-1] != ',')) size++;
+  if (size < 2) {
+    crpx_logger_error (cglob, "new_crpx_protein_kmer: alphabet \"%s\" must have at least 2 groups", groups);
+    free (pk); return NULL;
+  }
+  for (c = 1; (c < k) && !overflow; c++) overflow = __builtin_mul_overflow (power, (uint64_t) size, &power);
+  if ((k < 1) || overflow || ((__uint128_t) power * size > ((__uint128_t) 1 << 64))) {
+    crpx_logger_error (cglob, "new_crpx_protein_kmer: k=%u is too large for an alphabet of %u letters (k-mers must fit in 64 bits)", k, size);
+    free (pk); return NULL;
+  }
+  pk->top_power = power;
+  pk->alphabet_size = size;
+  pk->k = k;
+  pk->seed = crpx_hashint_splitmix64 (seed);
+  pk->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, pk->cglob); // thread-safe increase of ref_counter
+  return pk;
+}
+
+void
+del_crpx_protein_kmer (crpx_protein_kmer_t pk)
+{
+  if (!pk) return;
+  crpx_global_finalise (pk->cglob); // it just decreases cglob->ref_counter
+  free (pk);
+}
+
+static inline bool
+pk_roll (crpx_protein_kmer_t pk, const char *seq, size_t i, uint64_t *kmer, size_t *valid)
+{ /* adds residue i to the k-mer, removing the first one by subtracting its code times alphabet_size^(k-1). Arithmetic
+   * modulo 2^64 is exact since alphabet_size^k <= 2^64. Returns true if the k-mer ending at i has only valid residues */
+  uint8_t c = pk->code[(uint8_t) seq[i]];
+  if (c == CRPX_PROTEIN_INVALID) { *valid = 0; *kmer = 0; return false; }
+  if (*valid >= pk->k) *kmer -= pk->code[(uint8_t) seq[i - pk->k]] * pk->top_power;
+  *kmer = *kmer * pk->alphabet_size + c;
+  return (++(*valid) >= pk->k);
+}
+
+static inline uint64_t
+pk_hash (crpx_protein_kmer_t pk, uint64_t kmer)
+{ // bijective, thus distinct k-mers have distinct hashes
+  return crpx_hashint_murmurmix64 (kmer ^ pk->seed);
+}
+
+size_t
+crpx_protein_kmer_hash_sequence (crpx_protein_kmer_t pk, const char *seq, size_t len, uint64_t *hash, uint32_t *position)
+{
+  uint64_t kmer = 0;
+  size_t i, valid = 0, n = 0;
+  for (i = 0; i < len; i++) if (pk_roll (pk, seq, i, &kmer, &valid)) {
+    if (position) position[n] = (uint32_t) (i + 1 - pk->k);
+    hash[n++] = pk_hash (pk, kmer);
+  }
+  return n;
+}
+
+static inline void
+pk_heap_sift_down (crpx_protein_kmer_record_t heap, size_t n, size_t i)
+{ // max-heap by hash
+  crpx_protein_kmer_record_struct x = heap[i];
+  size_t child;
+  while ((child = 2 * i + 1) < n) {
+    if ((child + 1 < n) && (heap[child + 1].hash > heap[child].hash)) child++;
+    if (heap[child].hash <= x.hash) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = x;
+}
+
+static size_t
+pk_lowest_records (crpx_protein_kmer_t pk, const char *seq, size_t len, uint16_t m, uint32_t seq_id, crpx_protein_kmer_record_t heap)
+{ // heap[0] is the largest of the m lowest hashes so far; repeated k-mers are only checked if they would enter the heap
+  uint64_t kmer = 0, h;
+  size_t i, j, valid = 0, n = 0;
+  crpx_protein_kmer_record_struct x;
+  if (!m) return 0;
+  for (i = 0; i < len; i++) if (pk_roll (pk, seq, i, &kmer, &valid)) {
+    h = pk_hash (pk, kmer);
+    if ((n == m) && (h >= heap[0].hash)) continue;
+    for (j = 0; (j < n) && (heap[j].hash != h); j++);
+    if (j < n) continue;
+    x.hash = h; x.seq_id = seq_id; x.position = (uint32_t) (i + 1 - pk->k);
+    if (n < m) { // sift up
+      for (j = n++; (j > 0) && (heap[(j - 1) / 2].hash < h); j = (j - 1) / 2) heap[j] = heap[(j - 1) / 2];
+      heap[j] = x;
+    }
+    else { heap[0] = x; pk_heap_sift_down (heap, n, 0); }
+  }
+  for (i = n; i > 1; i--) { // heap sort, in increasing order of hash
+    x = heap[0]; heap[0] = heap[i - 1]; heap[i - 1] = x;
+    pk_heap_sift_down (heap, i - 1, 0);
+  }
+  return n;
+}
+
+size_t
+crpx_protein_kmer_lowest (crpx_protein_kmer_t pk, const char *seq, size_t len, uint16_t m, uint64_t *hash, uint32_t *position)
+{
+  crpx_protein_kmer_record_t rec;
+  size_t i, n;
+  if (!m) return 0;
+  if (!(rec = (crpx_protein_kmer_record_t) crpx_malloc (pk->cglob, m * sizeof (crpx_protein_kmer_record_struct)))) {
+    crpx_logger_error (pk->cglob, "crpx_protein_kmer_lowest: could not allocate memory for %u k-mers", m);
+    return SIZE_MAX;
+  }
+  n = pk_lowest_records (pk, seq, len, m, 0, rec);
+  for (i = 0; i < n; i++) {
+    hash[i] = rec[i].hash;
+    if (position) position[i] = rec[i].position;
+  }
+  crpx_free (pk->cglob, rec);
+  return n;
+}
+
+size_t
+crpx_protein_kmer_records (crpx_protein_kmer_t pk, const char **seq, const size_t *len, uint32_t n_seqs, uint32_t first_id, uint16_t m, crpx_protein_kmer_record_t record)
+{ // each sequence fills its own block of m records, which are then compacted in order
+  uint16_t *n_found;
+  size_t n = 0;
+  int64_t i;
+  if (!n_seqs) return 0;
+  if (!(n_found = (uint16_t *) crpx_malloc (pk->cglob, n_seqs * sizeof (uint16_t)))) {
+    crpx_logger_error (pk->cglob, "crpx_protein_kmer_records: could not allocate memory for %u sequences", n_seqs);
+    return SIZE_MAX;
+  }
+#pragma omp parallel for schedule(dynamic, 16) if (n_seqs > PK_PARALLEL_MIN)
+  for (i = 0; i < (int64_t) n_seqs; i++)
+    n_found[i] = (uint16_t) pk_lowest_records (pk, seq[i], len[i], m, first_id + (uint32_t) i, record + (size_t) i * m);
+  for (i = 0; i < (int64_t) n_seqs; i++) {
+    if (n != (size_t) i * m) memmove (record + n, record + (size_t) i * m, n_found[i] * sizeof (crpx_protein_kmer_record_struct));
+    n += n_found[i];
+  }
+  crpx_free (pk->cglob, n_found);
+  return n;
+}
+
+bool
+crpx_protein_kmer_sort_records (crpx_protein_kmer_t pk, crpx_protein_kmer_record_t record, size_t n)
+{ // LSD radix sort over the bytes of hash; skips bytes where all hashes are equal
+  crpx_protein_kmer_record_t src = record, dst, swap, tmp;
+  size_t count[256], i, sum, x;
+  if (n < 2) return true;
+  if (!(tmp = dst = (crpx_protein_kmer_record_t) crpx_malloc (pk->cglob, n * sizeof (crpx_protein_kmer_record_struct)))) return false;
+  for (int shift = 0; shift < 64; shift += 8) {
+    memset (count, 0, sizeof (count));
+    for (i = 0; i < n; i++) count[(src[i].hash >> shift) & 0xff]++;
+    if (count[(src[0].hash >> shift) & 0xff] == n) continue;
+    for (sum = i = 0; i < 256; i++) { x = count[i]; count[i] = sum; sum += x; }
+    for (i = 0; i < n; i++) dst[ count[(src[i].hash >> shift) & 0xff]++ ] = src[i];
+    swap = src; src = dst; dst = swap;
+  }
+  if (src != record) memcpy (record, src, n * sizeof (crpx_protein_kmer_record_struct));
+  crpx_free (pk->cglob, tmp);
+  return true;
+}
@@ -0,0 +1,69 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+
+/*! \file protein_kmer.h
+ *  \brief protein k-mers over a reduced amino acid alphabet, as in linclust (Steinegger and Soeding 2018): residues
+ *  are merged into groups of similar amino acids, s.t. k-mers from homologous proteins match more often. A k-mer is
+ *  the number in base alphabet_size formed by its group codes (updated in O(1) per residue) which is then mixed by a
+ *  bijective 64 bits hash, thus distinct k-mers never share a hash. Each sequence is represented by the m k-mers with
+ *  lowest hash values, emitted as (hash, sequence id, position) records to be sorted and grouped by hash. */
+
+#ifndef _curupixa_protein_kmer_h_
+#define _curupixa_protein_kmer_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+/*! \brief default 13 letters alphabet: groups of amino acids with positive BLOSUM62 scores between them; ambiguous
+ *  codes B, Z and J join their possible residues, U joins C and O joins K. Other chars (e.g. X, *, gaps) are invalid */
+#define CRPX_PROTEIN_ALPHABET_13 "AS,CU,DNB,EQZ,FY,G,H,IVJ,KRO,LM,P,T,W"
+#define CRPX_PROTEIN_INVALID 0xff /*!< \brief code of chars outside the alphabet, which are skipped by k-mers */
+
+typedef struct {
+  uint8_t code[256];     /*!< \brief group of each char (upper or lower case), or CRPX_PROTEIN_INVALID */
+  uint64_t top_power;    /*!< \brief alphabet_size^(k-1), to remove the first residue of a k-mer */
+  uint64_t seed;
+  uint8_t alphabet_size, k;
+  crpx_global_t cglob;
+} crpx_protein_kmer_struct, *crpx_protein_kmer_t;
+
+typedef struct {
+  uint64_t hash;         /*!< \brief first, s.t. records can be radix sorted by the lowest 8 bytes */
+  uint32_t seq_id, position; /*!< \brief sequence index and start of the k-mer in the sequence */
+} crpx_protein_kmer_record_struct, *crpx_protein_kmer_record_t;
+
+/*! \brief new k-mer hasher with alphabet given by comma-separated groups of letters (NULL for CRPX_PROTEIN_ALPHABET_13).
+ *  The k-mer must fit in 64 bits (alphabet_size^k <= 2^64, e.g. k up to 17 with 13 letters). Returns NULL if invalid */
+crpx_protein_kmer_t new_crpx_protein_kmer (crpx_global_t cglob, const char *groups, uint8_t k, uint64_t seed);
+void del_crpx_protein_kmer (crpx_protein_kmer_t pk);
+/*! \brief hashes of all k-mers of seq (skipping k-mers with invalid chars), with their start positions if position is
+ *  not NULL. Arrays must have room for len - k + 1 elements. Returns number of k-mers */
+size_t crpx_protein_kmer_hash_sequence (crpx_protein_kmer_t pk, const char *seq, size_t len, uint64_t *hash, uint32_t *position);
+/*! \brief m distinct k-mers with lowest hash values (first occurrence of each), in increasing order of hash, with their
+ *  positions if position is not NULL. Returns number of k-mers, which is smaller than m for short sequences (SIZE_MAX
+ *  if memory failed) */
+size_t crpx_protein_kmer_lowest (crpx_protein_kmer_t pk, const char *seq, size_t len, uint16_t m, uint64_t *hash, uint32_t *position);
+/*! \brief records of the m lowest k-mers of each of n_seqs sequences (with lengths len[]), in parallel; sequence ids
+ *  start at first_id, s.t. batches can be concatenated. Records are ordered by sequence and hash, and record must have
+ *  room for n_seqs x m elements. Returns number of records (SIZE_MAX if memory failed) */
+size_t crpx_protein_kmer_records (crpx_protein_kmer_t pk, const char **seq, const size_t *len, uint32_t n_seqs, uint32_t first_id, uint16_t m, crpx_protein_kmer_record_t record);
+/*! \brief stable LSD radix sort of records by hash, s.t. sequences sharing a k-mer become neighbours */
+bool crpx_protein_kmer_sort_records (crpx_protein_kmer_t pk, crpx_protein_kmer_record_t record, size_t n);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
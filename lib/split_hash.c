@@ -0,0 +1,162 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file split_hash.c
+ *  \brief split hashes from one postorder pass over the parent vector, and RF distances from sorted-hash merges. */
+
+#include "split_hash.h"
+
+static int compare_uint64_increasing (const void *a, const void *b);
+
+crpx_split_hash_t
+new_crpx_split_hash (crpx_global_t cglob, uint32_t n_taxa)
+{
+  uint32_t i;
+  if (n_taxa < 4) {
+    crpx_logger_error (cglob, "new_crpx_split_hash: trees need at least 4 taxa to have non-trivial splits, not %u", n_taxa);
+    return NULL;
+  }
+  crpx_split_hash_t sh = (crpx_split_hash_t) crpx_malloc (cglob, sizeof (crpx_split_hash_struct));
+  if (!sh) return NULL;
+  sh->key = (uint64_t *) crpx_malloc (cglob, n_taxa * sizeof (uint64_t));
+  if (!sh->key) { free (sh); return NULL; }
+  sh->n_taxa = n_taxa;
+  sh->all_taxa = 0;
+  for (i = 0; i < n_taxa; i++) {
+    do sh->key[i] = crpx_random_64bits (cglob); while (!sh->key[i]);
+    sh->all_taxa ^= sh->key[i];
+  }
+  sh->cglob = cglob;
+  crpx_link_add_global_pointer (cglob, sh->cglob); // thread-safe increase of ref_counter
+  return sh;
+}
+
+void
+del_crpx_split_hash (crpx_split_hash_t sh)
+{
+  if (!sh) return;
+  if (sh->key) crpx_free (sh->cglob, sh->key);
+  crpx_global_finalise (sh->cglob); // it just decreases cglob->ref_counter
+  free (sh);
+}
+
+int32_t
+crpx_split_hash_tree (crpx_split_hash_t sh, const int32_t *parent, uint32_t n_nodes, uint64_t *splits)
+{ /* h[i] is the XOR of keys below node i, n_below[i] the number of leaves; a node defines a non-trivial split if both
+   * sides have at least two leaves. For rooted (binary) trees the two children of the root give the same split */
+  uint32_t i, n_taxa = sh->n_taxa, n_splits = 0, j;
+  if ((n_nodes <= n_taxa) || (parent[n_nodes - 1] != -1)) {
+    crpx_logger_error (sh->cglob, "crpx_split_hash_tree: %u nodes with %u taxa, or last node is not root", n_nodes, n_taxa);
+    return -1;
+  }
+  uint64_t *h = (uint64_t *) crpx_calloc (sh->cglob, n_nodes, sizeof (uint64_t));
+  uint32_t *n_below = (uint32_t *) crpx_calloc (sh->cglob, n_nodes, sizeof (uint32_t));
+  bool *has_first = (bool *) crpx_calloc (sh->cglob, n_nodes, sizeof (bool));
+  if (!h || !n_below || !has_first) { n_splits = UINT32_MAX; goto split_hash_cleanup; }
+
+  for (i = 0; i < n_taxa; i++) { h[i] = sh->key[i]; n_below[i] = 1; }
+  has_first[0] = true;
+  for (i = 0; i < n_nodes - 1; i++) {
+    if ((parent[i] <= (int32_t) i) || (parent[i] >= (int32_t) n_nodes) || (parent[i] < (int32_t) n_taxa)) {
+      crpx_logger_error (sh->cglob, "crpx_split_hash_tree: parent of node %u is %d, but should be an internal node after it", i, parent[i]);
+      n_splits = UINT32_MAX; goto split_hash_cleanup;
+    }
+    h[parent[i]] ^= h[i];
+    n_below[parent[i]] += n_below[i];
+    has_first[parent[i]] |= has_first[i];
+    if ((i >= n_taxa) && (n_below[i] > 1) && (n_below[i] < n_taxa - 1)) splits[n_splits++] = has_first[i] ? sh->all_taxa ^ h[i] : h[i];
+  }
+  if (n_below[n_nodes - 1] != n_taxa) {
+    crpx_logger_error (sh->cglob, "crpx_split_hash_tree: root has %u leaves below it, instead of %u", n_below[n_nodes - 1], n_taxa);
+    n_splits = UINT32_MAX; goto split_hash_cleanup;
+  }
+  if (n_splits > 1) {
+    qsort (splits, n_splits, sizeof (uint64_t), compare_uint64_increasing);
+    for (i = j = 1; i < n_splits; i++) if (splits[i] != splits[j - 1]) splits[j++] = splits[i];
+    n_splits = j;
+  }
+
+split_hash_cleanup:
+  if (h) crpx_free (sh->cglob, h);
+  if (n_below) crpx_free (sh->cglob, n_below);
+  if (has_first) crpx_free (sh->cglob, has_first);
+  return (n_splits == UINT32_MAX) ? -1 : (int32_t) n_splits;
+}
+
+uint32_t
+crpx_split_hash_rf_distance (const uint64_t *splits_a, uint32_t n_a, const uint64_t *splits_b, uint32_t n_b)
+{
+  uint32_t i = 0, j = 0, common = 0;
+  while ((i < n_a) && (j < n_b)) {
+    if (splits_a[i] < splits_b[j]) i++;
+    else if (splits_a[i] > splits_b[j]) j++;
+    else { common++; i++; j++; }
+  }
+  return n_a + n_b - 2 * common;
+}
+
+inline size_t
+crpx_split_hash_rf_index (uint32_t i, uint32_t j, uint32_t n_trees)
+{
+  if (i > j) { uint32_t t = i; i = j; j = t; }
+  return (size_t) i * n_trees - (size_t) i * (i + 1) / 2 + j - i - 1;
+}
+
+bool
+crpx_split_hash_rf_matrix (crpx_split_hash_t sh, int32_t **parent, const uint32_t *n_nodes, uint32_t n_trees, uint32_t *dist)
+{ /* split sets of all trees are stored contiguously (n_taxa - 3 at most for each tree), and then each row of the
+   * matrix is computed by one thread; rows have decreasing lengths, thus the dynamic schedule */
+  size_t stride = sh->n_taxa, i;
+  bool success = true;
+  uint64_t *splits = (uint64_t *) crpx_malloc (sh->cglob, n_trees * stride * sizeof (uint64_t));
+  uint32_t *n_splits = (uint32_t *) crpx_malloc (sh->cglob, n_trees * sizeof (uint32_t));
+  if (!splits || !n_splits) { success = false; goto rf_matrix_cleanup; }
+
+#pragma omp parallel for shared(sh, parent, n_nodes, n_trees, splits, n_splits, stride, success) private(i) schedule(dynamic, 16)
+  for (i = 0; i < n_trees; i++) {
+    int32_t n = -1;
+    if (n_nodes[i] <= 2 * sh->n_taxa) { // more nodes than that cannot fit into splits[] (and are not a valid tree)
+      uint64_t *tmp = (uint64_t *) crpx_malloc (sh->cglob, n_nodes[i] * sizeof (uint64_t));
+      if (tmp) n = crpx_split_hash_tree (sh, parent[i], n_nodes[i], tmp);
+      if (n >= 0) memcpy (splits + i * stride, tmp, n * sizeof (uint64_t));
+      if (tmp) crpx_free (sh->cglob, tmp);
+    }
+    else crpx_logger_error (sh->cglob, "crpx_split_hash_rf_matrix: tree %lu has %u nodes, more than 2 x %u taxa", i, n_nodes[i], sh->n_taxa);
+    if (n < 0) {
+#pragma omp atomic write
+      success = false;
+      n = 0;
+    }
+    n_splits[i] = (uint32_t) n;
+  }
+  if (!success) goto rf_matrix_cleanup;
+
+#pragma omp parallel for shared(n_trees, splits, n_splits, stride, dist) private(i) schedule(dynamic, 1)
+  for (i = 0; i < n_trees; i++) {
+    size_t row = crpx_split_hash_rf_index (i, i + 1, n_trees);
+    for (size_t j = i + 1; j < n_trees; j++)
+      dist[row + j - i - 1] = crpx_split_hash_rf_distance (splits + i * stride, n_splits[i], splits + j * stride, n_splits[j]);
+  }
+
+rf_matrix_cleanup:
+  if (splits) crpx_free (sh->cglob, splits);
+  if (n_splits) crpx_free (sh->cglob, n_splits);
+  return success;
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,53 @@
+/* This file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * curupixa is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details (file "COPYING" or http://www.gnu.org/copyleft/gpl.html).
+ */
+
+/*! \file split_hash.h
+ *  \brief bipartition (split) hashing of phylogenetic trees in the style of Zobrist hashing: each taxon has a random
+ *  64 bits key, and a split is represented by the XOR of the keys on one side. For unrooted trees the side without
+ *  taxon 0 is used, s.t. both sides of a split give the same hash. Robinson-Foulds distances are then computed by
+ *  merging sorted split hashes (as in HashRF, Sul and Williams 2008); distinct splits collide with probability 2^-64. */
+
+#ifndef _curupixa_split_hash_h_
+#define _curupixa_split_hash_h_
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "global/global_variable.h"
+
+typedef struct {
+  uint64_t *key;         /*!< \brief random key of each taxon */
+  uint64_t all_taxa;     /*!< \brief XOR of all keys (hash of the complement of a split is all_taxa ^ hash) */
+  uint32_t n_taxa;
+  crpx_global_t cglob;
+} crpx_split_hash_struct, *crpx_split_hash_t;
+
+/*! \brief keys for n_taxa taxa (at least 4) drawn from the library RNG; all trees must use same crpx_split_hash_t */
+crpx_split_hash_t new_crpx_split_hash (crpx_global_t cglob, uint32_t n_taxa);
+void del_crpx_split_hash (crpx_split_hash_t sh);
+/*! \brief sorted, unique hashes of non-trivial splits of the unrooted tree described by parent[], where leaves are
+ *  nodes 0...n_taxa-1 (the taxa), and each internal node comes after all its children (postorder, root is last and
+ *  has parent -1). splits must have room for n_nodes elements; returns the number of splits, or -1 in case of error */
+int32_t crpx_split_hash_tree (crpx_split_hash_t sh, const int32_t *parent, uint32_t n_nodes, uint64_t *splits);
+/*! \brief Robinson-Foulds distance (number of splits present in only one tree) between two sorted split sets */
+uint32_t crpx_split_hash_rf_distance (const uint64_t *splits_a, uint32_t n_a, const uint64_t *splits_b, uint32_t n_b);
+/*! \brief all-vs-all RF distances for n_trees trees in parallel, stored as the upper triangle of the distance matrix:
+ *  dist[i * n_trees - i * (i + 1) / 2 + j - i - 1] for i < j (use crpx_split_hash_rf_index()). Returns false on error */
+bool crpx_split_hash_rf_matrix (crpx_split_hash_t sh, int32_t **parent, const uint32_t *n_nodes, uint32_t n_trees, uint32_t *dist);
+/*! \brief position of pair (i,j) in the distance vector of crpx_split_hash_rf_matrix(), for i != j */
+extern size_t crpx_split_hash_rf_index (uint32_t i, uint32_t j, uint32_t n_trees);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* if header not defined */
@@ -0,0 +1,72 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+/* Throughput of the lock-free concurrent map for 1, 2, 4, ..., 64 threads, with keys sampled from a Zipf distribution
+ * (skewed, as k-mer counts usually are). Command line:
+ * `./tests/bench_concurrent_map <number of updates> [number of distinct keys] [zipf exponent]`
+ * Without arguments it does nothing (to be skipped by 'make check').
+ */
+
+static uint64_t *
+sample_zipf_keys (crpx_global_t cglob, size_t n, uint64_t n_distinct, double exponent)
+{ // inverse transform sampling over cumulative distribution of ranks
+  double *cdf = (double *) crpx_malloc (cglob, n_distinct * sizeof (double)), x;
+  uint64_t *keys = (uint64_t *) crpx_malloc (cglob, n * sizeof (uint64_t)), i, lo, hi, mid;
+  for (i = 0, x = 0.; i < n_distinct; i++) cdf[i] = (x += 1. / pow ((double) (i + 1), exponent));
+  for (i = 0; i < n_distinct; i++) cdf[i] /= x;
+  for (i = 0; i < n; i++) {
+    x = crpx_random_double (cglob);
+    for (lo = 0, hi = n_distinct - 1; lo < hi;) { mid = (lo + hi) / 2; if (cdf[mid] < x) lo = mid + 1; else hi = mid; }
+    keys[i] = crpx_hashint_splitmix64 (lo); // rank is scrambled, s.t. frequent keys are not neighbours
+  }
+  crpx_free (cglob, cdf);
+  return keys;
+}
+
+int main(int argc, char **argv)
+{
+  uint64_t n = 0, n_distinct = 1000000, i, key, sum;
+  uint32_t count;
+  double exponent = 1.0, t;
+  int n_threads;
+
+  if (argc == 1) return TEST_SKIPPED;
+  crpx_global_t cglob = crpx_global_init (0, "info");
+  sscanf (argv[1], " %lu ", &n);
+  if (argc > 2) sscanf (argv[2], " %lu ", &n_distinct);
+  if (argc > 3) sscanf (argv[3], " %lf ", &exponent);
+
+  uint64_t *keys = sample_zipf_keys (cglob, n, n_distinct, exponent);
+  crpx_concurrent_map_t map = new_crpx_concurrent_map (cglob, n_distinct);
+  if (!keys || !map) return TEST_HARDERROR;
+  crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+  printf ("threads, updates, distinct_keys, zipf_exponent, seconds, million_updates_per_second\n");
+
+  for (n_threads = 1; n_threads <= 64; n_threads *= 2) {
+#ifdef _OPENMP
+    omp_set_num_threads (n_threads);
+#else
+    if (n_threads > 1) break;
+#endif
+    crpx_concurrent_map_clear (map);
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    if (!crpx_concurrent_map_add_array (map, keys, n)) crpx_logger_error (cglob, "map is full");
+    t = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    printf ("%d, %lu, %lu, %lf, %lf, %.2lf\n", n_threads, n, map->size, exponent, t, (double) n / (t * 1.e6));
+    for (sum = i = 0; crpx_concurrent_map_next (map, &i, &key, &count);) sum += count;
+    if (sum != n) crpx_logger_error (cglob, "sum of counters (%lu) differs from number of updates (%lu)", sum, n);
+  }
+
+  crpx_free (cglob, keys);
+  del_crpx_concurrent_map (map);
+  crpx_global_finalise (cglob);
+  return TEST_SKIPPED;
+}
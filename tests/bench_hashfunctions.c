@@ -0,0 +1,392 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> /* __rdtsc() */
+#define BENCH_LATENCY_UNIT "cycles"
+#else
+#define BENCH_LATENCY_UNIT "ns"
+#endif
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+/* SMHasher-style speed and quality measurements of the byte hashes from the registry (crpx_hash_function_list[], with
+ * SSE4.2 kernels listed separately) and of the integer mixers and slicing-by-N functions from hash_functions_generators.h.
+ * Command line: `./tests/bench_hashfunctions <csv|json> [substring of hash names]`
+ * Output has one line (or JSON object) per measurement: hash name, metric, key size in bytes, and value:
+ *   throughput_GBps  : bulk speed for keys of 4 bytes up to 1MB (integer mixers only at their own width)
+ *   latency_cycles   : cycles per hash when each key depends on the previous hash (ns if not on x86)
+ *   avalanche_worst  : largest bias |2 P(out bit flips | in bit flips) - 1| over all pairs of input and output bits
+ *   avalanche_mean   : mean bias over all pairs
+ *   collisions       : full-width collisions among 2^20 sequential keys; collisions_expected is the value for a random function
+ *   bucket_chi2_low  : chi-square / degrees of freedom over 2^16 buckets from lowest bits (about 1 for a random function)
+ *   bucket_chi2_high : same, but buckets from highest bits
+ * Without arguments it does nothing (to be skipped by 'make check').
+ */
+
+typedef struct {
+  const char *name;
+  crpx_hash_func func;
+  uint8_t out_bits;   /* output width (hashes of 128 bits are measured through their 64 bits return value) */
+  uint8_t key_bytes;  /* zero for byte hashes, or the width of integer mixers */
+} bench_hash_t;
+
+static uint32_t crc_seed[256], crc_table[256 * 16]; /* linear (CRC32C) table and its slices, for slicing-by-8/16 */
+
+static inline uint64_t
+key_to_uint64 (const void *key, size_t len)
+{
+  uint64_t x = 0;
+  memcpy (&x, key, len);
+  return x;
+}
+
+#define BYTE_HASH(name, expr) static uint64_t w_##name (const void *key, size_t len, uint64_t seed) { (void) seed; return (uint64_t)(expr); }
+#define INT_HASH(name, type, expr) static uint64_t w_##name (const void *key, size_t len, uint64_t seed) { type x = (type) key_to_uint64 (key, len) ^ (type) seed; return (uint64_t)(expr); }
+
+BYTE_HASH (pseudocrc32_slicing8, crpx_hash_pseudocrc32_slicing8_seed65536 (key, len, crc_table, (uint32_t) seed))
+BYTE_HASH (pseudocrc32_slicing16, crpx_hash_pseudocrc32_slicing16_seed131072 (key, len, crc_table, (uint32_t) seed))
+
+INT_HASH (mumhash64_mixer, uint64_t, crpx_mumhash64_mixer (x, 0x9e3779b97f4a7c15ULL))
+INT_HASH (wyhash64_mixer, uint64_t, crpx_wyhash64_mixer (x, 0x9e3779b97f4a7c15ULL))
+INT_HASH (hash_64_to_32, uint64_t, crpx_hash_64_to_32 (x))
+INT_HASH (staffordmix64, uint64_t, crpx_hashint_staffordmix64 (x))
+INT_HASH (splitmix64, uint64_t, crpx_hashint_splitmix64 (x))
+INT_HASH (splitmix64_inverse, uint64_t, crpx_hashint_splitmix64_inverse (x))
+INT_HASH (degski64, uint64_t, crpx_hashint_degski64 (x))
+INT_HASH (degski64_inverse, uint64_t, crpx_hashint_degski64_inverse (x))
+INT_HASH (fastmix64, uint64_t, crpx_hashint_fastmix64 (x))
+INT_HASH (murmurmix64, uint64_t, crpx_hashint_murmurmix64 (x))
+INT_HASH (rrmixer64, uint64_t, crpx_hashint_rrmixer64 (x))
+INT_HASH (nasam64, uint64_t, crpx_hashint_nasam64 (x))
+INT_HASH (pelican64, uint64_t, crpx_hashint_pelican64 (x))
+INT_HASH (moremur64, uint64_t, crpx_hashint_moremur64 (x))
+INT_HASH (entropy64, uint64_t, crpx_hashint_entropy (x))
+INT_HASH (jenkins32, uint32_t, crpx_hashint_jenkins (x))
+INT_HASH (jenkins32_v2, uint32_t, crpx_hashint_jenkins_v2 (x))
+INT_HASH (avalanche32, uint32_t, crpx_hashint_avalanche (x))
+INT_HASH (murmurmix32, uint32_t, crpx_hashint_murmurmix (x))
+INT_HASH (wellons3ple32, uint32_t, crpx_hashint_wellons3ple (x))
+INT_HASH (wellons3ple32_inverse, uint32_t, crpx_hashint_wellons3ple_inverse (x))
+INT_HASH (wellons32, uint32_t, crpx_hashint_wellons (x))
+INT_HASH (wellons32_inverse, uint32_t, crpx_hashint_wellons_inverse (x))
+INT_HASH (degski32, uint32_t, crpx_hashint_degski (x))
+INT_HASH (degski32_inverse, uint32_t, crpx_hashint_degski_inverse (x))
+INT_HASH (2xor_16bits, uint16_t, crpx_hashint_2xor_16bits (x))
+INT_HASH (3xor_16bits, uint16_t, crpx_hashint_3xor_16bits (x))
+INT_HASH (noxor_16bits, uint16_t, crpx_hashint_noxor_16bits (x))
+
+static bench_hash_t hash_list[] = { /* byte hashes from the registry (crpx_hash_function_list[]) are added in main() */
+  {"pseudocrc32_slicing8", w_pseudocrc32_slicing8, 32, 0}, {"pseudocrc32_slicing16", w_pseudocrc32_slicing16, 32, 0},
+  {"mumhash64_mixer", w_mumhash64_mixer, 64, 8}, {"wyhash64_mixer", w_wyhash64_mixer, 64, 8}, {"hash_64_to_32", w_hash_64_to_32, 32, 8},
+  {"hashint_staffordmix64", w_staffordmix64, 64, 8}, {"hashint_splitmix64", w_splitmix64, 64, 8},
+  {"hashint_splitmix64_inverse", w_splitmix64_inverse, 64, 8}, {"hashint_degski64", w_degski64, 64, 8},
+  {"hashint_degski64_inverse", w_degski64_inverse, 64, 8}, {"hashint_fastmix64", w_fastmix64, 64, 8},
+  {"hashint_murmurmix64", w_murmurmix64, 64, 8}, {"hashint_rrmixer64", w_rrmixer64, 64, 8}, {"hashint_nasam64", w_nasam64, 64, 8},
+  {"hashint_pelican64", w_pelican64, 64, 8}, {"hashint_moremur64", w_moremur64, 64, 8}, {"hashint_entropy", w_entropy64, 64, 8},
+  {"hashint_jenkins", w_jenkins32, 32, 4}, {"hashint_jenkins_v2", w_jenkins32_v2, 32, 4}, {"hashint_avalanche", w_avalanche32, 32, 4},
+  {"hashint_murmurmix", w_murmurmix32, 32, 4}, {"hashint_wellons3ple", w_wellons3ple32, 32, 4},
+  {"hashint_wellons3ple_inverse", w_wellons3ple32_inverse, 32, 4}, {"hashint_wellons", w_wellons32, 32, 4},
+  {"hashint_wellons_inverse", w_wellons32_inverse, 32, 4}, {"hashint_degski", w_degski32, 32, 4},
+  {"hashint_degski_inverse", w_degski32_inverse, 32, 4}, {"hashint_2xor_16bits", w_2xor_16bits, 16, 2},
+  {"hashint_3xor_16bits", w_3xor_16bits, 16, 2}, {"hashint_noxor_16bits", w_noxor_16bits, 16, 2}
+};
+
+static bool json_output = false, first_record = true;
+static volatile uint64_t sink; /* prevents the compiler from removing the hash calls */
+
+static void
+print_record (const char *hash, const char *metric, size_t key_bytes, double value)
+{
+  if (!json_output) { printf ("%s,%s,%lu,%.6g\n", hash, metric, key_bytes, value); return; }
+  printf ("%s\n  {\"hash\": \"%s\", \"metric\": \"%s\", \"key_bytes\": %lu, \"value\": %.6g}", first_record ? "" : ",", hash, metric, key_bytes, value);
+  first_record = false;
+}
+
+static inline uint64_t
+output_mask (uint8_t bits)
+{
+  return (bits == 64) ? UINT64_MAX : (1ULL << bits) - 1;
+}
+
+static void
+bench_throughput (crpx_global_t cglob, bench_hash_t *h, const uint8_t *buffer, size_t buffer_size)
+{ // keys slide along the buffer, s.t. they are not always in the same cache lines; each size runs for at least 50ms
+  size_t key_sizes[] = {4, 8, 16, 32, 64, 256, 1024, 4096, 65536, 1UL << 20}, i, j, n_calls, offset;
+  uint64_t x = 0;
+  double elapsed;
+  for (i = 0; i < sizeof (key_sizes) / sizeof (size_t); i++) {
+    size_t len = h->key_bytes ? h->key_bytes : key_sizes[i], stride = CRPX_MAX (len, 64UL);
+    if (h->key_bytes && i) break;
+    n_calls = 0; elapsed = 0.;
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    while (elapsed < 0.05) {
+      for (j = 0, offset = 0; j < 1024; j++) {
+        x ^= h->func (buffer + offset, len, x & 0xff);
+        if ((offset += stride) + len > buffer_size) offset = 0;
+      }
+      n_calls += 1024;
+      elapsed += crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    }
+    print_record (h->name, "throughput_GBps", len, (double) (n_calls * len) / (elapsed * 1.e9));
+  }
+  sink = x;
+}
+
+static void
+bench_latency (__attribute__((unused)) crpx_global_t cglob, bench_hash_t *h)
+{ // the next key depends on the previous hash, thus calls cannot overlap
+  size_t key_sizes[] = {4, 8, 16, 32}, i, j, n = 100000;
+  uint64_t key[4] = {0}, x = 0;
+  double elapsed;
+  for (i = 0; i < 4; i++) {
+    size_t len = h->key_bytes ? h->key_bytes : key_sizes[i];
+    if (h->key_bytes && i) break;
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t start = __rdtsc ();
+    for (j = 0; j < n; j++) { key[0] += x; x = h->func (key, len, 0); }
+    elapsed = (double) (__rdtsc () - start);
+#else
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    for (j = 0; j < n; j++) { key[0] += x; x = h->func (key, len, 0); }
+    elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time) * 1.e9;
+#endif
+    print_record (h->name, "latency_" BENCH_LATENCY_UNIT, len, elapsed / (double) n);
+  }
+  sink = x;
+}
+
+static void
+bench_avalanche (crpx_global_t cglob, bench_hash_t *h)
+{ // flips each input bit of random keys and records which output bits change
+  size_t len = h->key_bytes ? h->key_bytes : 16, n_keys = 2000, i, b, o, in_bits = 8 * len;
+  uint32_t *flips = (uint32_t *) calloc (in_bits * h->out_bits, sizeof (uint32_t));
+  uint64_t key[2], mask = output_mask (h->out_bits), h0, d;
+  double bias, worst = 0., mean = 0.;
+  for (i = 0; i < n_keys; i++) {
+    key[0] = crpx_random_64bits (cglob); key[1] = crpx_random_64bits (cglob);
+    h0 = h->func (key, len, 0) & mask;
+    for (b = 0; b < in_bits; b++) {
+      ((uint8_t *) key)[b >> 3] ^= (uint8_t) (1 << (b & 7));
+      d = (h->func (key, len, 0) & mask) ^ h0;
+      ((uint8_t *) key)[b >> 3] ^= (uint8_t) (1 << (b & 7));
+      for (o = 0; o < h->out_bits; o++) flips[b * h->out_bits + o] += (d >> o) & 1;
+    }
+  }
+  for (i = 0; i < in_bits * h->out_bits; i++) {
+    bias = fabs (2. * (double) flips[i] / (double) n_keys - 1.);
+    mean += bias;
+    if (bias > worst) worst = bias;
+  }
+  print_record (h->name, "avalanche_worst", len, worst);
+  print_record (h->name, "avalanche_mean", len, mean / (double) (in_bits * h->out_bits));
+  free (flips);
+}
+
+static int
+compare_uint64_increasing (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+static double
+bucket_chi2 (const uint64_t *hash, size_t n, uint8_t shift, uint32_t *bucket)
+{
+  size_t i, n_buckets = 1UL << 16;
+  double chi2 = 0., expected = (double) n / (double) n_buckets;
+  memset (bucket, 0, n_buckets * sizeof (uint32_t));
+  for (i = 0; i < n; i++) bucket[(hash[i] >> shift) & 0xffff]++;
+  for (i = 0; i < n_buckets; i++) chi2 += ((double) bucket[i] - expected) * ((double) bucket[i] - expected) / expected;
+  return chi2 / (double) (n_buckets - 1);
+}
+
+static void
+bench_collisions (bench_hash_t *h)
+{ // sequential keys (as 8-byte integers, or at the mixer width) are the typical bad case for weak hashes; 16 bits mixers have 2^16 keys
+  size_t len = h->key_bytes ? h->key_bytes : 8, n = (len < 3) ? 1UL << (8 * len) : 1UL << 20, i, collisions = 0;
+  uint64_t *hash = (uint64_t *) malloc (n * sizeof (uint64_t)), mask = output_mask (h->out_bits);
+  uint32_t *bucket = (uint32_t *) malloc ((1UL << 16) * sizeof (uint32_t));
+  double m = ldexp (1., h->out_bits), expected;
+  for (i = 0; i < n; i++) hash[i] = h->func (&i, len, 0) & mask;
+  print_record (h->name, "bucket_chi2_low", len, bucket_chi2 (hash, n, 0, bucket));
+  print_record (h->name, "bucket_chi2_high", len, bucket_chi2 (hash, n, h->out_bits - 16, bucket));
+  qsort (hash, n, sizeof (uint64_t), compare_uint64_increasing);
+  for (i = 1; i < n; i++) collisions += (hash[i] == hash[i-1]);
+  if ((double) n < m / 64.) expected = (double) n * (double) (n - 1) / (2. * m);
+  else expected = (double) n - m + m * exp ((double) n * log1p (-1. / m));
+  print_record (h->name, "collisions", len, (double) collisions);
+  print_record (h->name, "collisions_expected", len, expected);
+  free (hash);
+  free (bucket);
+}
+
+static void
+bench_all (crpx_global_t cglob, bench_hash_t *h, const uint8_t *buffer, size_t buffer_size, const char *filter)
+{
+  if (filter && !strstr (h->name, filter)) return;
+  bench_throughput (cglob, h, buffer, buffer_size);
+  bench_latency (cglob, h);
+  bench_avalanche (cglob, h);
+  bench_collisions (h);
+  fflush (stdout);
+}
+
+static void
+bench_tree (crpx_global_t cglob, const char *filter)
+{ // scaling of tree hashing with number of threads, over a buffer much larger than the caches
+  const char *names[] = {"metrohash128_v1", "murmurhash3_128bits", "crc32c_seed64", "xxh3_seed64"};
+  size_t i, size = 1UL << 28;
+  int id, n_threads, max_threads = 1, rep;
+  char name[64], metric[64];
+  double elapsed;
+  uint8_t *buffer = (uint8_t *) malloc (size);
+  if (!buffer) return;
+  for (i = 0; i < size; i++) buffer[i] = (uint8_t) (i * 0x9e3779b1U >> 24);
+#ifdef _OPENMP
+  max_threads = omp_get_max_threads ();
+#endif
+  for (i = 0; i < sizeof (names) / sizeof (char*); i++) {
+    snprintf (name, sizeof (name), "tree_%s", names[i]);
+    if ((filter && !strstr (name, filter)) || ((id = crpx_hash_function_id (names[i])) < 0)) continue;
+    for (n_threads = 1; n_threads <= max_threads; n_threads = (n_threads < max_threads && 2 * n_threads > max_threads) ? max_threads : 2 * n_threads) {
+#ifdef _OPENMP
+      omp_set_num_threads (n_threads);
+#endif
+      crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+      for (rep = 0; rep < 4; rep++) sink ^= crpx_hash_tree (cglob, buffer, size, (uint8_t) id, rep, 0);
+      elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+      snprintf (metric, sizeof (metric), "throughput_GBps_%dthreads", n_threads);
+      print_record (name, metric, size, 4. * size / (elapsed * 1.e9));
+      if (n_threads == max_threads) break;
+    }
+  }
+#ifdef _OPENMP
+  omp_set_num_threads (max_threads);
+#endif
+  free (buffer);
+}
+
+static void
+bench_siphash_batch (crpx_global_t cglob, const char *filter)
+{ // keys per second of scalar SipHash against AVX2 lanes
+  size_t i, n = 1UL << 18, *len = (size_t *) malloc (n * sizeof (size_t)), key_bytes[] = {8, 16, 32, 64, 0};
+  const void **ptr = (const void **) malloc (n * sizeof (void *));
+  uint8_t *buf = (uint8_t *) malloc (n * 64);
+  uint64_t *out = (uint64_t *) malloc (n * sizeof (uint64_t)), seed[2] = {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+  double elapsed;
+  char name[64];
+  for (i = 0; i < n * 64; i++) buf[i] = (uint8_t) (i * 0x9e3779b1U >> 24);
+  for (i = 0; i < n; i++) ptr[i] = buf + 64 * i;
+  for (int l = 0; l < 5; l++) for (int sip13 = 0; sip13 < 2; sip13++) { // key_bytes=0 means random lengths up to 64
+    snprintf (name, sizeof (name), "siphash%s_batch", sip13 ? "13" : "24");
+    if (filter && !strstr (name, filter)) continue;
+    for (i = 0; i < n; i++) len[i] = key_bytes[l] ? key_bytes[l] : 1 + crpx_random_range (cglob, 64);
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    crpx_siphash_batch_scalar (ptr, len, n, seed, sip13, out);
+    elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    print_record (name, "scalar_Mkeys_per_s", key_bytes[l], (double) n / (elapsed * 1.e6));
+#ifdef __AVX2__
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    crpx_siphash_batch_avx2 (ptr, len, n, seed, sip13, out);
+    elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    print_record (name, "avx2_Mkeys_per_s", key_bytes[l], (double) n / (elapsed * 1.e6));
+#endif
+    sink ^= out[n-1];
+  }
+  free (len); free (ptr); free (buf); free (out);
+}
+
+static void
+bench_family (crpx_global_t cglob, const char *filter)
+{ // k functions per key from a hash family, against k seeded calls of the default registry hash
+  uint16_t ks[] = {4, 16, 64, 256};
+  size_t i, j, n = 1UL << 14;
+  uint64_t *keys = (uint64_t *) malloc (n * sizeof (uint64_t)), *h64 = (uint64_t *) malloc (n * 256 * sizeof (uint64_t));
+  uint32_t *h32 = (uint32_t *) malloc (n * 256 * sizeof (uint32_t));
+  double elapsed;
+  char name[64];
+  if (filter && !strstr ("hash_family", filter)) { free (keys); free (h32); free (h64); return; }
+  for (i = 0; i < n; i++) keys[i] = crpx_random_64bits (cglob);
+  for (int l = 0; l < 4; l++) {
+    uint16_t k = ks[l];
+    crpx_hash_family_t hf = new_crpx_hash_family (cglob, k);
+    snprintf (name, sizeof (name), "hash_family_k%u", k);
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    for (i = 0; i < n; i++) crpx_hash_family_32bits (hf, keys[i], h32 + i * k);
+    elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    print_record (name, "family_32bits_Mhashes_per_s", 8, (double) (n * k) / (elapsed * 1.e6));
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    for (i = 0; i < n; i++) crpx_hash_family_64bits (hf, keys[i], h64 + i * k);
+    elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    print_record (name, "family_64bits_Mhashes_per_s", 8, (double) (n * k) / (elapsed * 1.e6));
+    crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    for (i = 0; i < n; i++) for (j = 0; j < k; j++) h64[i * k + j] = crpx_hash (cglob, keys + i, sizeof (uint64_t), j);
+    elapsed = crpx_update_elapsed_time_128bits (cglob->elapsed_time);
+    print_record (name, "k_seeded_calls_Mhashes_per_s", 8, (double) (n * k) / (elapsed * 1.e6));
+    sink ^= h32[n * k - 1] ^ h64[n * k - 1];
+    del_crpx_hash_family (hf);
+  }
+  free (keys); free (h32); free (h64);
+}
+
+int main(int argc, char **argv)
+{
+  size_t i, buffer_size = (1UL << 21) + 64;
+  uint8_t *buffer;
+  uint32_t crc;
+  char sse_name[64];
+  const char *filter;
+  int k;
+
+  if (argc == 1) return TEST_SKIPPED;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  json_output = (strcmp (argv[1], "json") == 0);
+  filter = (argc > 2) ? argv[2] : NULL;
+
+  for (i = 0; i < 256; i++) {
+    for (crc = i, k = 0; k < 8; k++) crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+    crc_seed[i] = crc;
+  }
+  crpx_hash_pseudocrc32_expand_seed (crc_seed, crc_table, 16);
+  buffer = (uint8_t *) malloc (buffer_size);
+  for (i = 0; i < buffer_size; i++) buffer[i] = (uint8_t) crpx_random_range (cglob, 256);
+
+  if (json_output) printf ("[");
+  else printf ("hash,metric,key_bytes,value\n");
+  for (i = 0; i < crpx_hash_function_list_size; i++) {
+    const crpx_hash_function_info_t *info = crpx_hash_function_list + i;
+    bench_hash_t h = {info->name, info->func, info->out_bits, 0};
+    bench_all (cglob, &h, buffer, buffer_size, filter);
+    h.name = sse_name;
+    if (info->func_sse42 && cglob->sse) {
+      snprintf (sse_name, sizeof (sse_name), "%s_sse42", info->name);
+      h.func = info->func_sse42;
+      bench_all (cglob, &h, buffer, buffer_size, filter);
+    }
+    if (info->func_avx2 && cglob->avx) {
+      snprintf (sse_name, sizeof (sse_name), "%s_avx2", info->name);
+      h.func = info->func_avx2;
+      bench_all (cglob, &h, buffer, buffer_size, filter);
+    }
+    if (info->func_aesni && cglob->aes) {
+      snprintf (sse_name, sizeof (sse_name), "%s_aesni", info->name);
+      h.func = info->func_aesni;
+      bench_all (cglob, &h, buffer, buffer_size, filter);
+    }
+  }
+  for (i = 0; i < sizeof (hash_list) / sizeof (bench_hash_t); i++) bench_all (cglob, hash_list + i, buffer, buffer_size, filter);
+  bench_tree (cglob, filter);
+  bench_family (cglob, filter);
+  bench_siphash_batch (cglob, filter);
+  if (json_output) printf ("\n]\n");
+
+  free (buffer);
+  crpx_global_finalise (cglob);
+  return TEST_SKIPPED;
+}
@@ -0,0 +1,132 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#include <check.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+START_TEST(bloom_filter_false_positives)
+{
+  uint64_t i, n = 200000, fp = 0;
+  char key[32];
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_bloom_filter_t bf = new_crpx_bloom_filter (cglob, n, 12., 42);
+  ck_assert_msg (bf != NULL, "could not create Bloom filter");
+
+  for (i = 0; i < n; i++) crpx_bloom_filter_insert_uint64 (bf, i);
+  for (i = 0; i < n; i++) ck_assert_msg (crpx_bloom_filter_contains_uint64 (bf, i), "false negative for key %lu", i);
+  for (i = n; i < 11 * n; i++) fp += crpx_bloom_filter_contains_uint64 (bf, i);
+  printf ("Bloom filter 12 bits/key: false positive rate = %lf\n", (double) fp / (double)(10 * n));
+  ck_assert_msg (fp < n / 10, "false positive rate %lf too high", (double) fp / (double)(10 * n));
+
+  crpx_bloom_filter_reset (bf);
+  for (i = 0; i < 1000; i++) { sprintf (key, "key_%lu", i); crpx_bloom_filter_insert_bytes (bf, key, strlen (key)); }
+  for (i = 0; i < 1000; i++) {
+    sprintf (key, "key_%lu", i);
+    ck_assert_msg (crpx_bloom_filter_contains_bytes (bf, key, strlen (key)), "false negative for string %s", key);
+  }
+  del_crpx_bloom_filter (bf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(bloom_filter_parallel_and_batch)
+{
+  uint64_t i, n = 100000, *keys = (uint64_t *) malloc (2 * n * sizeof (uint64_t));
+  bool *result = (bool *) malloc (2 * n * sizeof (bool));
+  size_t found = 0;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_bloom_filter_t b1 = new_crpx_bloom_filter (cglob, n, 10., 7), b2 = new_crpx_bloom_filter (cglob, n, 10., 7);
+
+  for (i = 0; i < 2 * n; i++) keys[i] = crpx_hashint_splitmix64 (i);
+  for (i = 0; i < n; i++) crpx_bloom_filter_insert_uint64 (b1, keys[i]);
+  crpx_bloom_filter_insert_uint64_array (b2, keys, n);
+  ck_assert_msg (memcmp (b1->block, b2->block, b1->n_blocks * 64) == 0, "parallel and serial insertion differ");
+  ck_assert_msg (crpx_bloom_filter_insert_uint64_atomic (b1, keys[0]), "atomic insertion should find existing key");
+
+  found = crpx_bloom_filter_contains_uint64_array (b1, keys, 2 * n, result);
+  for (i = 0; i < 2 * n; i++) ck_assert_msg (result[i] == crpx_bloom_filter_contains_uint64 (b1, keys[i]), "batch and single lookup differ");
+  for (i = 0; i < n; i++) ck_assert_msg (result[i], "false negative in batch lookup");
+  printf ("Bloom filter 10 bits/key: %lu positives out of %lu (%lu inserted)\n", found, 2 * n, n);
+
+  free (keys);
+  free (result);
+  del_crpx_bloom_filter (b1);
+  del_crpx_bloom_filter (b2);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(fuse_filter_build_and_mmap)
+{
+  uint64_t i, n = 300000, fp8 = 0, fp16 = 0, *keys = (uint64_t *) malloc (2 * n * sizeof (uint64_t));
+  bool *result = (bool *) malloc (n * sizeof (bool));
+  char filename[] = "/tmp/check_fuse_filter_XXXXXX";
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+
+  for (i = 0; i < n; i++) keys[i] = crpx_hashint_splitmix64 (i % (n - 1000)); // includes duplicates
+  crpx_fuse_filter_t f8 = new_crpx_fuse_filter (cglob, keys, n, 8), f16 = new_crpx_fuse_filter (cglob, keys, n, 16);
+  ck_assert_msg (f8 && f16, "could not create fuse filters");
+  ck_assert_msg (f8->n_keys == n - 1000, "duplicates not removed: %lu distinct keys", f8->n_keys);
+  for (i = 0; i < n; i++) ck_assert_msg (crpx_fuse_filter_contains (f8, keys[i]) && crpx_fuse_filter_contains (f16, keys[i]), "false negative");
+  for (i = n; i < 2 * n; i++) {
+    fp8  += crpx_fuse_filter_contains (f8,  crpx_hashint_splitmix64 (i));
+    fp16 += crpx_fuse_filter_contains (f16, crpx_hashint_splitmix64 (i));
+  }
+  printf ("Fuse filter: %lf bits/key; false positive rates = %lf (8 bits) and %lf (16 bits)\n",
+          8. * crpx_fuse_filter_size_in_bytes (f8) / (double) f8->n_keys, (double) fp8 / (double) n, (double) fp16 / (double) n);
+  ck_assert_msg (fp8 < n / 100, "false positive rate too high for 8 bits fingerprints");
+  ck_assert_msg (fp16 < n / 10000, "false positive rate too high for 16 bits fingerprints");
+
+  int fd = mkstemp (filename);
+  ck_assert_msg (fd >= 0, "could not create temporary file");
+  close (fd);
+  ck_assert_msg (crpx_fuse_filter_save (f16, filename), "could not save fuse filter");
+  crpx_fuse_filter_t fm = new_crpx_fuse_filter_from_file (cglob, filename);
+  ck_assert_msg (fm != NULL, "could not load fuse filter");
+  for (i = 0; i < n; i++) keys[i] = crpx_hashint_splitmix64 (i + n/2);
+  ck_assert_msg (crpx_fuse_filter_contains_array (fm, keys, n, result) >= n/2 - 1000, "false negatives in mmapped filter");
+  for (i = 0; i < n; i++) ck_assert_msg (result[i] == crpx_fuse_filter_contains (f16, keys[i]), "mmapped filter differs from original");
+
+  unlink (filename);
+  free (keys);
+  free (result);
+  del_crpx_fuse_filter (f8);
+  del_crpx_fuse_filter (f16);
+  del_crpx_fuse_filter (fm);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+Suite * this_suite(void)
+{
+  Suite *s;
+  TCase *tc_case;
+
+  s = suite_create("filters");
+  tc_case = tcase_create("bloom_filter");
+  tcase_add_test(tc_case, bloom_filter_false_positives);
+  tcase_add_test(tc_case, bloom_filter_parallel_and_batch);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("fuse_filter");
+  tcase_add_test(tc_case, fuse_filter_build_and_mmap);
+  suite_add_tcase(s, tc_case);
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  SRunner *sr;
+
+  sr = srunner_create (this_suite());
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed > 0) ? TEST_FAILURE:TEST_SUCCESS;
+}
@@ -65,6 +65,279 @@ START_TEST(combination)
 }
 END_TEST
 
+START_TEST(crc32c_kernels)
+{
+  size_t i, len, n = 5000000;
+  uint8_t *buf = (uint8_t *) malloc (n);
+  uint32_t crc, crc1, crc2;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  for (i = 0; i < n; i++) buf[i] = (uint8_t) crpx_random_range (cglob, 256);
+
+  ck_assert_msg (crpx_crc32c (cglob, "123456789", 9, 0) == 0xe3069283, "wrong CRC32C check value");
+  for (len = 0; len < 20000; len = len * 2 + 1 + (len & 7)) for (i = 0; i < 8; i++) { // unaligned starts and odd lengths
+    crc = crpx_crc32c_table (buf + i, len, 0);
+    ck_assert_msg (crpx_crc32c (cglob, buf + i, len, 0) == crc, "CRC32C kernels differ for length %lu", len);
+    ck_assert_msg (crpx_crc32c_seed64_table (buf + i, len, len) == crpx_hash_crc32c_seed64 (cglob, buf + i, len, len), "seeded CRC32C kernels differ");
+    crc1 = crpx_crc32c (cglob, buf + i, len / 3, 0);
+    crc2 = crpx_crc32c (cglob, buf + i + len / 3, len - len / 3, 0);
+    ck_assert_msg (crpx_crc32c (cglob, buf + i + len / 3, len - len / 3, crc1) == crc, "chained CRC32C differs");
+    ck_assert_msg (crpx_crc32c_combine (crc1, crc2, len - len / 3) == crc, "combined CRC32C differs for length %lu", len);
+  }
+  crc = crpx_crc32c (cglob, buf, n, 0);
+  ck_assert_msg (crpx_crc32c_parallel (cglob, buf, n, 0) == crc, "parallel CRC32C differs");
+  ck_assert_msg (crpx_hash_crc32c_seed64 (cglob, buf, 64, 1) != crpx_hash_crc32c_seed64 (cglob, buf, 64, 2), "seed has no effect");
+  printf ("CRC32C of %lu random bytes: %08x (SSE4.2 %s)\n", n, crc, cglob->sse ? "enabled" : "disabled");
+  free (buf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(table_hashes)
+{
+  size_t i, len;
+  uint64_t pearson[4] = {0xffffffffe4a49cecULL, 0xffffffffe4a43cacULL, 0x0000000014748424ULL, 0xffffffffbccc34f4ULL}, lens[4] = {1, 7, 16, 43};
+  uint32_t seed[256], crc, *expanded = (uint32_t *) malloc (16 * 256 * sizeof (uint32_t));
+  uint8_t pearson_seed[256], buf[1000];
+  const char *key = "the quick brown fox jumps over the lazy dog";
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+
+  for (i = 0; i < 256; i++) pearson_seed[i] = (uint8_t) (i * 167 + 13);
+  for (i = 0; i < 4; i++) ck_assert_msg (crpx_hash_pearson_seed2048 (key, lens[i], pearson_seed) == pearson[i], "Pearson hash changed for length %lu", lens[i]);
+
+  for (i = 0; i < 1000; i++) buf[i] = (uint8_t) crpx_random_range (cglob, 256);
+  for (i = 0; i < 256; i++) seed[i] = crpx_random_range (cglob, 0xffffffff);
+  ck_assert_msg (!crpx_hash_pseudocrc32_expand_seed (seed, expanded, 16), "random seed should not be linear");
+  for (i = 0; i < 256; i++) for (crc = i, len = 0; len < 8; len++) seed[i] = crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+  ck_assert_msg (crpx_hash_pseudocrc32_expand_seed (seed, expanded, 16), "CRC32C table should be linear");
+  for (len = 0; len < 1000; len += 1 + len / 4) {
+    crc = crpx_hash_pseudocrc32_seed8192 (buf, len, seed, 0);
+    ck_assert_msg (crc == crpx_crc32c (cglob, buf, len, 0), "pseudocrc32 with CRC32C table should be CRC32C");
+    ck_assert_msg (crc == crpx_hash_pseudocrc32_slicing8_seed65536 (buf, len, expanded, 0), "slicing-by-8 differs for length %lu", len);
+    ck_assert_msg (crc == crpx_hash_pseudocrc32_slicing16_seed131072 (buf, len, expanded, 0), "slicing-by-16 differs for length %lu", len);
+  }
+  free (expanded);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(wyhash_vectors)
+{ // test vectors from wyhash final v4, with seed equal to index
+  const char *msg[] = {"", "a", "abc", "message digest", "abcdefghijklmnopqrstuvwxyz",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+    "12345678901234567890123456789012345678901234567890123456789012345678901234567890"};
+  uint64_t expected[] = {0x93228a4de0eec5a2ULL, 0xc5bac3db178713c4ULL, 0xa97f2f7b1d9b3314ULL, 0x786d1f1df3801df4ULL,
+    0xdca5a8138ad37c87ULL, 0xb9e734f117cfaf70ULL, 0x6cc5eab49a92d617ULL};
+  uint64_t a = 0x9e3779b97f4a7c15ULL, b = 3;
+  for (int i = 0; i < 7; i++) ck_assert_msg (crpx_wyhash64_seed64 (msg[i], strlen (msg[i]), i) == expected[i], "wyhash of \"%s\" differs from reference", msg[i]);
+  crpx_mul128 (&a, &b);
+  ck_assert_msg (a == 0xdaa66d2c7ddf743fULL && b == 1, "128 bits product is wrong");
+  ck_assert_msg (crpx_mumhash64_mixer (1ULL << 63, 4) == 2 && crpx_wyhash64_mixer (0xffffffffffffffffULL, 0xffffffffffffffffULL) == (1ULL ^ 0xfffffffffffffffeULL), "mixers disagree with 128 bits product");
+}
+END_TEST
+
+START_TEST(xxh3_kernels)
+{
+  size_t i, len, n = 5000;
+  uint64_t x, seed, out[2], out_simd[2];
+  uint8_t *buf = (uint8_t *) malloc (n);
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  for (i = 0; i < n; i++) buf[i] = (uint8_t) crpx_random_64bits (cglob);
+
+  for (len = 0; len < n; len += (len < 300) ? 1 : 97) {
+    seed = (len & 3) ? crpx_random_64bits (cglob) : 0;
+    x = crpx_xxh3_seed64_scalar (buf, len, seed, out);
+    ck_assert_msg (x == out[0] && x != out[1], "128 bits output should extend the 64 bits one (len=%lu)", len);
+    ck_assert_msg (crpx_hash_xxh3_seed64 (cglob, buf, len, seed, NULL) == x, "dispatcher differs from scalar (len=%lu)", len);
+#ifdef __SSE4_2__
+    ck_assert_msg (crpx_xxh3_seed64_sse42 (buf, len, seed, out_simd) == x && out_simd[1] == out[1], "SSE2 kernel differs (len=%lu)", len);
+#endif
+#ifdef __AVX2__
+    if (cglob->avx) ck_assert_msg (crpx_xxh3_seed64_avx2 (buf, len, seed, out_simd) == x && out_simd[1] == out[1], "AVX2 kernel differs (len=%lu)", len);
+#endif
+    if (len > 300) {
+      buf[len / 2] ^= 1;
+      ck_assert_msg (crpx_xxh3_seed64_scalar (buf, len, seed, NULL) != x, "flipping one bit did not change the hash (len=%lu)", len);
+      buf[len / 2] ^= 1;
+    }
+  }
+  (void) out_simd;
+  free (buf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(aes_kernels)
+{
+  size_t i, len, n = 4200;
+  uint64_t x, seed[2];
+  uint8_t *buf = (uint8_t *) malloc (n);
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  for (i = 0; i < n; i++) buf[i] = (uint8_t) crpx_random_64bits (cglob);
+  crpx_generate_bytesized_random_seeds_from_cpu (cglob, seed, sizeof (seed));
+
+  for (len = 0; len < n; len += (len < 200) ? 1 : 61) {
+    x = crpx_aeshash_seed128_soft (buf, len, seed);
+    ck_assert_msg (crpx_hash_aes_seed128 (cglob, buf, len, seed) == x, "dispatcher differs from software AES (len=%lu)", len);
+#ifdef __AES__
+    if (cglob->aes) ck_assert_msg (crpx_aeshash_seed128_aesni (buf, len, seed) == x, "AES-NI kernel differs (len=%lu)", len);
+#endif
+    for (i = 0; i < len; i += 1 + len / 5) { // every byte should influence the hash
+      buf[i] ^= 0x10;
+      ck_assert_msg (crpx_hash_aes_seed128 (cglob, buf, len, seed) != x, "flipping byte %lu did not change the hash (len=%lu)", i, len);
+      buf[i] ^= 0x10;
+    }
+    if (len) ck_assert_msg (crpx_hash_aes_seed128 (cglob, buf, len - 1, seed) != x, "hash of prefix is the same (len=%lu)", len);
+  }
+  free (buf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(siphash_batch)
+{ // reference vectors from https://github.com/veorq/SipHash (key 00..0f, message 00..len-1)
+  size_t i, n = 10007, len[10007];
+  uint8_t msg[64], key[16], *buf = (uint8_t *) malloc (n * 70);
+  const void *ptr[10007];
+  uint64_t x, h24[10007], h13[10007];
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  for (i = 0; i < 64; i++) msg[i] = (uint8_t) i;
+  for (i = 0; i < 16; i++) key[i] = (uint8_t) i;
+  ck_assert_msg (crpx_siphash64_seed128 (msg, 0, key) == 0x726fdb47dd0e0e31ULL, "SipHash-2-4 of empty message differs from reference");
+  ck_assert_msg (crpx_siphash64_seed128 (msg, 1, key) == 0x74f839c593dc67fdULL, "SipHash-2-4 of one byte differs from reference");
+  ck_assert_msg (crpx_siphash64_seed128 (msg, 63, key) == 0x958a324ceb064572ULL, "SipHash-2-4 of 63 bytes differs from reference");
+
+  for (i = 0; i < n * 70; i++) buf[i] = (uint8_t) crpx_random_64bits (cglob);
+  for (i = 0; i < n; i++) { // equal lengths in the first half, then varying ones
+    ptr[i] = buf + 70 * i;
+    len[i] = (i < n/2) ? 24 : crpx_random_range (cglob, 70);
+  }
+  crpx_hash_siphash_batch (cglob, ptr, len, n, key, false, h24);
+  crpx_hash_siphash_batch (cglob, ptr, len, n, key, true, h13);
+  for (i = 0; i < n; i++) {
+    ck_assert_msg (h24[i] == crpx_siphash64_seed128 (ptr[i], len[i], key), "batch SipHash-2-4 differs (len=%lu)", len[i]);
+    ck_assert_msg (h13[i] == crpx_siphash13_seed128 (ptr[i], len[i], key), "batch SipHash-1-3 differs (len=%lu)", len[i]);
+  }
+  for (i = 0; i < 40; i++) { // AVX2 kernel, including groups with keys of different lengths and incomplete groups
+    crpx_siphash_batch_scalar (ptr + n/2 - 5, len + n/2 - 5, i, key, i & 1, h24);
+#ifdef __AVX2__
+    if (cglob->avx) crpx_siphash_batch_avx2 (ptr + n/2 - 5, len + n/2 - 5, i, key, i & 1, h13);
+    for (x = 0; cglob->avx && (x < i); x++) ck_assert_msg (h13[x] == h24[x], "AVX2 SipHash kernel differs");
+#endif
+  }
+  for (i = 0; i < 64; i++) { ((char *) buf)[i] = 'a' + (i % 26); ptr[i] = buf + i; }
+  buf[64] = '\0';
+  crpx_hash_siphash_batch (cglob, ptr, NULL, 64, key, false, h24); // null-terminated strings
+  for (i = 0; i < 64; i++) ck_assert_msg (h24[i] == crpx_siphash64_seed128 (ptr[i], 64 - i, key), "SipHash of strings differs");
+  free (buf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(tree_hash)
+{
+  size_t i, n = (5UL << 20) + 12345;
+  uint64_t x, y;
+  uint8_t *buf = (uint8_t *) malloc (n);
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  int id = crpx_hash_function_id ("metrohash128_v1");
+  for (i = 0; i < n; i++) buf[i] = (uint8_t) (i * 0x9e3779b1U >> 24);
+
+  x = crpx_hash_tree (cglob, buf, n, id, 7, 0);
+#ifdef _OPENMP
+  int nthreads = omp_get_max_threads ();
+  omp_set_num_threads (1);
+  ck_assert_msg (crpx_hash_tree (cglob, buf, n, id, 7, 0) == x, "tree hash depends on number of threads");
+  omp_set_num_threads (3);
+  ck_assert_msg (crpx_hash_tree (cglob, buf, n, id, 7, 0) == x, "tree hash depends on number of threads");
+  omp_set_num_threads (nthreads);
+#endif
+  ck_assert_msg (crpx_hash_tree (cglob, buf, n, id, 7, CRPX_HASH_TREE_CHUNK) == x, "default chunk size is not CRPX_HASH_TREE_CHUNK");
+  ck_assert_msg (crpx_hash_tree (cglob, buf, n, id, 8, 0) != x, "seed has no effect on tree hash");
+  ck_assert_msg (crpx_hash_tree (cglob, buf, n - 1, id, 7, 0) != x, "prefix has same tree hash");
+  buf[3UL << 20] ^= 1;
+  ck_assert_msg (crpx_hash_tree (cglob, buf, n, id, 7, 0) != x, "flipping one bit in a middle chunk did not change the tree hash");
+  y = crpx_hash_tree (cglob, buf, 100, crpx_hash_function_id ("crc32c_seed64"), 7, 0); // single chunk
+  ck_assert_msg (y == crpx_hash_tree (cglob, buf, 100, crpx_hash_function_id ("crc32c_seed64"), 7, 4096), "single chunk hash depends on chunk size");
+  ck_assert_msg (crpx_hash_tree (cglob, buf, 0, id, 7, 0) != crpx_hash_tree (cglob, buf, 0, id, 8, 0), "empty buffer should depend on seed");
+  free (buf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(hash_family)
+{
+  uint16_t k = 13, i, j;
+  size_t n = 20000, l, bucket[2][16] = {{0}};
+  uint64_t *keys = (uint64_t *) malloc (n * sizeof (uint64_t)), *h64 = (uint64_t *) malloc (n * k * sizeof (uint64_t)), x64[13];
+  uint32_t *h32 = (uint32_t *) malloc (n * k * sizeof (uint32_t)), x32[13], sig[2][13];
+  double chi2;
+  bool has_avx;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hash_family_t hf = new_crpx_hash_family (cglob, k);
+  ck_assert_msg (hf != NULL, "could not create hash family");
+  for (l = 0; l < n; l++) keys[l] = l * 2; // structured keys
+
+  crpx_hash_family_32bits_array (hf, keys, n, h32);
+  crpx_hash_family_64bits_array (hf, keys, n, h64);
+  for (l = 0; l < n; l++) {
+    uint64_t x_hi = keys[l] >> 32, x_lo = keys[l] & 0xffffffff;
+    __uint128_t A = ((__uint128_t) hf->a1[l % k] << 64) | hf->a0[l % k], B = ((__uint128_t) hf->b1[l % k] << 64) | hf->b0[l % k];
+    crpx_hash_family_32bits (hf, keys[l], x32);
+    crpx_hash_family_64bits (hf, keys[l], x64);
+    ck_assert_msg (!memcmp (x32, h32 + l * k, k * sizeof (uint32_t)) && !memcmp (x64, h64 + l * k, k * sizeof (uint64_t)), "batch differs from single key");
+    ck_assert_msg (x32[l % k] == (uint32_t) (((hf->a0[l % k] + x_hi) * (hf->a1[l % k] + x_lo) + hf->b1[l % k]) >> 32), "32 bits hash differs from definition");
+    ck_assert_msg (x64[l % k] == (uint64_t) ((A * keys[l] + B) >> 64), "64 bits hash differs from definition");
+    for (i = 0; i < 2; i++) bucket[0][(x32[i] >> 28) ^ ((x32[i + 1] >> 24) & 0xc)]++; // joint distribution of two functions
+    for (i = 0; i < 2; i++) bucket[1][(x64[i] >> 60) ^ ((x64[i + 1] >> 56) & 0xc)]++;
+  }
+  has_avx = cglob->avx;
+  crpx_hash_family_minhash (hf, keys, n, sig[0]);
+  cglob->avx = 0; // scalar and vector minima must agree (k = 13 is not a multiple of 4)
+  crpx_hash_family_minhash (hf, keys, n, sig[1]);
+  cglob->avx = has_avx;
+  for (i = 0; i < k; i++) {
+    for (x32[i] = UINT32_MAX, l = 0; l < n; l++) if (h32[l * k + i] < x32[i]) x32[i] = h32[l * k + i];
+    ck_assert_msg ((sig[0][i] == x32[i]) && (sig[1][i] == x32[i]), "minhash differs from minimum of function %u", i);
+  }
+  for (i = 0; i < 2; i++) {
+    for (chi2 = 0., j = 0; j < 16; j++) chi2 += ((double) bucket[i][j] - 2. * n / 16.) * ((double) bucket[i][j] - 2. * n / 16.) / (2. * n / 16.);
+    ck_assert_msg (chi2 < 50., "hash values of family are not uniform (chi2 = %lf for %d bits)", chi2, i ? 64 : 32);
+  }
+  free (keys); free (h32); free (h64);
+  del_crpx_hash_family (hf);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(hash_registry)
+{
+  uint8_t key[100];
+  int id;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  for (int i = 0; i < 100; i++) key[i] = (uint8_t) (i * 31 + 7);
+
+  ck_assert_msg (strcmp (cglob->hash_name, "0.metrohash64_v1") == 0, "default hash should be metrohash64_v1, not %s", cglob->hash_name);
+  for (id = 0; id < crpx_hash_function_list_size; id++) {
+    const crpx_hash_function_info_t *h = crpx_hash_function_list + id;
+    ck_assert_msg (crpx_hash_function_id (h->name) == id, "lookup of %s failed", h->name);
+    crpx_set_hash_function (cglob, id);
+    for (size_t len = 2; len < 100; len += 7) {
+      uint64_t x = h->func (key, len, 42);
+      ck_assert_msg (crpx_hash (cglob, key, len, 42) == x, "registry hash %s differs from selected one", h->name);
+      ck_assert_msg ((h->out_bits == 64) || (x >> h->out_bits) == 0, "hash %s has more than %u bits", h->name, h->out_bits);
+      if (h->seeded) ck_assert_msg (h->func (key, len, 43) != x, "seed has no effect on %s", h->name);
+      if (h->func_sse42 && cglob->sse) ck_assert_msg (h->func_sse42 (key, len, 42) == x, "SSE4.2 kernel of %s differs", h->name);
+      if (h->func_avx2 && cglob->avx) ck_assert_msg (h->func_avx2 (key, len, 42) == x, "AVX2 kernel of %s differs", h->name);
+      if (h->func_aesni && cglob->aes) ck_assert_msg (h->func_aesni (key, len, 42) == x, "AES-NI kernel of %s differs", h->name);
+    }
+  }
+  ck_assert_msg (crpx_hash_function_id ("no_such_hash") == -1, "unknown hash name should return -1");
+  crpx_set_hash_function (cglob, crpx_hash_function_id ("crc32c_seed64"));
+  ck_assert_msg (crpx_hash (cglob, key, 100, 1) == crpx_hash_crc32c_seed64 (cglob, key, 100, 1), "crc32c from registry differs");
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
 Suite * this_suite(void)
 {
   Suite *s;
@@ -78,6 +351,17 @@ Suite * this_suite(void)
   tc_case = tcase_create("maths and bits");
   tcase_add_test(tc_case, combination);
   suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("byte hashes");
+  tcase_add_test(tc_case, crc32c_kernels);
+  tcase_add_test(tc_case, table_hashes);
+  tcase_add_test(tc_case, wyhash_vectors);
+  tcase_add_test(tc_case, xxh3_kernels);
+  tcase_add_test(tc_case, aes_kernels);
+  tcase_add_test(tc_case, hash_registry);
+  tcase_add_test(tc_case, tree_hash);
+  tcase_add_test(tc_case, siphash_batch);
+  tcase_add_test(tc_case, hash_family);
+  suite_add_tcase(s, tc_case);
   return s;
 }
 
@@ -0,0 +1,213 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#include <check.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+START_TEST(hashtable_insert_erase)
+{
+  uint64_t i, key, value, iter = 0, n = 100000, sum = 0;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hashtable_t ht = new_crpx_hashtable (cglob, 0, NULL);
+  ck_assert_msg (ht != NULL, "could not create hash table");
+  printf ("Hash table with groups of %u slots\n", ht->group_width);
+
+  for (i = 0; i < n; i++) ck_assert_msg (crpx_hashtable_insert (ht, i * 3, i), "key %lu should be new", i * 3);
+  ck_assert_msg (!crpx_hashtable_insert (ht, 0, 10), "key 0 should not be new");
+  ck_assert_msg (ht->size == n, "table should have %lu keys, not %lu", n, ht->size);
+  for (i = 0; i < n; i += 2) ck_assert_msg (crpx_hashtable_erase (ht, i * 3), "could not erase key %lu", i * 3);
+  for (i = 0; i < 3 * n; i++) {
+    bool present = crpx_hashtable_lookup (ht, i, &value);
+    ck_assert_msg (present == ((i % 3 == 0) && ((i / 3) % 2 == 1)), "wrong lookup for key %lu", i);
+    if (present) ck_assert_msg (value == i / 3, "wrong value for key %lu", i);
+  }
+  for (i = 0; i < n; i++) (*crpx_hashtable_get_or_insert (ht, i * 3))++; // erased keys are inserted with count zero
+  while (crpx_hashtable_next (ht, &iter, &key, &value)) sum += value;
+  ck_assert_msg (sum == n + (n / 2) * (n / 2), "wrong sum of values over table: %lu", sum);
+  del_crpx_hashtable (ht);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(hashtable_bulk_and_widths)
+{
+  uint64_t i, n = 1000000, *keys = (uint64_t *) malloc (n * sizeof (uint64_t)), *values = (uint64_t *) malloc (n * sizeof (uint64_t));
+  size_t found;
+  double t0;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hashtable_t ht = new_crpx_hashtable (cglob, n / 4, crpx_hashint_nasam64);
+
+  for (i = 0; i < n; i++) keys[i] = i % (n / 4); // each key appears 4 times
+  ck_assert_msg (crpx_hashtable_insert_array (ht, keys, NULL, n), "bulk insertion failed");
+  ck_assert_msg (ht->size == n / 4, "table should have %lu keys, not %lu", n / 4, ht->size);
+  for (i = 0; i < n; i++) keys[i] = crpx_hashint_splitmix64 (i) % (n / 2); // half are present
+  t0 = (double) clock();
+  for (int rep = 0; rep < 10; rep++) found = crpx_hashtable_lookup_array (ht, keys, n, values, NULL);
+  printf ("Hash table bulk lookup: %.1lf million lookups per second\n", 10. * n / (((double) clock() - t0) / CLOCKS_PER_SEC) / 1.e6);
+  for (i = 0; i < n; i++) ck_assert_msg (values[i] == ((keys[i] < n / 4) ? 4 : 0), "wrong count for key %lu", keys[i]);
+
+  for (uint8_t width = 8; width <= 32; width *= 2) { // same table with other group widths, when available
+    crpx_hashtable_t h2 = new_crpx_hashtable (cglob, 0, crpx_hashint_nasam64);
+    if ((width == 16 && !cglob->sse) || (width == 32 && !cglob->avx)) { del_crpx_hashtable (h2); continue; }
+    h2->group_width = width;
+    for (i = 0; i < n; i++) crpx_hashtable_insert (h2, keys[i], keys[i] + 1);
+    ck_assert_msg (crpx_hashtable_lookup_array (h2, keys, n, values, NULL) == n, "keys missing for group width %u", width);
+    for (i = 0; i < n; i++) ck_assert_msg (values[i] == keys[i] + 1, "wrong value for group width %u", width);
+    del_crpx_hashtable (h2);
+  }
+  ck_assert_msg (found > n / 3, "too few keys found");
+
+  free (keys);
+  free (values);
+  del_crpx_hashtable (ht);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(concurrent_map_parallel_counts)
+{
+  uint64_t i, n = 2000000, key, iter = 0, sum = 0, *keys = (uint64_t *) malloc (n * sizeof (uint64_t));
+  uint32_t count;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_concurrent_map_t map = new_crpx_concurrent_map (cglob, 1000);
+  ck_assert_msg (map != NULL, "could not create concurrent map");
+
+  for (i = 0; i < n; i++) keys[i] = (i % 7) ? i % 1000 : 0; // key zero is frequent
+  keys[n-1] = UINT64_MAX; // special key, stored outside table
+  ck_assert_msg (crpx_concurrent_map_add_array (map, keys, n), "concurrent map should not be full");
+  while (crpx_concurrent_map_next (map, &iter, &key, &count)) sum += count;
+  ck_assert_msg (sum == n, "sum of counters %lu differs from number of keys %lu", sum, n);
+  ck_assert_msg (crpx_concurrent_map_get (map, UINT64_MAX) == 1, "wrong count for key UINT64_MAX");
+  for (count = 0, i = 0; i < n - 1; i++) count += (keys[i] == 6);
+  ck_assert_msg (crpx_concurrent_map_get (map, 6) == count, "wrong count for key 6");
+
+  for (i = 0; i < n; i++) keys[i] = i; // more keys than capacity
+  ck_assert_msg (!crpx_concurrent_map_add_array (map, keys, n), "concurrent map should be full");
+  ck_assert_msg (map->size <= map->max_size + (uint64_t) cglob->nthreads, "too many keys in map: %lu", map->size);
+  ck_assert_msg (crpx_concurrent_map_resize (map, n + 1000), "could not resize map");
+  ck_assert_msg (crpx_concurrent_map_add_array (map, keys, n), "resized map should not be full");
+  ck_assert_msg (crpx_concurrent_map_get (map, 6) == count + 2, "wrong count for key 6 after resize"); // existing keys are updated even when map is full
+
+  free (keys);
+  del_crpx_concurrent_map (map);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(perfect_hash_build_and_mmap)
+{
+  uint64_t i, n = 500000, n_unique = n - 1000, *keys = (uint64_t *) malloc (n * sizeof (uint64_t)), *index = (uint64_t *) malloc (n * sizeof (uint64_t));
+  uint8_t *seen = (uint8_t *) calloc (n, sizeof (uint8_t));
+  char filename[] = "/tmp/check_perfect_hash_XXXXXX";
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+
+  for (i = 0; i < n; i++) keys[i] = crpx_hashint_splitmix64 (i % n_unique); // includes duplicates
+  crpx_perfect_hash_t p1 = new_crpx_perfect_hash (cglob, keys, n, 1., 1), p2 = new_crpx_perfect_hash (cglob, keys, n, 0., 2);
+  ck_assert_msg (p1 && p2, "could not create minimal perfect hash functions");
+  ck_assert_msg (p1->n_keys == n_unique && p2->n_keys == n_unique, "duplicates not removed: %lu and %lu distinct keys", p1->n_keys, p2->n_keys);
+  printf ("Minimal perfect hash: %lf bits/key (gamma=1, %u levels) and %lf bits/key (gamma=2, %u levels)\n",
+          8. * crpx_perfect_hash_size_in_bytes (p1) / (double) n_unique, p1->n_levels, 8. * crpx_perfect_hash_size_in_bytes (p2) / (double) n_unique, p2->n_levels);
+  for (i = 0; i < n_unique; i++) {
+    uint64_t x = crpx_perfect_hash_lookup (p1, keys[i]);
+    ck_assert_msg (x < n_unique && !seen[x], "index %lu of key %lu is out of range or repeated", x, i);
+    seen[x] = 1;
+  }
+  for (i = n_unique; i < n; i++) ck_assert_msg (crpx_perfect_hash_lookup (p1, keys[i]) == crpx_perfect_hash_lookup (p1, keys[i - n_unique]), "duplicate key has distinct index");
+  ck_assert_msg (8 * crpx_perfect_hash_size_in_bytes (p1) < 4 * n_unique, "too many bits per key with gamma=1");
+#ifdef _OPENMP
+  int nthreads = omp_get_max_threads ();
+  omp_set_num_threads (1);
+  crpx_perfect_hash_t p3 = new_crpx_perfect_hash (cglob, keys, n, 1., 1);
+  omp_set_num_threads (nthreads);
+  for (i = 0; i < n; i += 7) ck_assert_msg (crpx_perfect_hash_lookup (p3, keys[i]) == crpx_perfect_hash_lookup (p1, keys[i]), "result depends on number of threads");
+  del_crpx_perfect_hash (p3);
+#endif
+
+  int fd = mkstemp (filename);
+  ck_assert_msg (fd >= 0, "could not create temporary file");
+  close (fd);
+  ck_assert_msg (crpx_perfect_hash_save (p2, filename), "could not save minimal perfect hash");
+  crpx_perfect_hash_t pm = new_crpx_perfect_hash_from_file (cglob, filename);
+  ck_assert_msg (pm != NULL, "could not load minimal perfect hash");
+  crpx_perfect_hash_lookup_array (pm, keys, n, index);
+  for (i = 0; i < n; i++) ck_assert_msg (index[i] == crpx_perfect_hash_lookup (p2, keys[i]) && index[i] < n_unique, "mmapped function differs from original");
+
+  ck_assert_msg (p2->n_levels > 1, "test needs more than one level");
+  fd = open (filename, O_RDWR); // corrupt file: level 0 ends after the last level, but file size is unchanged
+  i = p2->level_start[p2->n_levels] + 1;
+  ck_assert_msg ((fd >= 0) && (pwrite (fd, &i, sizeof (uint64_t), 7 * sizeof (uint64_t)) == sizeof (uint64_t)), "could not modify file");
+  close (fd);
+  ck_assert_msg (new_crpx_perfect_hash_from_file (cglob, filename) == NULL, "file with invalid levels accepted");
+
+  unlink (filename);
+  free (keys);
+  free (index);
+  free (seen);
+  del_crpx_perfect_hash (p1);
+  del_crpx_perfect_hash (p2);
+  del_crpx_perfect_hash (pm);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(perfect_hash_duplicated_keys)
+{ // every key appears twice, thus all keys collide with themselves at the first attempt
+  uint64_t i, n_unique = 200000, *keys = (uint64_t *) malloc (2 * n_unique * sizeof (uint64_t));
+  uint8_t *seen = (uint8_t *) calloc (n_unique, sizeof (uint8_t));
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+
+  for (i = 0; i < 2 * n_unique; i++) keys[i] = crpx_hashint_splitmix64 (i / 2);
+  crpx_perfect_hash_t ph = new_crpx_perfect_hash (cglob, keys, 2 * n_unique, 1., 3);
+  ck_assert_msg (ph != NULL, "could not create minimal perfect hash function");
+  ck_assert_msg (ph->n_keys == n_unique, "%lu distinct keys instead of %lu", ph->n_keys, n_unique);
+  ck_assert_msg (ph->n_fallback < n_unique / 1000, "%lu of %lu keys in fallback table", ph->n_fallback, n_unique);
+  ck_assert_msg (8 * crpx_perfect_hash_size_in_bytes (ph) < 4 * n_unique, "too many bits per key: %lf", 8. * crpx_perfect_hash_size_in_bytes (ph) / (double) n_unique);
+  for (i = 0; i < 2 * n_unique; i += 2) {
+    uint64_t x = crpx_perfect_hash_lookup (ph, keys[i]);
+    ck_assert_msg (x < n_unique && !seen[x] && (x == crpx_perfect_hash_lookup (ph, keys[i + 1])), "index %lu of key %lu is out of range or repeated", x, i);
+    seen[x] = 1;
+  }
+  free (keys);
+  free (seen);
+  del_crpx_perfect_hash (ph);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+Suite * this_suite(void)
+{
+  Suite *s;
+  TCase *tc_case;
+
+  s = suite_create("hashtables");
+  tc_case = tcase_create("swiss_table");
+  tcase_add_test(tc_case, hashtable_insert_erase);
+  tcase_add_test(tc_case, hashtable_bulk_and_widths);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("concurrent_map");
+  tcase_add_test(tc_case, concurrent_map_parallel_counts);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("perfect_hash");
+  tcase_add_test(tc_case, perfect_hash_build_and_mmap);
+  tcase_add_test(tc_case, perfect_hash_duplicated_keys);
+  suite_add_tcase(s, tc_case);
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  SRunner *sr;
+
+  sr = srunner_create (this_suite());
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed > 0) ? TEST_FAILURE:TEST_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#include <check.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+static char **
+random_dna_sequences (crpx_global_t cglob, size_t n_seqs, size_t len)
+{ // sequences share segments, s.t. some k-mers are repeated
+  char **seq = (char **) malloc (n_seqs * sizeof (char *));
+  for (size_t i = 0; i < n_seqs; i++) {
+    seq[i] = (char *) malloc (len + 1);
+    for (size_t j = 0; j < len; j++) seq[i][j] = "ACGTN"[ (i && (j < len / 4)) ? (seq[0][j] == 'N' ? 0 : j & 3) : crpx_random_range (cglob, 5) ];
+    seq[i][len] = '\0';
+  }
+  return seq;
+}
+
+static void
+store_counts (const uint64_t *kmer, const uint32_t *count, size_t n, void *data)
+{
+  crpx_hashtable_t ht = (crpx_hashtable_t) data;
+  for (size_t i = 0; i < n; i++) ck_assert_msg (crpx_hashtable_insert (ht, kmer[i], count[i]), "k-mer reported twice");
+}
+
+START_TEST(kmer_encoding_reverse_complement)
+{
+  const char *seq = "ACGTTGCAAGGCTTAACCGGNACGTACGATCGATCGATTTGACCA";
+  char str[33], rc[33];
+  uint64_t kmers[64], fw[64];
+  size_t n, i, len = strlen (seq);
+  for (uint8_t k = 1; k <= 32; k += 3) {
+    n = crpx_kmer_encode_sequence (seq, len, k, true, kmers);
+    crpx_kmer_encode_sequence (seq, len, k, false, fw);
+    for (i = 0; i < n; i++) {
+      ck_assert_msg (kmers[i] == crpx_kmer_canonical (fw[i], k), "canonical k-mer differs for k=%u", k);
+      ck_assert_msg (crpx_kmer_reverse_complement (crpx_kmer_reverse_complement (fw[i], k), k) == fw[i], "rev. complement not involutive");
+      crpx_kmer_to_string (fw[i], k, str);
+      crpx_kmer_to_string (crpx_kmer_reverse_complement (fw[i], k), k, rc);
+      for (int j = 0; j < k; j++) ck_assert_msg (rc[j] == "TGCA"[crpx_dna_2bit_code[(uint8_t) str[k-j-1]]], "wrong reverse complement %s of %s", rc, str);
+    }
+  }
+}
+END_TEST
+
+START_TEST(kmer_counter_disk_partitions)
+{
+  size_t i, j, n_seqs = 200, len = 2000, n;
+  uint64_t key, value, iter = 0, *kmers = (uint64_t *) malloc (len * sizeof (uint64_t)), expected = 0;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  char **seq = random_dna_sequences (cglob, n_seqs, len);
+  crpx_hashtable_t ht_direct = new_crpx_hashtable (cglob, 0, NULL), ht_disk = new_crpx_hashtable (cglob, 0, NULL);
+  crpx_kmer_counter_t kc = new_crpx_kmer_counter (cglob, 21, 16, 1 << 22, NULL); // 4MB budget
+
+  ck_assert_msg (kc != NULL, "could not create k-mer counter");
+  for (i = 0; i < n_seqs; i++) {
+    n = crpx_kmer_encode_sequence (seq[i], len, 21, true, kmers);
+    for (j = 0; j < n; j++) (*crpx_hashtable_get_or_insert (ht_direct, kmers[j]))++;
+  }
+  ck_assert_msg (crpx_kmer_counter_add_sequences (kc, seq, NULL, n_seqs), "could not add sequences to k-mer counter");
+  ck_assert_msg (crpx_kmer_counter_count (kc, 2, store_counts, ht_disk), "k-mer counting failed");
+  while (crpx_hashtable_next (ht_direct, &iter, &key, &value)) if (value >= 2) {
+    uint64_t disk_value = 0;
+    ck_assert_msg (crpx_hashtable_lookup (ht_disk, key, &disk_value) && (disk_value == value), "wrong count for k-mer");
+    expected++;
+  }
+  ck_assert_msg (expected == ht_disk->size, "%lu k-mers with count >= 2, but %lu reported", expected, ht_disk->size);
+  printf ("k-mer counter: %lu distinct 21-mers, %lu with count at least 2\n", ht_direct->size, expected);
+
+  crpx_hashtable_clear (ht_disk); // counter is empty after crpx_kmer_counter_count()
+  ck_assert_msg (crpx_kmer_counter_add_sequence (kc, seq[0], len), "could not reuse k-mer counter");
+  ck_assert_msg (crpx_kmer_counter_count (kc, 1, store_counts, ht_disk), "k-mer counting failed");
+  ck_assert_msg (ht_disk->size <= len - 20, "too many k-mers from one sequence");
+
+  for (i = 0; i < n_seqs; i++) free (seq[i]);
+  free (seq);
+  free (kmers);
+  del_crpx_kmer_counter (kc);
+  del_crpx_hashtable (ht_direct);
+  del_crpx_hashtable (ht_disk);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(kmer_invertible_hash)
+{
+  uint64_t x, y, *seen = (uint64_t *) calloc (1 << 10, sizeof (uint64_t)), in[1000], out[1000];
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  for (int i = 0; i < 1000; i++) {
+    x = crpx_random_64bits (cglob);
+    ck_assert_msg (crpx_kmer_invertible_hash (x, 32) == crpx_hashint_splitmix64 (x), "32-mer hash is not splitmix64");
+    ck_assert_msg (crpx_kmer_invertible_hash_inverse (x, 32) == crpx_hashint_splitmix64_inverse (x), "32-mer inverse is not splitmix64's");
+    for (uint8_t k = 1; k <= 32; k++) {
+      y = crpx_kmer_invertible_hash (x & crpx_kmer_mask (k), k);
+      ck_assert_msg (y <= crpx_kmer_mask (k), "hash of %u-mer has more than %u bits", k, 2 * k);
+      ck_assert_msg (crpx_kmer_invertible_hash_inverse (y, k) == (x & crpx_kmer_mask (k)), "inverse failed for k=%u", k);
+    }
+    in[i] = x & crpx_kmer_mask (21);
+  }
+  crpx_kmer_invertible_hash_array (in, 1000, 21, out);
+  for (int i = 0; i < 1000; i++) ck_assert_msg (out[i] == crpx_kmer_invertible_hash (in[i], 21), "bulk hash differs");
+  crpx_kmer_invertible_hash_inverse_array (out, 1000, 21, out);
+  ck_assert_msg (!memcmp (in, out, sizeof (in)), "bulk inverse differs");
+  for (uint8_t k = 1; k <= 5; k++) { // exhaustive: hash is a permutation of the 4^k k-mers
+    memset (seen, 0, (1 << 10) * sizeof (uint64_t));
+    for (x = 0; x <= crpx_kmer_mask (k); x++) seen[crpx_kmer_invertible_hash (x, k)]++;
+    for (x = 0; x <= crpx_kmer_mask (k); x++) ck_assert_msg (seen[x] == 1, "hash of %u-mers is not a bijection", k);
+  }
+  free (seen);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(kmer_store_round_trip)
+{
+  size_t i, j, n = 100000;
+  uint64_t *kmers = (uint64_t *) malloc (n * sizeof (uint64_t)), *decoded, *rank, r;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hashtable_t ht = new_crpx_hashtable (cglob, 0, NULL);
+  for (i = 0; i < n; i++) { // one in four k-mers is a repetition
+    kmers[i] = (i && !(i & 3)) ? kmers[crpx_random_range (cglob, i)] : crpx_random_64bits (cglob) & crpx_kmer_mask (31);
+    crpx_hashtable_get_or_insert (ht, kmers[i]);
+  }
+
+  for (uint8_t bits = 0; bits < 15; bits += 6) {
+    crpx_kmer_store_t ks = new_crpx_kmer_store (cglob, 31, kmers, n, bits);
+    ck_assert_msg (ks != NULL, "could not create k-mer store");
+    ck_assert_msg (ks->n_kmers == ht->size, "store has %lu k-mers, but there are %lu distinct", ks->n_kmers, ht->size);
+    decoded = (uint64_t *) malloc (ks->n_kmers * sizeof (uint64_t));
+    rank = (uint64_t *) malloc (n * sizeof (uint64_t));
+    crpx_kmer_store_decode (ks, decoded);
+    for (i = 0; i < ks->n_kmers; i++) {
+      ck_assert_msg (crpx_hashtable_lookup (ht, decoded[i], NULL), "decoded k-mer was not inserted");
+      ck_assert_msg (crpx_kmer_store_rank (ks, decoded[i]) == i, "rank of decoded k-mer differs from its position");
+      ck_assert_msg (crpx_kmer_store_kmer (ks, i) == decoded[i], "k-mer of rank differs from decoded");
+    }
+    crpx_kmer_store_rank_array (ks, kmers, n, rank);
+    for (i = 0; i < n; i++) ck_assert_msg ((rank[i] < ks->n_kmers) && (decoded[rank[i]] == kmers[i]), "k-mer not found in store");
+    for (i = j = 0; i < 10000; i++) {
+      r = crpx_random_64bits (cglob) & crpx_kmer_mask (31);
+      if (!crpx_hashtable_lookup (ht, r, NULL)) {
+        ck_assert_msg (crpx_kmer_store_rank (ks, r) == CRPX_KMER_STORE_NOT_FOUND, "absent k-mer found in store");
+        j++;
+      }
+    }
+    if (!bits) {
+      ck_assert_msg (crpx_kmer_store_size_in_bytes (ks) < ks->n_kmers * sizeof (uint64_t), "store not smaller than k-mers");
+      printf ("k-mer store: %lu distinct 31-mers in %.2lf bits each\n", ks->n_kmers, 8. * crpx_kmer_store_size_in_bytes (ks) / ks->n_kmers);
+    }
+    free (decoded);
+    free (rank);
+    del_crpx_kmer_store (ks);
+  }
+  ck_assert_msg (new_crpx_kmer_store (cglob, 32, kmers, n, 64) == NULL, "2^64 buckets accepted");
+  ck_assert_msg (new_crpx_kmer_store (cglob, 31, kmers, n, 40) == NULL, "2^40 buckets accepted");
+  free (kmers);
+  del_crpx_hashtable (ht);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(protein_kmer_reduced_alphabet)
+{
+  const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+  size_t n_seqs = 500, len = 300, i, j, n, n2, n_rec, n_shared = 0;
+  uint64_t hash[300], hash2[300], low[30], one;
+  uint32_t pos[300], lowpos[30];
+  uint16_t m = 30;
+  char **seq = (char **) malloc (n_seqs * sizeof (char *)), *s;
+  size_t *lens = (size_t *) malloc (n_seqs * sizeof (size_t));
+  crpx_protein_kmer_record_t rec = (crpx_protein_kmer_record_t) malloc (n_seqs * m * sizeof (crpx_protein_kmer_record_struct));
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_protein_kmer_t pk = new_crpx_protein_kmer (cglob, NULL, 10, 5);
+
+  ck_assert_msg (pk && (pk->alphabet_size == 13), "default alphabet should have 13 letters");
+  ck_assert_msg (new_crpx_protein_kmer (cglob, NULL, 18, 5) == NULL, "13^18 k-mers do not fit in 64 bits");
+  ck_assert_msg (new_crpx_protein_kmer (cglob, "AS,CS", 4, 5) == NULL, "letter in two groups accepted");
+  for (i = 0; i < n_seqs; i++) { // odd sequences are copies of the previous one, with substitutions inside groups (I/V, K/R)
+    seq[i] = (char *) malloc (len + 1);
+    lens[i] = len - (i % 7);
+    for (j = 0; j < len; j++) {
+      if (i % 2 == 0) seq[i][j] = aa[crpx_random_range (cglob, 20)];
+      else seq[i][j] = (seq[i-1][j] == 'I') ? 'v' : (seq[i-1][j] == 'K') ? 'R' : seq[i-1][j];
+    }
+    seq[i][len] = '\0';
+  }
+  s = seq[0];
+
+  n = crpx_protein_kmer_hash_sequence (pk, s, len, hash, pos); // rolling hash equals hash of each k-mer alone
+  ck_assert_int_eq (n, len - 10 + 1);
+  for (i = 0; i < n; i++) {
+    ck_assert_int_eq (crpx_protein_kmer_hash_sequence (pk, s + i, 10, &one, NULL), 1);
+    ck_assert_msg ((one == hash[i]) && (pos[i] == i), "rolling hash differs at position %lu", i);
+  }
+  n2 = crpx_protein_kmer_hash_sequence (pk, seq[1], len, hash2, NULL);
+  ck_assert_msg ((n2 == n) && !memcmp (hash, hash2, n * sizeof (uint64_t)), "substitutions within groups change k-mers");
+  s[100] = (s[100] == 'W') ? 'G' : 'W'; // substitution across groups changes 10 k-mers
+  crpx_protein_kmer_hash_sequence (pk, s, len, hash2, NULL);
+  for (n2 = i = 0; i < n; i++) n2 += (hash[i] != hash2[i]);
+  ck_assert_int_eq (n2, 10);
+  s[150] = 'X'; // invalid residue removes all k-mers that contain it
+  ck_assert_int_eq (crpx_protein_kmer_hash_sequence (pk, s, len, hash2, NULL), n - 10);
+
+  memcpy (s + 200, s + 160, 20); // repeated k-mers appear only once among the lowest
+  n = crpx_protein_kmer_hash_sequence (pk, s, len, hash, pos);
+  ck_assert_int_eq (crpx_protein_kmer_lowest (pk, s, len, m, low, lowpos), m);
+  for (i = 0; i < m; i++) {
+    for (n2 = j = 0; j < n; j++) n2 += (hash[j] < low[i]); // brute force rank among distinct hashes
+    for (j = 0; j < n; j++) if (hash[j] < low[i]) for (size_t l = 0; l < j; l++) if (hash[l] == hash[j]) { n2--; break; }
+    ck_assert_msg (n2 == i, "k-mer %lu with rank %lu among lowest", i, n2);
+    for (j = 0; hash[j] != low[i]; j++);
+    ck_assert_msg (lowpos[i] == pos[j], "position of lowest k-mer is not its first occurrence");
+  }
+  ck_assert_int_eq (crpx_protein_kmer_lowest (pk, "MKV", 3, m, low, NULL), 0);
+
+  n_rec = crpx_protein_kmer_records (pk, (const char **) seq, lens, n_seqs, 1000, m, rec);
+  for (i = j = 0; i < n_seqs; i++) { // same as sequence by sequence
+    n = crpx_protein_kmer_lowest (pk, seq[i], lens[i], m, low, lowpos);
+    for (n2 = 0; n2 < n; n2++, j++) ck_assert_msg ((rec[j].seq_id == 1000 + i) && (rec[j].hash == low[n2]) && (rec[j].position == lowpos[n2]), "record %lu differs", j);
+  }
+  ck_assert_int_eq (j, n_rec);
+  ck_assert_msg (crpx_protein_kmer_sort_records (pk, rec, n_rec), "could not sort records");
+  for (i = 1; i < n_rec; i++) {
+    ck_assert_msg ((rec[i-1].hash < rec[i].hash) || ((rec[i-1].hash == rec[i].hash) && (rec[i-1].seq_id < rec[i].seq_id)), "records not sorted");
+    if (rec[i-1].hash == rec[i].hash) n_shared += ((rec[i-1].seq_id / 2 == rec[i].seq_id / 2) && (rec[i-1].position == rec[i].position));
+  }
+  ck_assert_msg (n_shared > n_seqs / 2 * (m - 2), "only %lu records shared between homologous sequences", n_shared);
+
+  for (i = 0; i < n_seqs; i++) free (seq[i]);
+  free (seq); free (lens); free (rec);
+  del_crpx_protein_kmer (pk);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+Suite * this_suite(void)
+{
+  Suite *s;
+  TCase *tc_case;
+
+  s = suite_create("kmers");
+  tc_case = tcase_create("kmer_counting");
+  tcase_add_test(tc_case, kmer_encoding_reverse_complement);
+  tcase_add_test(tc_case, kmer_counter_disk_partitions);
+  tcase_add_test(tc_case, kmer_invertible_hash);
+  tcase_add_test(tc_case, kmer_store_round_trip);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("protein_kmers");
+  tcase_add_test(tc_case, protein_kmer_reduced_alphabet);
+  suite_add_tcase(s, tc_case);
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  SRunner *sr;
+
+  sr = srunner_create (this_suite());
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed > 0) ? TEST_FAILURE:TEST_SUCCESS;
+}
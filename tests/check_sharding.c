@@ -0,0 +1,208 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#include <check.h>
+#include <sys/wait.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+#define N_KEYS 200000
+#define N_WORKERS 4
+
+typedef struct {
+  crpx_multiset_hash_struct jump, rdv; /* keys owned by this worker according to each method */
+  int32_t rank;
+} worker_report_struct;
+
+static void
+generate_keys (uint64_t *key, size_t n)
+{ // same keys in every process, without communication; consecutive integers like k-mer codes or tree ids
+  size_t i;
+  for (i = 0; i < n; i++) key[i] = 3 * i + 1;
+}
+
+static void
+sharding_worker (int32_t rank, int fd)
+{ // worker process: computes the assignment of all keys by itself, and reports only the ones it owns
+  uint64_t *key = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t)), *node = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t));
+  int32_t *bucket = (int32_t *) malloc (N_KEYS * sizeof (int32_t)), i;
+  worker_report_struct rep;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_rendezvous_t rdv = new_crpx_rendezvous (cglob, 42);
+
+  for (i = N_WORKERS - 1; i >= 0; i--) crpx_rendezvous_add_node (rdv, 100 + i, 1. + (double) i); // any order
+  generate_keys (key, N_KEYS);
+  crpx_jump_consistent_hash_array (key, N_KEYS, 42, N_WORKERS, bucket);
+  crpx_rendezvous_node_array (rdv, key, N_KEYS, node);
+  rep.rank = rank;
+  crpx_multiset_hash_init (&rep.jump, 1);
+  crpx_multiset_hash_init (&rep.rdv, 1);
+  for (i = 0; i < N_KEYS; i++) {
+    if (bucket[i] == rank) crpx_multiset_hash_add_uint64 (&rep.jump, key[i]);
+    if (node[i] == (uint64_t) (100 + rank)) crpx_multiset_hash_add_uint64 (&rep.rdv, key[i]);
+  }
+  i = (write (fd, &rep, sizeof (rep)) == (ssize_t) sizeof (rep)) ? 0 : 1;
+  close (fd);
+  del_crpx_rendezvous (rdv);
+  crpx_global_finalise (cglob);
+  free (key); free (node); free (bucket);
+  _exit (i);
+}
+
+START_TEST(sharding_worker_processes)
+{ // workers must be forked before this process starts any OpenMP thread
+  int fd[N_WORKERS][2], status;
+  int32_t i, total_weight = N_WORKERS * (N_WORKERS + 1) / 2;
+  pid_t pid[N_WORKERS];
+  uint64_t *key = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t));
+  worker_report_struct rep;
+  crpx_multiset_hash_struct all, jump, rdv;
+  double expected;
+
+  for (i = 0; i < N_WORKERS; i++) {
+    ck_assert_msg (pipe (fd[i]) == 0, "could not create pipe");
+    pid[i] = fork ();
+    ck_assert_msg (pid[i] >= 0, "could not fork worker process");
+    if (pid[i] == 0) { close (fd[i][0]); sharding_worker (i, fd[i][1]); }
+    close (fd[i][1]);
+  }
+  crpx_multiset_hash_init (&jump, 1);
+  crpx_multiset_hash_init (&rdv, 1);
+  for (i = 0; i < N_WORKERS; i++) {
+    ck_assert_msg (read (fd[i][0], &rep, sizeof (rep)) == (ssize_t) sizeof (rep), "incomplete report from worker %d", i);
+    close (fd[i][0]);
+    waitpid (pid[i], &status, 0);
+    ck_assert_msg (WIFEXITED (status) && (WEXITSTATUS (status) == 0), "worker %d failed", i);
+    ck_assert_int_eq (rep.rank, i);
+    expected = (double) N_KEYS / N_WORKERS; // jump: same load
+    ck_assert_msg (fabs ((double) rep.jump.n_elements - expected) < 0.03 * expected, "jump hash unbalanced: worker %d has %ld keys", i, rep.jump.n_elements);
+    expected = (double) N_KEYS * (1. + (double) i) / total_weight; // rendezvous: load proportional to weight
+    ck_assert_msg (fabs ((double) rep.rdv.n_elements - expected) < 0.03 * expected, "rendezvous unbalanced: worker %d has %ld keys, expected %.0lf", i, rep.rdv.n_elements, expected);
+    crpx_multiset_hash_combine (&jump, &rep.jump);
+    crpx_multiset_hash_combine (&rdv, &rep.rdv);
+  }
+  generate_keys (key, N_KEYS); // each key owned by exactly one worker
+  crpx_multiset_hash_init_from_uint64_array (&all, 1, key, N_KEYS);
+  ck_assert_msg (crpx_multiset_hash_equal (&all, &jump), "workers disagree on jump hash assignment");
+  ck_assert_msg (crpx_multiset_hash_equal (&all, &rdv), "workers disagree on rendezvous assignment");
+  free (key);
+}
+END_TEST
+
+START_TEST(jump_consistent_hash_moves)
+{
+  uint64_t *key = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t));
+  int32_t *b1 = (int32_t *) malloc (N_KEYS * sizeof (int32_t)), *b2 = (int32_t *) malloc (N_KEYS * sizeof (int32_t)), n_buckets;
+  int64_t i, n_moved, n_modulo;
+  double expected;
+
+  generate_keys (key, N_KEYS);
+  for (n_buckets = 1; n_buckets < 200; n_buckets += 1 + n_buckets / 4) {
+    crpx_jump_consistent_hash_array (key, N_KEYS, 7, n_buckets, b1);
+    crpx_jump_consistent_hash_array (key, N_KEYS, 7, n_buckets + 1, b2);
+    for (n_moved = n_modulo = i = 0; i < N_KEYS; i++) {
+      ck_assert_int_eq (b1[i], crpx_jump_consistent_hash_seed (key[i], 7, n_buckets));
+      ck_assert_msg ((b1[i] >= 0) && (b1[i] < n_buckets), "bucket out of range");
+      if (b1[i] != b2[i]) { // a key can only move to the new bucket
+        ck_assert_int_eq (b2[i], n_buckets);
+        n_moved++;
+      }
+      n_modulo += ((key[i] % n_buckets) != (key[i] % (n_buckets + 1)));
+    }
+    expected = (double) N_KEYS / (n_buckets + 1);
+    ck_assert_msg (fabs ((double) n_moved - expected) < 0.05 * expected + 100, "%ld keys moved from %d to %d buckets, expected %.0lf", n_moved, n_buckets, n_buckets + 1, expected);
+    if (n_buckets > 4) ck_assert_msg (n_modulo > 4 * n_moved, "modulo moved only %ld keys, and jump hash %ld", n_modulo, n_moved);
+  }
+  ck_assert_int_eq (crpx_jump_consistent_hash (123456789, 1), 0);
+  ck_assert_msg (crpx_jump_consistent_hash_seed (1, 1, 1000000) != crpx_jump_consistent_hash_seed (1, 2, 1000000), "seed is ignored");
+  free (key); free (b1); free (b2);
+}
+END_TEST
+
+START_TEST(rendezvous_weighted_nodes)
+{
+  uint64_t *key = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t)), *n1 = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t)),
+           *n2 = (uint64_t *) malloc (N_KEYS * sizeof (uint64_t)), top[5], all_nodes[100];
+  int64_t i, count[8], n_moved;
+  uint32_t j, n_top;
+  double expected;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_rendezvous_t ra = new_crpx_rendezvous (cglob, 3), rb = new_crpx_rendezvous (cglob, 3);
+
+  for (j = 0; j < 8; j++) crpx_rendezvous_add_node (ra, 0xdead0000 + j, 1.); // same nodes, reverse order
+  for (j = 8; j > 0; j--) crpx_rendezvous_add_node (rb, 0xdead0000 + j - 1, 1.);
+  ck_assert_msg (!crpx_rendezvous_add_node (ra, 0xdead0003, 2.), "node added twice");
+  generate_keys (key, N_KEYS);
+  crpx_rendezvous_node_array (ra, key, N_KEYS, n1);
+  crpx_rendezvous_node_array (rb, key, N_KEYS, n2);
+  memset (count, 0, sizeof (count));
+  for (i = 0; i < N_KEYS; i++) {
+    ck_assert_msg (n1[i] == n2[i], "assignment depends on order of nodes");
+    count[n1[i] - 0xdead0000]++;
+  }
+  for (j = 0; j < 8; j++) ck_assert_msg (fabs ((double) count[j] - N_KEYS / 8.) < 0.04 * N_KEYS / 8., "unbalanced node %u: %ld keys", j, count[j]);
+
+  crpx_rendezvous_remove_node (rb, 0xdead0005); // only keys of removed node move, to the node ranked second
+  ck_assert_msg (!crpx_rendezvous_remove_node (rb, 0xdead0005), "removed node still present");
+  crpx_rendezvous_node_array (rb, key, N_KEYS, n2);
+  for (i = 0; i < N_KEYS; i += 7) {
+    n_top = crpx_rendezvous_top_nodes (ra, key[i], 5, top);
+    ck_assert_int_eq (n_top, 5);
+    ck_assert_msg (top[0] == n1[i], "first of top nodes differs from owner");
+    for (j = 1; j < n_top; j++) ck_assert_msg (top[j] != top[j-1], "repeated node in top list");
+    if (n1[i] == 0xdead0005) ck_assert_msg (n2[i] == top[1], "key did not move to the second choice");
+    else ck_assert_msg (n2[i] == n1[i], "key moved away from a node that was not removed");
+  }
+
+  crpx_rendezvous_add_node (rb, 0xdead0005, 3.); // node back with triple capacity takes 3/10 of keys
+  crpx_rendezvous_node_array (rb, key, N_KEYS, n2);
+  for (n_moved = i = 0; i < N_KEYS; i++) {
+    if (n1[i] != n2[i]) ck_assert_msg (n2[i] == 0xdead0005, "key moved to a node other than the new one");
+    n_moved += (n2[i] == 0xdead0005);
+  }
+  expected = 0.3 * N_KEYS;
+  ck_assert_msg (fabs ((double) n_moved - expected) < 0.03 * expected, "node with weight 3 has %ld keys, expected %.0lf", n_moved, expected);
+  ck_assert_int_eq (crpx_rendezvous_top_nodes (rb, 1, 20, all_nodes), 8); // fewer nodes than requested
+  ck_assert_int_eq (crpx_rendezvous_top_nodes (rb, 1, UINT32_MAX, all_nodes), 8);
+  for (j = 8; j < 100; j++) crpx_rendezvous_add_node (ra, 0xdead0000 + j, 1.); // more scores than fit on the stack
+  ck_assert_int_eq (crpx_rendezvous_top_nodes (ra, key[0], UINT32_MAX, all_nodes), 100);
+  ck_assert_msg (all_nodes[0] == crpx_rendezvous_node (ra, key[0]), "first of top nodes differs from owner");
+  for (j = 1; j < 100; j++) for (i = 0; i < j; i++) ck_assert_msg (all_nodes[i] != all_nodes[j], "repeated node in top list");
+
+  del_crpx_rendezvous (ra);
+  del_crpx_rendezvous (rb);
+  crpx_global_finalise (cglob);
+  free (key); free (n1); free (n2);
+}
+END_TEST
+
+Suite * this_suite(void)
+{
+  Suite *s;
+  TCase *tc_case;
+
+  s = suite_create("sharding");
+  tc_case = tcase_create("consistent_hashing");
+  tcase_add_test(tc_case, sharding_worker_processes);
+  tcase_add_test(tc_case, jump_consistent_hash_moves);
+  tcase_add_test(tc_case, rendezvous_weighted_nodes);
+  suite_add_tcase(s, tc_case);
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  SRunner *sr;
+
+  sr = srunner_create (this_suite());
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed > 0) ? TEST_FAILURE:TEST_SUCCESS;
+}
@@ -0,0 +1,252 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#include <check.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+START_TEST(hyperloglog_sparse_and_dense)
+{
+  uint64_t i, n_values[] = {10, 1000, 50000, 1000000};
+  double est, err;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hyperloglog_t hll = new_crpx_hyperloglog (cglob, 14);
+  ck_assert_msg (hll != NULL, "could not create hyperloglog");
+
+  for (int j = 0; j < 4; j++) {
+    crpx_hyperloglog_reset (hll);
+    for (i = 0; i < n_values[j]; i++) { crpx_hyperloglog_add_uint64 (hll, i); crpx_hyperloglog_add_uint64 (hll, i/2); } // duplicates
+    est = crpx_hyperloglog_estimate (hll);
+    err = fabs (est - (double) n_values[j]) / (double) n_values[j];
+    printf ("HLL p=14 n=%8lu sparse=%d estimate=%12.2lf harmonic=%12.2lf rel.error=%lf\n", n_values[j], hll->is_sparse, est,
+            crpx_hyperloglog_estimate_harmonic (hll), err);
+    ck_assert_msg (err < 0.05, "HyperLogLog relative error %lf too large for n=%lu", err, n_values[j]);
+  }
+  del_crpx_hyperloglog (hll);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(hyperloglog_parallel_merge)
+{
+  uint64_t i, n = 2000000, *hash = (uint64_t *) malloc (n * sizeof (uint64_t));
+  double est_serial, est_parallel;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hyperloglog_t h1 = new_crpx_hyperloglog (cglob, 12), h2 = new_crpx_hyperloglog (cglob, 12);
+
+  for (i = 0; i < n; i++) hash[i] = crpx_hashint_murmurmix64 (i % (n/2)); // n/2 distinct
+  for (i = 0; i < n; i++) crpx_hyperloglog_add_hash (h1, hash[i]);
+  crpx_hyperloglog_add_hash_array (h2, hash, n);
+  est_serial = crpx_hyperloglog_estimate (h1);
+  est_parallel = crpx_hyperloglog_estimate (h2);
+  printf ("HLL p=12 serial=%lf parallel=%lf\n", est_serial, est_parallel);
+  ck_assert_msg (est_serial == est_parallel, "parallel and serial HLL differ: %lf and %lf", est_serial, est_parallel);
+  ck_assert_msg (fabs (est_serial - (double)(n/2)) / (double)(n/2) < 0.1, "HLL estimate too far from %lu", n/2);
+
+  free (hash);
+  del_crpx_hyperloglog (h1);
+  del_crpx_hyperloglog (h2);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(count_min_sketch_batched_and_merged)
+{
+  uint64_t i, n = 500000, n_distinct = 20000, *keys = (uint64_t *) malloc (n * sizeof (uint64_t));
+  uint32_t *truth = (uint32_t *) calloc (n_distinct, sizeof (uint32_t)), est;
+  double err_plain = 0., err_cons = 0.;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+
+  for (i = 0; i < n; i++) { keys[i] = crpx_random_range (cglob, 1 + crpx_random_range (cglob, n_distinct)); truth[keys[i]]++; } // skewed
+  for (uint8_t bits = 8; bits <= 32; bits *= 2) {
+    crpx_count_min_sketch_t plain = new_crpx_count_min_sketch (cglob, 4096, 4, bits, false, 42);
+    crpx_count_min_sketch_t cons  = new_crpx_count_min_sketch (cglob, 4096, 4, bits, true, 42);
+    crpx_count_min_sketch_t batch = new_crpx_count_min_sketch_like (plain), part = new_crpx_count_min_sketch_like (plain);
+    ck_assert_msg (plain && cons && batch && part, "could not create count-min sketches with %u bits", bits);
+    for (i = 0; i < n; i++) {
+      crpx_count_min_sketch_add_uint64 (plain, keys[i], 1);
+      crpx_count_min_sketch_add_uint64 (cons, keys[i], 1);
+    }
+    crpx_count_min_sketch_add_uint64_array (batch, keys, NULL, n / 3);
+    crpx_count_min_sketch_add_uint64_array (part, keys + n / 3, NULL, n - n / 3);
+    crpx_count_min_sketch_merge (batch, part, false);
+    ck_assert_msg (memcmp (batch->counter, plain->counter, 4096 * 4 * bits / 8) == 0, "batched and merged sketch differs from serial, %u bits", bits);
+    for (err_plain = err_cons = 0., i = 0; i < n_distinct; i++) {
+      est = crpx_count_min_sketch_estimate_uint64 (cons, i);
+      ck_assert_msg (est >= CRPX_MIN (truth[i], cons->max_count), "conservative estimate %u below true count %u", est, truth[i]);
+      ck_assert_msg (est <= crpx_count_min_sketch_estimate_uint64 (plain, i), "conservative estimate larger than plain estimate");
+      err_cons  += (double) (est - CRPX_MIN (truth[i], cons->max_count));
+      err_plain += (double) (crpx_count_min_sketch_estimate_uint64 (plain, i) - CRPX_MIN (truth[i], plain->max_count));
+    }
+    printf ("CMS %2u bits: mean overestimation plain=%lf conservative=%lf\n", bits, err_plain / n_distinct, err_cons / n_distinct);
+    crpx_count_min_sketch_reset (part);
+    crpx_count_min_sketch_add_uint64_array (part, keys, NULL, n); // batched conservative update is also an upper bound
+    crpx_count_min_sketch_merge (part, cons, true);
+    for (i = 0; i < n_distinct; i++) ck_assert_msg (crpx_count_min_sketch_estimate_uint64 (part, i) >= CRPX_MIN (truth[i], part->max_count), "merged estimate below true count");
+    del_crpx_count_min_sketch (plain);
+    del_crpx_count_min_sketch (cons);
+    del_crpx_count_min_sketch (batch);
+    del_crpx_count_min_sketch (part);
+  }
+  free (keys);
+  free (truth);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(frac_minhash_containment)
+{
+  size_t i, n, len = 2000000, half = len / 4;
+  uint64_t *kmers = (uint64_t *) malloc (len * sizeof (uint64_t));
+  char *seq = (char *) malloc (len + 1), *mut = (char *) malloc (len + 1);
+  double c, ani;
+  bool has_avx;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_frac_minhash_t a = new_crpx_frac_minhash (cglob, 21, 100, 42), b = new_crpx_frac_minhash (cglob, 21, 100, 42);
+  crpx_frac_minhash_t m = new_crpx_frac_minhash (cglob, 21, 100, 42), p = new_crpx_frac_minhash (cglob, 21, 100, 42);
+  ck_assert_msg (a && b && m && p, "could not create FracMinHash sketches");
+  for (i = 0; i < len; i++) mut[i] = seq[i] = "ACGT"[crpx_random_range (cglob, 4)];
+  for (i = 0; i < len; i += 100) { // one substitution per 100 sites
+    size_t j = i + crpx_random_range (cglob, 100);
+    mut[j] = "ACGT"[(crpx_dna_2bit_code[(uint8_t) seq[j]] + 1 + crpx_random_range (cglob, 3)) & 3];
+  }
+  seq[len] = mut[len] = '\0';
+
+  crpx_frac_minhash_add_sequence (a, seq, len);
+  n = crpx_kmer_encode_sequence (seq, len, 21, true, kmers); // same sketch from all hashes
+  for (i = 0; i < n; i++) kmers[i] = crpx_frac_minhash_kmer_hash (a, kmers[i]);
+  for (i = 0; i < n; i++) crpx_frac_minhash_add_hash (p, kmers[i]);
+  crpx_frac_minhash_flush (a);
+  crpx_frac_minhash_flush (p);
+  ck_assert_msg ((a->n_hash == p->n_hash) && !memcmp (a->hash, p->hash, a->n_hash * sizeof (uint64_t)), "sketch of sequence differs from sketch of hashes");
+  for (i = 1; i < a->n_hash; i++) ck_assert_msg (a->hash[i-1] < a->hash[i], "sketch is not sorted");
+  has_avx = cglob->avx;
+  cglob->avx = 0;
+  crpx_frac_minhash_reset (p);
+  crpx_frac_minhash_add_hash_array (p, kmers, n);
+  crpx_frac_minhash_flush (p);
+  cglob->avx = has_avx;
+  ck_assert_msg ((a->n_hash == p->n_hash) && !memcmp (a->hash, p->hash, a->n_hash * sizeof (uint64_t)), "scalar threshold filter differs");
+
+  crpx_frac_minhash_add_sequence (b, seq, half); // b is contained in a
+  c = crpx_frac_minhash_containment (b, a);
+  ck_assert_msg (c == 1., "containment of subsequence is %lf", c);
+  c = crpx_frac_minhash_containment (a, b);
+  printf ("FracMinHash: %lu hashes, cardinality %.0lf, containment of a in quarter of a %lf\n", a->n_hash, crpx_frac_minhash_cardinality (a), c);
+  ck_assert_msg (fabs (c - 0.25) < 0.02, "containment %lf is far from 0.25", c);
+  crpx_frac_minhash_add_sequence (m, seq + half - 20, len - half + 20); // overlap of k-1 chars
+  crpx_frac_minhash_merge (m, b);
+  ck_assert_msg ((a->n_hash == m->n_hash) && !memcmp (a->hash, m->hash, a->n_hash * sizeof (uint64_t)), "merged sketch differs");
+
+  crpx_frac_minhash_reset (m);
+  crpx_frac_minhash_add_sequence (m, mut, len);
+  i = crpx_frac_minhash_intersection_size (a, m);
+  cglob->avx = 0;
+  ck_assert_msg (crpx_frac_minhash_intersection_size (a, m) == i, "scalar intersection differs");
+  ck_assert_msg (crpx_frac_minhash_intersection_size (m, b) == crpx_frac_minhash_intersection_size (b, m), "intersection not symmetric");
+  cglob->avx = has_avx;
+  ck_assert_msg (crpx_frac_minhash_intersection_size (m, b) == crpx_frac_minhash_intersection_size (b, m), "intersection not symmetric");
+  ani = crpx_frac_minhash_ani (m, a);
+  printf ("FracMinHash: ANI of sequence with 1%% of differences %lf (jaccard %lf)\n", ani, crpx_frac_minhash_jaccard (a, m));
+  ck_assert_msg (fabs (ani - 0.99) < 0.003, "ANI %lf is far from 0.99", ani);
+
+  free (kmers); free (seq); free (mut);
+  del_crpx_frac_minhash (a); del_crpx_frac_minhash (b);
+  del_crpx_frac_minhash (m); del_crpx_frac_minhash (p);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(lsh_index_near_duplicates)
+{ // pairs of sets with Jaccard similarity around 0.8 among unrelated sets; LSH must find them without all-vs-all
+  uint32_t n_items = 2000, set_size = 200, n_hashes = 128, i, j, n_true = 0, n_brute = 0, *sig, *mutant_sig, found[8];
+  uint64_t *set = (uint64_t *) malloc (set_size * sizeof (uint64_t));
+  size_t n_pairs, n_mut, k;
+  crpx_lsh_pair_t pairs;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_hash_family_t hf = new_crpx_hash_family (cglob, n_hashes);
+  crpx_lsh_index_t lsh;
+  uint16_t rows;
+
+  sig = (uint32_t *) malloc ((size_t) n_items * n_hashes * sizeof (uint32_t));
+  mutant_sig = (uint32_t *) malloc ((size_t) n_items / 2 * n_hashes * sizeof (uint32_t));
+  for (i = 0; i < n_items; i += 2) { // item i+1 has 20 of the 200 elements of item i replaced
+    for (j = 0; j < set_size; j++) set[j] = crpx_random_64bits (cglob);
+    crpx_hash_family_minhash (hf, set, set_size, sig + (size_t) i * n_hashes);
+    for (j = 0; j < 20; j++) set[crpx_random_range (cglob, set_size)] = crpx_random_64bits (cglob);
+    crpx_hash_family_minhash (hf, set, set_size, sig + (size_t) (i + 1) * n_hashes);
+    memcpy (mutant_sig + (size_t) i / 2 * n_hashes, sig + (size_t) (i + 1) * n_hashes, n_hashes * sizeof (uint32_t));
+  }
+  rows = crpx_lsh_rows_for_threshold (n_hashes, 0.5);
+  ck_assert_msg (crpx_lsh_collision_probability (0.8, n_hashes / rows, rows) > 0.999, "%u rows per band miss similar pairs", rows);
+  ck_assert_msg (crpx_lsh_collision_probability (0.1, n_hashes / rows, rows) < 0.01, "%u rows per band give too many candidates", rows);
+  lsh = new_crpx_lsh_index (cglob, sig, n_items, n_hashes, rows, 17);
+  ck_assert_msg (lsh != NULL, "could not build LSH index");
+  printf ("LSH index: %u bands of %u rows, %.1lf bytes per item\n", lsh->n_bands, lsh->rows, (double) crpx_lsh_index_size_in_bytes (lsh) / n_items);
+
+  pairs = crpx_lsh_index_all_pairs (lsh, 0.5, &n_pairs);
+  for (k = 0; k < n_pairs; k++) {
+    ck_assert_msg (pairs[k].query < pairs[k].item, "pair not ordered");
+    ck_assert_msg ((k == 0) || (pairs[k-1].query < pairs[k].query) ||
+                   ((pairs[k-1].query == pairs[k].query) && (pairs[k-1].item < pairs[k].item)), "pairs not sorted");
+    ck_assert_msg (pairs[k].jaccard >= 0.5, "pair below threshold");
+    n_true += ((pairs[k].query % 2 == 0) && (pairs[k].item == pairs[k].query + 1));
+  }
+  for (i = 0; i < n_items; i++) for (j = i + 1; j < n_items; j++) // brute force, on the same signatures
+    n_brute += (crpx_lsh_index_similarity (lsh, sig + (size_t) i * n_hashes, sig + (size_t) j * n_hashes) >= 0.5);
+  ck_assert_msg (n_true == n_items / 2, "LSH found %u of the %u similar pairs", n_true, n_items / 2);
+  ck_assert_msg (n_pairs == n_brute, "LSH found %lu pairs, but all-vs-all found %u", n_pairs, n_brute);
+  free (pairs);
+
+  pairs = crpx_lsh_index_search (lsh, mutant_sig, n_items / 2, 0.5, &n_mut); // each mutant finds itself and its original
+  ck_assert_msg (n_mut == 2 * (n_items / 2), "search found %lu pairs", n_mut);
+  for (k = 0; k < n_mut; k++) ck_assert_msg (pairs[k].item / 2 == pairs[k].query, "query %u matched unrelated item %u", pairs[k].query, pairs[k].item);
+  free (pairs);
+  ck_assert_int_eq (crpx_lsh_index_query (lsh, mutant_sig, 0.99, found, NULL, 8), 1);
+  ck_assert_int_eq (found[0], 1);
+
+  del_crpx_lsh_index (lsh);
+  del_crpx_hash_family (hf);
+  crpx_global_finalise (cglob);
+  free (set); free (sig); free (mutant_sig);
+}
+END_TEST
+
+Suite * this_suite(void)
+{
+  Suite *s;
+  TCase *tc_case;
+
+  s = suite_create("sketches");
+  tc_case = tcase_create("hyperloglog");
+  tcase_add_test(tc_case, hyperloglog_sparse_and_dense);
+  tcase_add_test(tc_case, hyperloglog_parallel_merge);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("count_min_sketch");
+  tcase_add_test(tc_case, count_min_sketch_batched_and_merged);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("frac_minhash");
+  tcase_add_test(tc_case, frac_minhash_containment);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("lsh_index");
+  tcase_add_test(tc_case, lsh_index_near_duplicates);
+  suite_add_tcase(s, tc_case);
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  SRunner *sr;
+
+  sr = srunner_create (this_suite());
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed > 0) ? TEST_FAILURE:TEST_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/* This test file is part of curupixa, a low-level library for phylogenomic analysis.
+ * Copyright (C) 2022-today  Leonardo de Oliveira Martins [ leomrtns at gmail.com;  http://www.leomartins.org ]
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <curupixa.h>
+#include <check.h>
+
+#define TEST_SUCCESS 0
+#define TEST_FAILURE 1
+#define TEST_SKIPPED 77
+#define TEST_HARDERROR 99
+
+static uint32_t
+random_rooted_tree (crpx_global_t cglob, uint32_t n_taxa, int32_t *parent)
+{ // joins two random subtrees at a time; new nodes have larger indices, thus parent[] is in postorder
+  uint32_t active[n_taxa], n_active = n_taxa, next = n_taxa, i, j;
+  for (i = 0; i < n_taxa; i++) active[i] = i;
+  while (n_active > 1) {
+    i = crpx_random_range (cglob, n_active);
+    parent[active[i]] = next; active[i] = active[--n_active];
+    j = crpx_random_range (cglob, n_active);
+    parent[active[j]] = next; active[j] = next++;
+  }
+  parent[next - 1] = -1;
+  return next; // 2 * n_taxa - 1 nodes
+}
+
+static uint32_t
+rf_distance_bitmask (const int32_t *pa, const int32_t *pb, uint32_t n_nodes, uint32_t n_taxa)
+{ // brute force: leaf sets as bit masks, normalised to the side without taxon 0
+  uint64_t ma[n_nodes], mb[n_nodes], all = (n_taxa == 64) ? UINT64_MAX : (1ULL << n_taxa) - 1;
+  uint32_t i, j, rf = 0, n_a = 0, n_b = 0, common = 0;
+  memset (ma, 0, sizeof (ma)); memset (mb, 0, sizeof (mb));
+  for (i = 0; i < n_taxa; i++) ma[i] = mb[i] = 1ULL << i;
+  for (i = 0; i < n_nodes - 1; i++) { ma[pa[i]] |= ma[i]; mb[pb[i]] |= mb[i]; }
+  for (i = n_taxa; i < n_nodes; i++) {
+    if (ma[i] & 1) ma[i] ^= all;
+    if (mb[i] & 1) mb[i] ^= all;
+    if (__builtin_popcountll (ma[i]) < 2 || __builtin_popcountll (ma[i]) > (int) n_taxa - 2) ma[i] = 0;
+    if (__builtin_popcountll (mb[i]) < 2 || __builtin_popcountll (mb[i]) > (int) n_taxa - 2) mb[i] = 0;
+  }
+  for (i = n_taxa; i < n_nodes; i++) for (j = n_taxa; j < i; j++) { // remove duplicates (two children of root)
+    if (ma[j] == ma[i]) ma[i] = 0;
+    if (mb[j] == mb[i]) mb[i] = 0;
+  }
+  for (i = n_taxa; i < n_nodes; i++) {
+    if (ma[i]) n_a++;
+    if (mb[i]) n_b++;
+    if (ma[i]) for (j = n_taxa; j < n_nodes; j++) if (ma[i] == mb[j]) common++;
+  }
+  rf = n_a + n_b - 2 * common;
+  return rf;
+}
+
+START_TEST(split_hash_rerooting)
+{ // caterpillar ((((0,1),2),3),4),5) and rerooted (((0,1),2),(3,(4,5))) are the same unrooted tree
+  int32_t pa[11] = {6, 6, 7, 8, 9, 10, 7, 8, 9, 10, -1}, pb[11] = {6, 6, 7, 9, 8, 8, 7, 10, 9, 10, -1}, pc[11];
+  uint64_t sa[11], sb[11], sc[11];
+  int32_t na, nb, nc;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_split_hash_t sh = new_crpx_split_hash (cglob, 6);
+
+  na = crpx_split_hash_tree (sh, pa, 11, sa);
+  nb = crpx_split_hash_tree (sh, pb, 11, sb);
+  ck_assert_msg (na == 3 && nb == 3, "unrooted binary tree with 6 taxa should have 3 splits, not %d and %d", na, nb);
+  ck_assert_msg (crpx_split_hash_rf_distance (sa, na, sb, nb) == 0, "rerooting should not change splits");
+  memcpy (pc, pa, sizeof (pc)); pc[1] = 7; pc[2] = 6; // ((((0,2),1),3),4),5): one split differs
+  nc = crpx_split_hash_tree (sh, pc, 11, sc);
+  ck_assert_msg (crpx_split_hash_rf_distance (sa, na, sc, nc) == 2, "RF distance should be 2");
+  pc[6] = 5; // parent must be an internal node after child
+  ck_assert_msg (crpx_split_hash_tree (sh, pc, 11, sc) == -1, "invalid tree should be detected");
+  pc[6] = 7; pc[10] = 10;
+  ck_assert_msg (crpx_split_hash_tree (sh, pc, 11, sc) == -1, "tree without root should be detected");
+  del_crpx_split_hash (sh);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(split_hash_rf_random_trees)
+{
+  uint32_t n_taxa = 40, n_trees = 50, n_nodes = 2 * 40 - 1, i, j;
+  int32_t *parent[50];
+  uint32_t nodes[50], *dist = (uint32_t *) malloc (n_trees * (n_trees - 1) / 2 * sizeof (uint32_t));
+  uint64_t sa[79], sb[79];
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_split_hash_t sh = new_crpx_split_hash (cglob, n_taxa);
+
+  for (i = 0; i < n_trees; i++) {
+    parent[i] = (int32_t *) malloc (n_nodes * sizeof (int32_t));
+    nodes[i] = random_rooted_tree (cglob, n_taxa, parent[i]);
+    if (i % 5) for (j = 0; j < n_nodes; j++) parent[i][j] = parent[i - 1][j]; // some identical trees
+    if (i % 5 == 2) { parent[i][3] = parent[i - 1][4]; parent[i][4] = parent[i - 1][3]; } // and some close ones
+  }
+  ck_assert_msg (crpx_split_hash_rf_matrix (sh, parent, nodes, n_trees, dist), "RF matrix failed");
+  for (i = 0; i < n_trees; i++) for (j = i + 1; j < n_trees; j++) {
+    int32_t na = crpx_split_hash_tree (sh, parent[i], nodes[i], sa), nb = crpx_split_hash_tree (sh, parent[j], nodes[j], sb);
+    uint32_t rf = crpx_split_hash_rf_distance (sa, na, sb, nb);
+    ck_assert_msg (na == (int32_t) n_taxa - 3, "binary tree should have %u splits, not %d", n_taxa - 3, na);
+    ck_assert_msg (rf == rf_distance_bitmask (parent[i], parent[j], n_nodes, n_taxa), "RF from hashes differs from brute force");
+    ck_assert_msg (dist[crpx_split_hash_rf_index (j, i, n_trees)] == rf, "RF matrix differs from pairwise RF");
+  }
+  for (i = 0; i < n_trees; i++) free (parent[i]);
+  free (dist);
+  del_crpx_split_hash (sh);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+START_TEST(multiset_hash_of_splits)
+{
+  uint32_t i, j, n_taxa = 50, n_nodes;
+  int32_t parent[2 * 50], n_a, n_b;
+  uint64_t splits_a[2 * 50], splits_b[2 * 50], shuffled[2 * 50], x, d1[2], d2[2], *big = (uint64_t *) malloc (200000 * sizeof (uint64_t));
+  crpx_multiset_hash_struct ha, hb, hc, hd;
+  crpx_global_t cglob = crpx_global_init (0, "warning");
+  crpx_split_hash_t sh = new_crpx_split_hash (cglob, n_taxa);
+
+  n_nodes = random_rooted_tree (cglob, n_taxa, parent);
+  n_a = crpx_split_hash_tree (sh, parent, n_nodes, splits_a);
+  random_rooted_tree (cglob, n_taxa, parent);
+  n_b = crpx_split_hash_tree (sh, parent, n_nodes, splits_b);
+  memcpy (shuffled, splits_a, n_a * sizeof (uint64_t));
+  for (i = n_a - 1; i > 0; i--) { j = crpx_random_range (cglob, i + 1); x = shuffled[i]; shuffled[i] = shuffled[j]; shuffled[j] = x; }
+  crpx_multiset_hash_init_from_uint64_array (&ha, 7, splits_a, n_a);
+  crpx_multiset_hash_init_from_uint64_array (&hb, 7, shuffled, n_a);
+  ck_assert_msg (crpx_multiset_hash_equal (&ha, &hb) && (crpx_multiset_hash_64bits (&ha) == crpx_multiset_hash_64bits (&hb)), "hash depends on order");
+  crpx_multiset_hash_init_from_uint64_array (&hc, 7, splits_b, n_b);
+  ck_assert_msg (!crpx_multiset_hash_equal (&ha, &hc), "distinct split sets have same hash");
+
+  for (i = 0; i < (uint32_t) CRPX_MIN (n_a, n_b); i++) { // incremental moves from tree a to tree b, one split at a time
+    crpx_multiset_hash_remove_uint64 (&hb, splits_a[i]);
+    crpx_multiset_hash_add_uint64 (&hb, splits_b[i]);
+  }
+  for (; i < (uint32_t) n_a; i++) crpx_multiset_hash_remove_uint64 (&hb, splits_a[i]);
+  for (; i < (uint32_t) n_b; i++) crpx_multiset_hash_add_uint64 (&hb, splits_b[i]);
+  crpx_multiset_hash_128bits (&hb, d1);
+  crpx_multiset_hash_128bits (&hc, d2);
+  ck_assert_msg (crpx_multiset_hash_equal (&hb, &hc) && (d1[0] == d2[0]) && (d1[1] == d2[1]), "incremental hash differs from batch");
+
+  crpx_multiset_hash_init (&hd, 7); // combine and subtract
+  crpx_multiset_hash_combine (&hd, &ha);
+  crpx_multiset_hash_combine (&hd, &hc);
+  crpx_multiset_hash_add_uint64_array (&ha, splits_b, n_b);
+  ck_assert_msg (crpx_multiset_hash_equal (&ha, &hd), "combined hash differs from hash of union");
+  crpx_multiset_hash_subtract (&hd, &hc);
+  crpx_multiset_hash_init_from_uint64_array (&hb, 7, splits_a, n_a);
+  ck_assert_msg (crpx_multiset_hash_equal (&hb, &hd), "subtracted hash differs");
+  crpx_multiset_hash_add_uint64 (&hd, splits_a[0]); // multiset: repeated element changes the hash
+  ck_assert_msg (!crpx_multiset_hash_equal (&hb, &hd), "repeated element does not change the hash");
+  crpx_multiset_hash_init (&hd, 8);
+  ck_assert_msg (!crpx_multiset_hash_combine (&hd, &hb), "hashes with distinct seeds were combined");
+
+  crpx_multiset_hash_init (&ha, 1); // byte strings, e.g. taxon names
+  crpx_multiset_hash_init (&hb, 1);
+  crpx_multiset_hash_add_bytes (&ha, "Homo_sapiens", 12);
+  crpx_multiset_hash_add_bytes (&ha, "Pan_troglodytes", 15);
+  crpx_multiset_hash_add_bytes (&hb, "Pan_troglodytes", 15);
+  crpx_multiset_hash_add_bytes (&hb, "Homo_sapiens", 12);
+  ck_assert_msg (crpx_multiset_hash_equal (&ha, &hb), "hash of strings depends on order");
+  crpx_multiset_hash_remove_bytes (&hb, "Homo_sapiens", 12);
+  ck_assert_msg (!crpx_multiset_hash_equal (&ha, &hb), "removing a string does not change the hash");
+
+  for (i = 0; i < 200000; i++) big[i] = i / 2; // parallel batch: same as serial, and counts repetitions
+  crpx_multiset_hash_init_from_uint64_array (&ha, 3, big, 200000);
+  crpx_multiset_hash_init (&hb, 3);
+  for (i = 0; i < 200000; i++) crpx_multiset_hash_add_uint64 (&hb, big[i]);
+  ck_assert_msg (crpx_multiset_hash_equal (&ha, &hb) && (ha.n_elements == 200000), "parallel batch differs from serial");
+  crpx_multiset_hash_init_from_uint64_array (&hb, 3, big, 200000 - 1);
+  ck_assert_msg (crpx_multiset_hash_64bits (&ha) != crpx_multiset_hash_64bits (&hb), "hash of multiset without last element is the same");
+
+  free (big);
+  del_crpx_split_hash (sh);
+  crpx_global_finalise (cglob);
+}
+END_TEST
+
+Suite * this_suite(void)
+{
+  Suite *s;
+  TCase *tc_case;
+
+  s = suite_create("splits");
+  tc_case = tcase_create("split_hashing");
+  tcase_add_test(tc_case, split_hash_rerooting);
+  tcase_add_test(tc_case, split_hash_rf_random_trees);
+  suite_add_tcase(s, tc_case);
+  tc_case = tcase_create("multiset_hashing");
+  tcase_add_test(tc_case, multiset_hash_of_splits);
+  suite_add_tcase(s, tc_case);
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  SRunner *sr;
+
+  sr = srunner_create (this_suite());
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed > 0) ? TEST_FAILURE:TEST_SUCCESS;
+}